@@ -0,0 +1,159 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file snapshotBenchmark.cpp
+ *  @brief Load generator for the snapshot server, talks to 127.0.0.1 only.
+ *
+ *  usage: snapshotBenchmark.exe [port] [clients] [requestsPerClient] [firstEntry] [lastEntry]
+ *  Every client keeps one connection open and asks for random entries
+ *  from [firstEntry, lastEntry]; a narrow range shows the effect of the
+ *  shared cache, a wide one the cost of decoding.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+int connectToServer(int port)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  int noDelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  return fd;
+}
+
+/// sends one GET and reads the whole response, returns false on any error
+bool request(int fd, const std::string& path, std::string& buffer)
+{
+  std::string data = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t result = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (result <= 0)
+      return false;
+    sent += result;
+  }
+  char chunk[65536];
+  size_t headerEnd;
+  while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+    ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+    if (received <= 0)
+      return false;
+    buffer.append(chunk, received);
+  }
+  size_t lengthPos = buffer.find("Content-Length: ");
+  if (lengthPos == std::string::npos || lengthPos > headerEnd)
+    return false;
+  size_t length = std::strtoul(buffer.c_str() + lengthPos + 16, 0, 10);
+  while (buffer.size() < headerEnd + 4 + length) {
+    ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+    if (received <= 0)
+      return false;
+    buffer.append(chunk, received);
+  }
+  bool ok = buffer.compare(0, 12, "HTTP/1.1 200") == 0;
+  buffer.erase(0, headerEnd + 4 + length);
+  return ok;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  const int port = argc > 1 ? std::atoi(argv[1]) : 9090;
+  const int clients = argc > 2 ? std::atoi(argv[2]) : 8;
+  const int requests = argc > 3 ? std::atoi(argv[3]) : 1000;
+  const long long firstEntry = argc > 4 ? std::atoll(argv[4]) : 0;
+  const long long lastEntry = argc > 5 ? std::atoll(argv[5]) : 99;
+
+  std::vector<std::vector<double> > latencies(clients);
+  std::vector<int> failures(clients, 0);
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int c = 0; c < clients; c++) {
+    threads.push_back(std::thread([&, c] {
+      int fd = connectToServer(port);
+      if (fd < 0) {
+        failures[c] = requests;
+        return;
+      }
+      std::mt19937_64 generator(c);
+      std::uniform_int_distribution<long long> entries(firstEntry, std::max(firstEntry, lastEntry));
+      std::string buffer;
+      latencies[c].reserve(requests);
+      for (int i = 0; i < requests; i++) {
+        auto begin = std::chrono::steady_clock::now();
+        bool ok = request(fd, "/entry/" + std::to_string(entries(generator)), buffer);
+        auto end = std::chrono::steady_clock::now();
+        if (!ok) {
+          failures[c] += requests - i;
+          break;
+        }
+        latencies[c].push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+      }
+      close(fd);
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::vector<double> all;
+  int failed = 0;
+  for (int c = 0; c < clients; c++) {
+    all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+    failed += failures[c];
+  }
+  if (all.empty()) {
+    std::cerr << "No successful requests, is the server running on port " << port << "?" << std::endl;
+    return 1;
+  }
+  std::sort(all.begin(), all.end());
+  double sum = 0;
+  for (double latency : all)
+    sum += latency;
+  std::cout << clients << " clients, " << all.size() << " requests in " << seconds << " s: "
+            << all.size() / seconds << " requests/s" << std::endl;
+  std::cout << "latency [us]: mean " << sum / all.size()
+            << ", p50 " << all[all.size() / 2]
+            << ", p99 " << all[std::min(all.size() - 1, all.size() * 99 / 100)]
+            << ", max " << all.back() << std::endl;
+  if (failed)
+    std::cout << failed << " requests failed" << std::endl;
+  return failed ? 1 : 0;
+}
@@ -1,5 +1,5 @@
 // Wojciech Krzemien
-// 08.11.2013 
+// 08.11.2013
 #include <TROOT.h>
 #include <TPad.h>
 #include <TView.h>
@@ -10,88 +10,171 @@
 #include <TGeoTube.h>
 #include <TGeoManager.h>
 #include <TGeoMatrix.h>
+#include <TMath.h>
 
+#include <JPetGeomMapping/JPetGeomMapping.h>
+#include <JPetParamGetterAscii/JPetParamGetterAscii.h>
+#include <JPetParamManager/JPetParamManager.h>
+#include <JPetParamBank/JPetParamBank.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
 #include <vector>
 
-void createDetector(TGeoVolume *top, TGeoRotation* rotation) 
+// bump whenever the way the geometry is built changes,
+// so that files cached by older generators are rebuilt
+static const int kGeneratorVersion = 2;
+
+// default strip dimensions [cm] used when the param bank does not provide them
+static const double kDefaultStripLength = 50.;
+static const double kDefaultStripHeight = 1.9;
+static const double kDefaultStripWidth = 0.7;
+
+struct StripDescription
+{
+  int slot;
+  double theta; // degrees
+};
+
+struct LayerDescription
+{
+  double radius = 0.;
+  double stripLength = kDefaultStripLength;
+  double stripHeight = kDefaultStripHeight;
+  double stripWidth = kDefaultStripWidth;
+  std::vector<StripDescription> strips;
+};
+
+// layer number (from 1, as in JPetGeomMapping) -> layer description
+typedef std::map<int, LayerDescription> DetectorDescription;
+
+// FNV-1a, good enough to detect changes in the detector description
+std::string hashInputs(const std::string& paramFile, int runNumber)
+{
+  std::ifstream in(paramFile.c_str(), std::ios::binary);
+  if (!in)
+    return "";
+  std::ostringstream content;
+  content << kGeneratorVersion << ":" << runNumber << ":" << in.rdbuf();
+  const std::string data = content.str();
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  char buffer[17];
+  snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+  return buffer;
+}
+
+bool isCacheValid(const std::string& outputGeomFile, const std::string& hash)
+{
+  std::ifstream geom(outputGeomFile.c_str());
+  std::ifstream stamp((outputGeomFile + ".hash").c_str());
+  if (!geom || !stamp)
+    return false;
+  std::string storedHash;
+  stamp >> storedHash;
+  return storedHash == hash;
+}
+
+void writeCacheStamp(const std::string& outputGeomFile, const std::string& hash)
+{
+  std::ofstream stamp((outputGeomFile + ".hash").c_str());
+  stamp << hash << "\n";
+}
+
+DetectorDescription readDetectorDescription(const std::string& paramFile, int runNumber)
+{
+  JPetParamManager paramManager(new JPetParamGetterAscii(paramFile));
+  paramManager.fillParameterBank(runNumber);
+  const JPetParamBank& bank = paramManager.getParamBank();
+  // the same mapping is used by DataProcessor, so strip numbers agree
+  JPetGeomMapping mapping(bank);
+
+  DetectorDescription detector;
+  for (const auto& slotEntry : bank.getBarrelSlots()) {
+    const JPetBarrelSlot& slot = *slotEntry.second;
+    StripPos pos = mapping.getStripPos(slot);
+    LayerDescription& layer = detector[pos.layer];
+    layer.radius = slot.getLayer().getRadius();
+    layer.strips.push_back({static_cast<int>(pos.slot), slot.getTheta()});
+  }
+  for (const auto& scinEntry : bank.getScintillators()) {
+    const JPetScin& scin = *scinEntry.second;
+    if (scin.getBarrelSlot().isNullObject())
+      continue;
+    StripPos pos = mapping.getStripPos(scin.getBarrelSlot());
+    LayerDescription& layer = detector[pos.layer];
+    if (scin.getScinSize(JPetScin::kLength) > 0)
+      layer.stripLength = scin.getScinSize(JPetScin::kLength);
+    if (scin.getScinSize(JPetScin::kHeight) > 0)
+      layer.stripHeight = scin.getScinSize(JPetScin::kHeight);
+    if (scin.getScinSize(JPetScin::kWidth) > 0)
+      layer.stripWidth = scin.getScinSize(JPetScin::kWidth);
+  }
+  return detector;
+}
+
+void createDetector(TGeoVolume *top, TGeoRotation* rotation, const DetectorDescription& detector)
 {
   assert(top);
   TGeoMaterial *matAl = new TGeoMaterial("Al", 0,0 ,0);
   assert(matAl);
   TGeoMedium *medium = new TGeoMedium("Aluminium",2, matAl);
   assert(medium);
-  // pseudo geometry for Inner Tracker for KLOE
-  // concentric cylinder layers
-  
-  static const double kLength = 70;
-  static const int kNumberOfLayers = 3; 
-  static const double kLayerThickness = 0.9; 
-  // radius of every layer without layer thickness 
-  static const double kRadii[] = {13., 15.5, 18., 20.5};
-  
-
-  // XStrips are parallel to OZ axis
-  // VStrips are inclined by some value i dont know what 
-  static const int kNumberOfXStrips[] = { 48, 48, 96 };
-  
-  std::vector<TGeoTube*> layers; 
-  
-  for (int i = 0; i < kNumberOfLayers; i++) {
-    // the last argument is the distance along Z from 0,0,0 to positive Z border (called dz) 
-    // and the total kLength along Z axis 
-    // is from -dz to dz
-    TGeoTube* layer = new TGeoTube(kRadii[i], kRadii[i] + kLayerThickness, kLength/2.); 
-    assert(layer);
-    layers.push_back(layer);
-  }
 
-
-
-  TGeoVolume* vol = 0; 
-  // Inner Tracker
-
-  int volNr = top->GetNtotal() + 1;
-  std::vector<TGeoTube*>::iterator it; 
-  int i = 0;
+  // every layer is a cylinder enclosing its strips, strips are boxes
+  // parallel to OZ axis placed at the radius and angle of their barrel slot.
+  // Node names (layer_<n>_1, XStrip_<m>) are the ones GeometryVisualizator looks for.
   char nameOfLayer[100];
-  for (it = layers.begin(); it != layers.end(); ++it) {
-
-    //(*it)->Divide(vol, "XSlicesCreation",2 , 30, 0, 0);
-    sprintf(nameOfLayer, "layer_%d", i + 1);
-    vol = new TGeoVolume(nameOfLayer, *it, medium);
+  for (const auto& layerEntry : detector) {
+    const int layerNumber = layerEntry.first;
+    const LayerDescription& layer = layerEntry.second;
+    const double halfHeight = layer.stripHeight / 2.;
+    const double halfWidth = layer.stripWidth / 2.;
+    const double halfLength = layer.stripLength / 2.;
+    const double rMin = std::max(0., layer.radius - halfHeight - 0.1);
+    const double rMax = std::sqrt((layer.radius + halfHeight) * (layer.radius + halfHeight)
+                                  + halfWidth * halfWidth) + 0.1;
+
+    sprintf(nameOfLayer, "layer_%d", layerNumber);
+    TGeoTube* layerShape = new TGeoTube(rMin, rMax, halfLength);
+    assert(layerShape);
+    TGeoVolume* vol = new TGeoVolume(nameOfLayer, layerShape, medium);
     assert(vol);
     vol->SetVisibility(kTRUE);
     vol->SetLineColor(kBlue);
 
-    vol->Divide("XStrip", 2, kNumberOfXStrips[i], 0, 0 ,0);
-    TObjArray* array = vol->GetNodes();
-    assert(array);
-    TGeoNode* strip = 0;
-    TIter iter(array);
-    while (strip = static_cast<TGeoNode*>(iter.Next())) {
-     strip->GetVolume()->SetLineColor(kRed);
-     strip->GetVolume()->SetVisibility(kTRUE);
+    TGeoVolume* stripVol = new TGeoVolume("XStrip", new TGeoBBox(halfHeight, halfWidth, halfLength), medium);
+    assert(stripVol);
+    stripVol->SetLineColor(kRed);
+    stripVol->SetVisibility(kTRUE);
+    for (const auto& strip : layer.strips) {
+      const double phi = strip.theta * TMath::DegToRad();
+      TGeoRotation* stripRotation = new TGeoRotation();
+      stripRotation->RotateZ(strip.theta);
+      vol->AddNode(stripVol, strip.slot,
+                   new TGeoCombiTrans(layer.radius * std::cos(phi), layer.radius * std::sin(phi), 0., stripRotation));
     }
-  //  strip = vol->GetNode(2);
-  //  strip->GetVolume()->SetVisiblity(kTRUE);
-    // vol->SetVisibility(kTRUE);
-    //vol->SetLineColor(kBlue);
-    //vol->SetVisibility(kTRUE);
-    volNr = top->GetNtotal() + 1; 
-    top->AddNode(vol, volNr, rotation);
-    i++;
+    top->AddNode(vol, 1, rotation);
   }
 }
 
 
 // isTopVisible - if the top volume will be visible during drawning
-void createGeometryPET(bool isTopVisible = false)
+void createGeometryPET(const DetectorDescription& detector, const std::string& outputGeomFile,
+                       bool isTopVisible = false)
 {
-
-  std::string outputGeomFile = "JPET_geom.root";
- 
-
   const double kXWorld = 500;
   const double kYWorld = 500;
   const double kZWorld = 500;
@@ -104,23 +187,15 @@ void createGeometryPET(bool isTopVisible = false)
   assert(matVacuum);
   TGeoMedium *vacuum = new TGeoMedium("Vacuum",1, matVacuum);
   assert(vacuum);
-  TGeoMaterial* matAl = new TGeoMaterial("Al", 0,0 ,0);
-  assert(matAl);
-  TGeoMedium* medium2 = new TGeoMedium("Aluminium",2, matAl);
-  assert(medium2);
 
   TGeoVolume* top = mgr ->MakeBox("TOP", vacuum, kXWorld, kYWorld, kZWorld);
   assert(top);
   mgr->SetTopVolume(top);
 
   TGeoRotation* rotation = new TGeoRotation();
-   //rotation->SetAngles(60., 90., 0.);
-  //rotation->SetAngles(0, 90., 0.);
   rotation->SetAngles(0., 0., 0.);
 
-  //rotation->SetAngles(60., 0., 0.);
-  createDetector(top, rotation);
-
+  createDetector(top, rotation, detector);
 
   if (isTopVisible) {
     top->SetLineColor(kMagenta);
@@ -128,15 +203,34 @@ void createGeometryPET(bool isTopVisible = false)
   }
 
   mgr->CloseGeometry();
-  //gPad->GetView()->Top();
   mgr->SetVisLevel(4);
-  //mgr->SetVisOption(0);
-  top->Draw();
 
   mgr->Export(outputGeomFile.c_str());
 }
 
-int main()
+// usage: createGeometryPET.exe [paramFile] [runNumber] [outputFile]
+int main(int argc, char** argv)
 {
-  createGeometryPET();
+  const std::string paramFile = argc > 1 ? argv[1] : "large_barrel.json";
+  const int runNumber = argc > 2 ? std::atoi(argv[2]) : 43;
+  const std::string outputGeomFile = argc > 3 ? argv[3] : "JPET_geom.root";
+
+  const std::string hash = hashInputs(paramFile, runNumber);
+  if (hash.empty()) {
+    std::cerr << "Cannot read parameter file: " << paramFile << std::endl;
+    return 1;
+  }
+  if (isCacheValid(outputGeomFile, hash)) {
+    std::cout << outputGeomFile << " is up to date (" << hash << ")" << std::endl;
+    return 0;
+  }
+
+  DetectorDescription detector = readDetectorDescription(paramFile, runNumber);
+  if (detector.empty()) {
+    std::cerr << "No barrel slots found in " << paramFile << " for run " << runNumber << std::endl;
+    return 1;
+  }
+  createGeometryPET(detector, outputGeomFile);
+  writeCacheStamp(outputGeomFile, hash);
+  return 0;
 }
@@ -13,12 +13,210 @@
  */
 
 #include <TRint.h>
+#include <TSystem.h>
+#include <TThread.h>
 #include <iostream>
+#include <boost/program_options.hpp>
 #include "src/EventDisplay.h"
+#include "src/BatchRenderer.h"
+#include "src/SnapshotServer.h"
+#include "src/ChannelQA.h"
+#include "src/EventSampler.h"
+#include "src/RunComparison.h"
+#include "src/CampaignProcessor.h"
+#include "src/FileProbe.h"
+#include "src/CommonTools.h"
+#include <random>
+#include <thread>
+
+namespace po = boost::program_options;
 
 int main(int argc, char** argv)
 {
   using namespace jpet_event_display;
-  EventDisplay myDisplay;
+
+  EventDisplayOptions displayOptions;
+  BatchRenderOptions batchOptions;
+  SnapshotServerOptions serverOptions;
+  CampaignOptions campaignOptions;
+  std::string exportFile;
+  po::options_description description("Allowed options");
+  description.add_options()
+    ("help,h", "produce help message")
+    ("batch,b", "render entries to image files without GUI")
+    ("geometry,g", po::value<std::string>(&batchOptions.geometryFile), "geometry file")
+    ("data,d", po::value<std::string>(&batchOptions.dataFile), "data file")
+    ("entry,e", po::value<long long>(&displayOptions.entry), "entry shown first in the GUI")
+    ("first", po::value<long long>(&batchOptions.firstEntry), "first entry to render")
+    ("last", po::value<long long>(&batchOptions.lastEntry), "last entry to render (default: last in file)")
+    ("workers,j", po::value<int>(&batchOptions.workers), "number of worker processes")
+    ("output,o", po::value<std::string>(&batchOptions.outputDirectory), "output directory for images")
+    ("format,f", po::value<std::string>(&batchOptions.format), "image format, e.g. png or svg")
+    ("width", po::value<int>(&batchOptions.width), "image width")
+    ("height", po::value<int>(&batchOptions.height), "image height")
+    ("count-only", "with --batch: only count coincidences, no images")
+    ("coincidence-window", po::value<double>(), "max time between hits of a coincidence [ns]")
+    ("coincidence-side-window", po::value<double>(), "max time between the two sides of one strip hit [ns]")
+    ("coincidence-angle", po::value<double>(), "max deviation of a coincidence from back to back [deg]")
+    ("imt", po::value<unsigned>(), "unzip baskets with this many threads (ROOT implicit multithreading, not with --batch)")
+    ("qa", "report dead and hot strips of --data and exit")
+    ("qa-k", po::value<double>()->default_value(5.), "strips outside layer median +- k * MAD are flagged")
+    ("sample", po::value<long long>(), "estimate occupancy and multiplicity of --data from this many random entries and exit")
+    ("stratified", "with --sample: one entry from each of equal entry ranges")
+    ("compare", po::value<std::string>(), "compare whole-run strip occupancy of --data with this file and exit")
+    ("list", po::value<std::string>(), "print type, entries, size and run of every .root file in this directory and exit")
+    ("campaign", po::value<std::vector<std::string> >(&campaignOptions.dataFiles)->multitoken(),
+     "count coincidences in all these data files on a thread pool and exit")
+    ("checkpoint", po::value<std::string>(&campaignOptions.checkpointFile), "with --campaign: record finished chunks here and resume from it")
+    ("chunk", po::value<long long>(&campaignOptions.chunkEntries), "with --campaign: entries per chunk of work")
+    ("serve", "serve entry snapshots as JSON on 127.0.0.1 without GUI")
+    ("port", po::value<int>(&serverOptions.port), "port of the snapshot server")
+    ("export", po::value<std::string>(&exportFile), "write --data as a columnar event selection file and exit")
+    ("cache-size", po::value<size_t>(&serverOptions.cacheSize), "number of entries kept by the snapshot server")
+    ("monitor-interval", po::value<int>(&displayOptions.monitorLogSeconds), "log memory and object counts every this many seconds, 0 disables")
+    ("session", po::value<std::string>(&displayOptions.sessionFile), "session file (default: ~/.jpet-event-display.session), empty disables")
+    ("time-window", po::value<double>(), "DAQ time window length used by go to time [us] (default: 50)")
+    ("fresh", "start without restoring the saved session")
+    ;
+
+  po::variables_map variablesMap;
+  try {
+    po::store(po::parse_command_line(argc, argv, description), variablesMap);
+    po::notify(variablesMap);
+  } catch (const po::error& error) {
+    std::cerr << error.what() << "\n" << description << std::endl;
+    return 1;
+  }
+  if (variablesMap.count("help")) {
+    std::cout << description << std::endl;
+    return 0;
+  }
+  // ROOT files are read on worker threads in every mode, initialised here once on the main thread
+  TThread::Initialize();
+  CoincidenceOptions coincidence;
+  if (variablesMap.count("coincidence-window"))
+    coincidence.coincidenceWindow = variablesMap["coincidence-window"].as<double>() * 1000.;
+  if (variablesMap.count("coincidence-side-window"))
+    coincidence.sideWindow = variablesMap["coincidence-side-window"].as<double>() * 1000.;
+  if (variablesMap.count("coincidence-angle"))
+    coincidence.angleTolerance = variablesMap["coincidence-angle"].as<double>();
+  batchOptions.coincidence = coincidence;
+  batchOptions.countOnly = variablesMap.count("count-only") > 0;
+  displayOptions.coincidence = coincidence;
+
+  // the thread pool would not survive the worker processes forked in batch mode
+  if (variablesMap.count("imt") && !variablesMap.count("batch"))
+    DataProcessor::enableImplicitMT(variablesMap["imt"].as<unsigned>());
+
+  if (variablesMap.count("batch")) {
+    if (batchOptions.dataFile.empty()) {
+      std::cerr << "Batch mode requires --data" << std::endl;
+      return 1;
+    }
+    BatchRenderer renderer(batchOptions);
+    return renderer.run();
+  }
+
+  if (variablesMap.count("qa")) {
+    if (batchOptions.dataFile.empty()) {
+      std::cerr << "QA requires --data" << std::endl;
+      return 1;
+    }
+    std::unique_ptr<ChannelQA> qa(new ChannelQA(variablesMap["qa-k"].as<double>()));
+    std::atomic<bool> cancel(false);
+    if (!qa->run(batchOptions.dataFile, cancel)) {
+      std::cerr << "Cannot read " << batchOptions.dataFile << std::endl;
+      return 1;
+    }
+    ChannelFlags flags = qa->findFlags();
+    std::cout << qa->getNumberOfEntries() << " entries, " << flags.size() << " flagged strips" << std::endl
+              << ChannelQA::describe(flags);
+    return 0;
+  }
+
+  if (variablesMap.count("sample")) {
+    if (batchOptions.dataFile.empty()) {
+      std::cerr << "Sampling requires --data" << std::endl;
+      return 1;
+    }
+    EventSampler sampler;
+    std::atomic<bool> cancel(false);
+    if (!sampler.run(batchOptions.dataFile, variablesMap["sample"].as<long long>(),
+                     variablesMap.count("stratified") > 0, std::random_device()(), cancel)) {
+      std::cerr << "Cannot read " << batchOptions.dataFile << std::endl;
+      return 1;
+    }
+    std::cout << EventSampler::describe(sampler.getEstimate());
+    return 0;
+  }
+
+  if (variablesMap.count("compare")) {
+    if (batchOptions.dataFile.empty()) {
+      std::cerr << "Comparison requires --data" << std::endl;
+      return 1;
+    }
+    const std::string secondFile = variablesMap["compare"].as<std::string>();
+    RunComparison comparison;
+    std::atomic<bool> cancel(false);
+    if (!comparison.run(batchOptions.dataFile, secondFile, cancel)) {
+      std::cerr << "Cannot read " << batchOptions.dataFile << " or " << secondFile << std::endl;
+      return 1;
+    }
+    std::cout << comparison.getFirstEntries() << " vs " << comparison.getSecondEntries() << " entries" << std::endl
+              << comparison.describe(20);
+    return 0;
+  }
+
+  if (variablesMap.count("list")) {
+    std::atomic<bool> cancel(false);
+    const std::vector<std::string> files = CommonTools::listFiles(variablesMap["list"].as<std::string>(), ".root");
+    for (const auto& metadata : FileProbe::probeAll(files, std::max(1u, std::thread::hardware_concurrency()), cancel))
+      std::cout << FileProbe::describe(metadata) << std::endl;
+    return 0;
+  }
+
+  if (variablesMap.count("campaign")) {
+    campaignOptions.coincidence = coincidence;
+    campaignOptions.workers = variablesMap.count("workers") ? batchOptions.workers
+                                                            : std::max(1u, std::thread::hardware_concurrency());
+    CampaignProcessor campaign(campaignOptions);
+    std::atomic<bool> cancel(false);
+    return campaign.run(cancel);
+  }
+
+  if (variablesMap.count("export")) {
+    if (batchOptions.dataFile.empty()) {
+      std::cerr << "Export requires --data" << std::endl;
+      return 1;
+    }
+    DataProcessor processor;
+    if (!processor.openFile(batchOptions.dataFile.c_str())
+        || !processor.exportEventSelection(exportFile)) {
+      std::cerr << "Cannot export " << batchOptions.dataFile << " to " << exportFile << std::endl;
+      return 1;
+    }
+    std::cout << "Exported " << processor.getNumberOfEvents() << " entries to " << exportFile << std::endl;
+    return 0;
+  }
+
+  if (variablesMap.count("serve")) {
+    if (batchOptions.dataFile.empty()) {
+      std::cerr << "Server mode requires --data" << std::endl;
+      return 1;
+    }
+    serverOptions.dataFile = batchOptions.dataFile;
+    SnapshotServer server(serverOptions);
+    return server.run();
+  }
+
+  if (!variablesMap.count("session"))
+    displayOptions.sessionFile = std::string(gSystem->HomeDirectory()) + "/.jpet-event-display.session";
+  displayOptions.restoreSession = !variablesMap.count("fresh");
+  if (variablesMap.count("time-window"))
+    displayOptions.timeWindowLength = variablesMap["time-window"].as<double>() * 1e6;
+  if (variablesMap.count("geometry"))
+    displayOptions.geometryFile = batchOptions.geometryFile;
+  displayOptions.dataFile = batchOptions.dataFile;
+  EventDisplay myDisplay(displayOptions);
   return 0;
 }
@@ -0,0 +1,195 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file BatchRenderer.cpp
+ */
+
+#include "BatchRenderer.h"
+#include "DataProcessor.h"
+#include "FileProbe.h"
+#include "GeometryVisualizator.h"
+
+#include <JPetLoggerInclude.h>
+#include <TROOT.h>
+#include <TSystem.h>
+#include <TString.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace jpet_event_display
+{
+
+int BatchRenderer::run()
+{
+  gROOT->SetBatch(kTRUE);
+  gSystem->mkdir(fOptions.outputDirectory.c_str(), kTRUE);
+
+  long long first = std::max(0LL, fOptions.firstEntry);
+  long long last = fOptions.lastEntry;
+  long long entries = getNumberOfEntries();
+  if (entries <= 0) {
+    ERROR(std::string("No entries to render in file: " + fOptions.dataFile));
+    return 1;
+  }
+  if (last < 0 || last >= entries)
+    last = entries - 1;
+  if (first > last) {
+    ERROR("Empty entry range");
+    return 1;
+  }
+
+  const long long rangeSize = last - first + 1;
+  const int workers = static_cast<int>(std::max(1LL, std::min<long long>(fOptions.workers, rangeSize)));
+  const long long chunk = (rangeSize + workers - 1) / workers;
+
+  auto start = std::chrono::steady_clock::now();
+  RenderStats total;
+  std::vector<RenderStats> workerStats;
+  if (workers == 1) {
+    workerStats.push_back(renderRange(first, last));
+  } else {
+    // every worker is a separate process with its own ROOT state,
+    // DataProcessor and canvases; results come back through a pipe
+    std::vector<pid_t> children;
+    std::vector<int> pipes;
+    for (int i = 0; i < workers; i++) {
+      long long begin = first + i * chunk;
+      long long end = std::min(last, begin + chunk - 1);
+      if (begin > end)
+        break;
+      int fd[2];
+      if (pipe(fd) != 0) {
+        ERROR("Cannot create pipe for worker process");
+        break;
+      }
+      pid_t pid = fork();
+      if (pid == 0) {
+        close(fd[0]);
+        RenderStats stats = renderRange(begin, end);
+        ssize_t written = write(fd[1], &stats, sizeof(stats));
+        close(fd[1]);
+        _exit(written == sizeof(stats) ? 0 : 1);
+      }
+      close(fd[1]);
+      if (pid < 0) {
+        ERROR("Cannot fork worker process");
+        close(fd[0]);
+        break;
+      }
+      children.push_back(pid);
+      pipes.push_back(fd[0]);
+    }
+    for (size_t i = 0; i < children.size(); i++) {
+      RenderStats stats;
+      if (read(pipes[i], &stats, sizeof(stats)) != sizeof(stats))
+        WARNING(std::string("Worker " + CommonTools::intToString(i) + " did not report its results"));
+      close(pipes[i]);
+      int status = 0;
+      waitpid(children[i], &status, 0);
+      workerStats.push_back(stats);
+    }
+  }
+  double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (size_t i = 0; i < workerStats.size(); i++) {
+    total.frames += workerStats[i].frames;
+    total.coincidences += workerStats[i].coincidences;
+    total.clusters += workerStats[i].clusters;
+    total.bytesRead += workerStats[i].bytesRead;
+    total.unzipSeconds += workerStats[i].unzipSeconds;
+    std::cout << "worker " << i << ": " << workerStats[i].frames << " events in "
+              << workerStats[i].seconds << " s";
+    if (workerStats[i].seconds > 0)
+      std::cout << " (" << workerStats[i].frames / workerStats[i].seconds << " events/s)";
+    std::cout << std::endl;
+  }
+  const int cores = std::max<int>(1, workerStats.size());
+  double fps = wallTime > 0 ? total.frames / wallTime : 0.;
+  if (total.frames > 0)
+    std::cout << "read " << total.bytesRead / 1024. / 1024. << " MB, "
+              << total.bytesRead / 1024. / total.frames << " kB and "
+              << total.unzipSeconds * 1000. / total.frames << " ms unzipping per event" << std::endl;
+  std::cout << "found " << total.coincidences << " coincidences in " << total.clusters
+            << " clusters" << std::endl;
+  std::cout << (fOptions.countOnly ? "processed " : "rendered ") << total.frames << " events in " << wallTime << " s: "
+            << fps << " events/s, " << fps / cores << " events/s per core ("
+            << cores << " workers)" << std::endl;
+  INFO(std::string("Batch rendering finished, " + CommonTools::doubleToString(fps / cores)
+                   + " events/s per core"));
+  return total.frames == rangeSize ? 0 : 1;
+}
+
+long long BatchRenderer::getNumberOfEntries() const
+{
+  // only the tree header is needed here, the workers open the file on their own
+  return FileProbe::probe(fOptions.dataFile).entries;
+}
+
+BatchRenderer::RenderStats BatchRenderer::renderRange(long long first, long long last) const
+{
+  RenderStats stats;
+  auto start = std::chrono::steady_clock::now();
+
+  DataProcessor dataProcessor;
+  dataProcessor.setCoincidenceOptions(fOptions.coincidence);
+  if (!dataProcessor.openFile(fOptions.dataFile.c_str())) {
+    ERROR(std::string("Error opening file:" + fOptions.dataFile));
+    return stats;
+  }
+  GeometryVisualizator visualizator;
+  if (!fOptions.countOnly) {
+    visualizator.createBatchCanvases(fOptions.width, fOptions.height);
+    visualizator.loadGeometry(fOptions.geometryFile);
+    visualizator.drawOnlyGeometry();
+  }
+
+  for (long long entry = first; entry <= last; entry++) {
+    DecodedEvent event = dataProcessor.decodeEvent(entry);
+    if (!event.valid)
+      break;
+    stats.coincidences += event.coincidences.getNumberOfPairs();
+    stats.clusters += event.coincidences.clusters.size();
+    stats.bytesRead += event.readStats.bytesRead;
+    stats.unzipSeconds += event.readStats.unzipSeconds;
+    if (fOptions.countOnly) {
+      stats.frames++;
+      continue;
+    }
+    if (fOptions.draw3d) {
+      visualizator.drawStrips3d(event.selection);
+      visualizator.drawCoincidences3d(event.coincidences);
+      visualizator.drawHits3d(event.coincidences.hits);
+    }
+    if (fOptions.draw2d) {
+      visualizator.drawStrips2d(event.selection);
+      visualizator.drawCoincidences2d(event.coincidences);
+    }
+    if (fOptions.drawDiagram)
+      visualizator.drawDiagram(event.diagram);
+    visualizator.saveViews(std::string(Form("%s/event_%06lld", fOptions.outputDirectory.c_str(), entry)),
+                           fOptions.format, fOptions.draw3d, fOptions.draw2d, fOptions.drawDiagram);
+    stats.frames++;
+  }
+  dataProcessor.closeFile();
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+}
@@ -0,0 +1,76 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file BatchRenderer.h
+ *  @brief Renders views of a range of entries to image files without X display.
+ */
+
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <string>
+
+#include "CoincidenceFinder.h"
+
+namespace jpet_event_display
+{
+
+struct BatchRenderOptions
+{
+  std::string geometryFile = "JPET_geom.root";
+  std::string dataFile;
+  std::string outputDirectory = ".";
+  std::string format = "png";
+  long long firstEntry = 0;
+  long long lastEntry = -1; // -1 means up to the last entry in file
+  int workers = 1;
+  int width = 800;
+  int height = 800;
+  bool draw3d = true;
+  bool draw2d = true;
+  bool drawDiagram = true;
+  /// only count coincidences, no images are written
+  bool countOnly = false;
+  CoincidenceOptions coincidence;
+};
+
+class BatchRenderer
+{
+public:
+  explicit BatchRenderer(const BatchRenderOptions& options) : fOptions(options) {}
+  /// returns 0 on success, can be used as process exit code
+  int run();
+
+private:
+  BatchRenderer(const BatchRenderer&) = delete;
+  BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+  struct RenderStats
+  {
+    long long frames = 0;
+    double seconds = 0.;
+    long long coincidences = 0;
+    long long clusters = 0;
+    long long bytesRead = 0;
+    double unzipSeconds = 0.;
+  };
+
+  long long getNumberOfEntries() const;
+  /// renders entries [first, last] with its own DataProcessor and canvases
+  RenderStats renderRange(long long first, long long last) const;
+
+  BatchRenderOptions fOptions;
+};
+
+}
+
+#endif /*  !BATCHRENDERER_H */
@@ -0,0 +1,114 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file ByteStream.h
+ *  @brief Little helpers for dumping plain values and vectors into a byte buffer.
+ */
+
+#ifndef BYTESTREAM_H
+#define BYTESTREAM_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace jpet_event_display
+{
+
+/// appends raw values in host byte order, files are read back on the same machine
+class ByteWriter
+{
+public:
+  explicit ByteWriter(std::string& out) : fOut(out) {}
+
+  template <typename T>
+  void put(const T& value) { fOut.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+  template <typename T>
+  void putVector(const std::vector<T>& values)
+  {
+    put<uint64_t>(values.size());
+    if (!values.empty())
+      fOut.append(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(T));
+  }
+
+  void putString(const std::string& value)
+  {
+    put<uint64_t>(value.size());
+    fOut.append(value);
+  }
+
+private:
+  std::string& fOut;
+};
+
+/// reads what ByteWriter wrote, every read past the end fails and sets ok() to false
+class ByteReader
+{
+public:
+  ByteReader(const char* data, size_t size) : fData(data), fSize(size) {}
+
+  template <typename T>
+  bool get(T& value)
+  {
+    if (!take(sizeof(T)))
+      return false;
+    std::memcpy(&value, fData + fOffset - sizeof(T), sizeof(T));
+    return true;
+  }
+
+  template <typename T>
+  bool getVector(std::vector<T>& values)
+  {
+    uint64_t count = 0;
+    if (!get(count) || count > (fSize - fOffset) / sizeof(T) || !take(count * sizeof(T))) {
+      fOk = false;
+      return false;
+    }
+    values.resize(count);
+    if (count)
+      std::memcpy(&values[0], fData + fOffset - count * sizeof(T), count * sizeof(T));
+    return true;
+  }
+
+  bool getString(std::string& value)
+  {
+    uint64_t length = 0;
+    if (!get(length) || length > fSize - fOffset || !take(length)) {
+      fOk = false;
+      return false;
+    }
+    value.assign(fData + fOffset - length, length);
+    return true;
+  }
+
+  inline bool ok() const { return fOk; }
+
+private:
+  bool take(size_t bytes)
+  {
+    if (!fOk || bytes > fSize - fOffset)
+      return fOk = false;
+    fOffset += bytes;
+    return true;
+  }
+
+  const char* fData;
+  size_t fSize;
+  size_t fOffset = 0;
+  bool fOk = true;
+};
+
+}
+
+#endif /*  !BYTESTREAM_H */
@@ -0,0 +1,342 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file CampaignProcessor.cpp
+ */
+
+#include "CampaignProcessor.h"
+#include "ByteStream.h"
+#include "CommonTools.h"
+#include "DataProcessor.h"
+#include "FileProbe.h"
+#include "MappedFile.h"
+
+#include <JPetLoggerInclude.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace jpet_event_display
+{
+
+namespace
+{
+const char kMagic[8] = {'J', 'P', 'E', 'T', 'C', 'K', 'P', '1'};
+const int kProgressSeconds = 60;
+}
+
+int CampaignProcessor::run(const std::atomic<bool>& cancel)
+{
+  if (!planChunks(cancel)) {
+    ERROR("No entries to process in the campaign");
+    return 1;
+  }
+  if (!openCheckpoint()) {
+    ERROR(std::string("Cannot write checkpoint file: " + fOptions.checkpointFile));
+    return 1;
+  }
+
+  std::vector<size_t> pending;
+  for (size_t chunk = 0; chunk < fChunks.size(); chunk++)
+    if (!fDone[chunk])
+      pending.push_back(chunk);
+  const size_t workers = std::max<size_t>(1, std::min<size_t>(std::max(1, fOptions.workers), pending.size()));
+  if (pending.size() < fChunks.size())
+    std::cout << "resuming: " << fChunks.size() - pending.size() << " of " << fChunks.size()
+              << " chunks done in " << fOptions.checkpointFile << std::endl;
+
+  // contiguous runs of chunks keep every owner reading its files in order
+  fQueues.clear();
+  for (size_t worker = 0; worker < workers; worker++) {
+    fQueues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    const size_t begin = worker * pending.size() / workers;
+    const size_t end = (worker + 1) * pending.size() / workers;
+    fQueues.back()->chunks.assign(pending.begin() + begin, pending.begin() + end);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<size_t> running(workers);
+  std::vector<std::thread> threads;
+  for (size_t worker = 0; worker < workers && !pending.empty(); worker++)
+    threads.push_back(std::thread([this, worker, &cancel, &running] {
+      workerLoop(worker, cancel);
+      running--;
+    }));
+  auto lastProgress = start;
+  while (!threads.empty() && running > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastProgress < std::chrono::seconds(kProgressSeconds))
+      continue;
+    lastProgress = now;
+    INFO(std::string("Campaign: " + std::to_string(fChunksDone) + " of " + std::to_string(pending.size())
+                     + " chunks done, " + std::to_string(fSteals) + " stolen"));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  fCheckpoint.close();
+  double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  report(wallTime);
+  bool complete = std::find(fDone.begin(), fDone.end(), 0) == fDone.end();
+  return complete && !fFailed ? 0 : 1;
+}
+
+bool CampaignProcessor::planChunks(const std::atomic<bool>& cancel)
+{
+  const long long chunkEntries = std::max(1LL, fOptions.chunkEntries);
+  fEntries.clear();
+  fChunks.clear();
+  // only the tree headers are needed here, the workers open the files on their own
+  std::vector<FileMetadata> files = FileProbe::probeAll(fOptions.dataFiles, std::max(1, fOptions.workers), cancel);
+  for (size_t file = 0; file < fOptions.dataFiles.size(); file++) {
+    long long entries = files[file].entries;
+    fEntries.push_back(entries);
+    if (entries <= 0) {
+      ERROR(std::string("No entries in file: " + fOptions.dataFiles[file]));
+      fFailed = true;
+      continue;
+    }
+    for (long long first = 0; first < entries; first += chunkEntries) {
+      Chunk chunk;
+      chunk.file = file;
+      chunk.first = first;
+      chunk.last = std::min(entries, first + chunkEntries) - 1;
+      fChunks.push_back(chunk);
+    }
+  }
+  fResults.assign(fChunks.size(), ChunkResult());
+  fDone.assign(fChunks.size(), 0);
+  return !fChunks.empty();
+}
+
+/// A checkpoint only applies to the same files, unchanged, split the same way.
+std::string CampaignProcessor::describePlan() const
+{
+  std::string plan;
+  ByteWriter writer(plan);
+  writer.put<int64_t>(fOptions.chunkEntries);
+  writer.put<uint64_t>(fOptions.dataFiles.size());
+  for (size_t file = 0; file < fOptions.dataFiles.size(); file++) {
+    long long size = 0, time = 0;
+    CommonTools::getFileStamp(fOptions.dataFiles[file], size, time);
+    writer.putString(fOptions.dataFiles[file]);
+    writer.put<int64_t>(size);
+    writer.put<int64_t>(time);
+    writer.put<int64_t>(fEntries[file]);
+  }
+  return plan;
+}
+
+bool CampaignProcessor::openCheckpoint()
+{
+  if (fOptions.checkpointFile.empty())
+    return true;
+  const std::string plan = describePlan();
+  std::string data(kMagic, sizeof(kMagic));
+  ByteWriter writer(data);
+  writer.putString(plan);
+  {
+    MappedFile file;
+    if (file.open(fOptions.checkpointFile)) {
+      const bool tagged = file.size() >= sizeof(kMagic) && std::memcmp(file.data(), kMagic, sizeof(kMagic)) == 0;
+      ByteReader reader(file.data() + (tagged ? sizeof(kMagic) : 0), tagged ? file.size() - sizeof(kMagic) : 0);
+      std::string storedPlan;
+      if (!tagged || !reader.getString(storedPlan) || storedPlan != plan) {
+        WARNING(std::string("Checkpoint is of another campaign, starting over: " + fOptions.checkpointFile));
+      } else {
+        // a record cut off by a kill fails to read and is dropped
+        uint64_t chunk = 0;
+        ChunkResult result;
+        while (reader.get(chunk) && reader.get(result)) {
+          if (chunk >= fChunks.size() || fDone[chunk])
+            continue;
+          fResults[chunk] = result;
+          fDone[chunk] = 1;
+          writer.put(chunk);
+          writer.put(result);
+        }
+      }
+    }
+  }
+  if (!CommonTools::writeFileAtomically(fOptions.checkpointFile, data))
+    return false;
+  fCheckpoint.open(fOptions.checkpointFile.c_str(), std::ios::binary | std::ios::app);
+  return static_cast<bool>(fCheckpoint);
+}
+
+bool CampaignProcessor::writeCheckpointRecord(size_t chunk, const ChunkResult& result)
+{
+  std::lock_guard<std::mutex> lock(fCheckpointMutex);
+  if (!fCheckpoint.is_open())
+    return true;
+  std::string record;
+  ByteWriter writer(record);
+  writer.put<uint64_t>(chunk);
+  writer.put(result);
+  // flushed record by record, a killed job loses at most the chunks in flight
+  fCheckpoint.write(record.data(), record.size());
+  fCheckpoint.flush();
+  return static_cast<bool>(fCheckpoint);
+}
+
+bool CampaignProcessor::takeChunk(size_t worker, size_t& chunk)
+{
+  {
+    WorkerQueue& own = *fQueues[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.chunks.empty()) {
+      chunk = own.chunks.front();
+      own.chunks.pop_front();
+      return true;
+    }
+  }
+  // no chunks are ever added, so once every queue is empty the work is done
+  while (true) {
+    size_t victim = fQueues.size();
+    size_t mostChunks = 0;
+    for (size_t i = 0; i < fQueues.size(); i++) {
+      if (i == worker)
+        continue;
+      std::lock_guard<std::mutex> lock(fQueues[i]->mutex);
+      if (fQueues[i]->chunks.size() > mostChunks) {
+        mostChunks = fQueues[i]->chunks.size();
+        victim = i;
+      }
+    }
+    if (victim == fQueues.size())
+      return false;
+    std::lock_guard<std::mutex> lock(fQueues[victim]->mutex);
+    if (fQueues[victim]->chunks.empty())
+      continue;
+    chunk = fQueues[victim]->chunks.back();
+    fQueues[victim]->chunks.pop_back();
+    fSteals++;
+    return true;
+  }
+}
+
+void CampaignProcessor::workerLoop(size_t worker, const std::atomic<bool>& cancel)
+{
+  std::unique_ptr<DataProcessor> processor;
+  size_t openedFile = fOptions.dataFiles.size();
+  size_t chunk = 0;
+  while (!cancel && takeChunk(worker, chunk)) {
+    const Chunk& work = fChunks[chunk];
+    const std::string& dataFile = fOptions.dataFiles[work.file];
+    if (work.file != openedFile) {
+      processor.reset(new DataProcessor());
+      processor->setCoincidenceOptions(fOptions.coincidence);
+      openedFile = work.file;
+      if (!processor->openFile(dataFile.c_str())) {
+        ERROR(std::string("Error opening file:" + dataFile));
+        processor.reset();
+      }
+    }
+    if (!processor) {
+      fFailed = true;
+      continue;
+    }
+
+    ChunkResult result = ChunkResult();
+    auto start = std::chrono::steady_clock::now();
+    bool complete = true;
+    for (long long entry = work.first; entry <= work.last && complete; entry++) {
+      DecodedEvent event = processor->decodeEvent(entry);
+      complete = event.valid;
+      result.entries++;
+      result.hits += event.hits.size();
+      result.coincidences += event.coincidences.getNumberOfPairs();
+      result.clusters += event.coincidences.clusters.size();
+      result.bytesRead += event.readStats.bytesRead;
+    }
+    if (!complete) {
+      ERROR(std::string("Cannot read entries " + std::to_string(work.first) + "-" + std::to_string(work.last)
+                        + " of " + dataFile));
+      fFailed = true;
+      continue;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fResults[chunk] = result;
+    fDone[chunk] = 1;
+    fEntriesDone += result.entries;
+    if (!writeCheckpointRecord(chunk, result))
+      WARNING(std::string("Cannot write checkpoint file: " + fOptions.checkpointFile));
+    fChunksDone++;
+  }
+}
+
+CampaignProcessor::ChunkResult CampaignProcessor::getTotal() const
+{
+  ChunkResult total = ChunkResult();
+  for (size_t chunk = 0; chunk < fChunks.size(); chunk++) {
+    if (!fDone[chunk])
+      continue;
+    const ChunkResult& result = fResults[chunk];
+    total.entries += result.entries;
+    total.hits += result.hits;
+    total.coincidences += result.coincidences;
+    total.clusters += result.clusters;
+    total.bytesRead += result.bytesRead;
+    total.seconds += result.seconds;
+  }
+  return total;
+}
+
+void CampaignProcessor::report(double wallTime) const
+{
+  ChunkResult total = ChunkResult();
+  std::vector<ChunkResult> files(fOptions.dataFiles.size(), ChunkResult());
+  std::vector<long long> missing(fOptions.dataFiles.size(), 0);
+  for (size_t chunk = 0; chunk < fChunks.size(); chunk++) {
+    ChunkResult& file = files[fChunks[chunk].file];
+    if (!fDone[chunk]) {
+      missing[fChunks[chunk].file] += fChunks[chunk].last - fChunks[chunk].first + 1;
+      continue;
+    }
+    const ChunkResult& result = fResults[chunk];
+    file.entries += result.entries;
+    file.hits += result.hits;
+    file.coincidences += result.coincidences;
+    file.clusters += result.clusters;
+    file.bytesRead += result.bytesRead;
+    file.seconds += result.seconds;
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    total.entries += files[i].entries;
+    total.hits += files[i].hits;
+    total.coincidences += files[i].coincidences;
+    total.clusters += files[i].clusters;
+    total.bytesRead += files[i].bytesRead;
+    total.seconds += files[i].seconds;
+    std::cout << fOptions.dataFiles[i] << ": " << files[i].entries << " entries, "
+              << files[i].coincidences << " coincidences in " << files[i].clusters << " clusters";
+    if (fEntries[i] <= 0)
+      std::cout << " (unreadable)";
+    else if (missing[i] > 0)
+      std::cout << " (incomplete, " << missing[i] << " entries missing)";
+    std::cout << std::endl;
+  }
+  const size_t cores = std::max<size_t>(1, fQueues.size());
+  double eps = wallTime > 0 ? fEntriesDone / wallTime : 0.;
+  std::cout << "found " << total.coincidences << " coincidences in " << total.clusters << " clusters, "
+            << total.hits << " hits, read " << total.bytesRead / 1024. / 1024. << " MB" << std::endl;
+  std::cout << "processed " << fChunksDone << " chunks (" << fEntriesDone << " entries) in " << wallTime << " s: "
+            << eps << " events/s, " << eps / cores << " events/s per core ("
+            << cores << " workers, " << fSteals << " chunks stolen)" << std::endl;
+  INFO(std::string("Campaign finished, " + CommonTools::doubleToString(eps / cores) + " events/s per core"));
+}
+
+}
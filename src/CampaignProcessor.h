@@ -0,0 +1,120 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file CampaignProcessor.h
+ *  @brief Counts coincidences in many run files on a work stealing thread pool.
+ */
+
+#ifndef CAMPAIGNPROCESSOR_H
+#define CAMPAIGNPROCESSOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CoincidenceFinder.h"
+
+namespace jpet_event_display
+{
+
+struct CampaignOptions
+{
+  std::vector<std::string> dataFiles;
+  int workers = 1;
+  long long chunkEntries = 2000;
+  /// completed chunks are appended here, an existing matching file is resumed
+  std::string checkpointFile;
+  CoincidenceOptions coincidence;
+};
+
+/**
+ * Every file is split into chunks of chunkEntries entries. Each worker gets
+ * a contiguous run of chunks, takes them from the front and, when out of
+ * work, steals from the back of the worker with the most chunks left, so
+ * owners keep reading their files in order while uneven file sizes are
+ * still spread over all cores. Every worker has its own DataProcessor,
+ * reopened only when the next chunk is from another file. Results are
+ * stored per chunk and summed in chunk order, so totals do not depend on
+ * which worker did what.
+ */
+class CampaignProcessor
+{
+public:
+  /// plain values only, written as is to the checkpoint file
+  struct ChunkResult
+  {
+    int64_t entries;
+    int64_t hits;
+    int64_t coincidences;
+    int64_t clusters;
+    int64_t bytesRead;
+    double seconds;
+  };
+
+  explicit CampaignProcessor(const CampaignOptions& options) : fOptions(options) {}
+  /// returns 0 when every chunk was processed, can be used as process exit code
+  int run(const std::atomic<bool>& cancel);
+  /// sum over every finished chunk, also those read from the checkpoint
+  ChunkResult getTotal() const;
+  /// chunks processed by run(), without those read from the checkpoint
+  inline long long getChunksDone() const { return fChunksDone; }
+
+private:
+  CampaignProcessor(const CampaignProcessor&) = delete;
+  CampaignProcessor& operator=(const CampaignProcessor&) = delete;
+
+  struct Chunk
+  {
+    size_t file;
+    long long first;
+    long long last;
+  };
+
+  struct WorkerQueue
+  {
+    std::mutex mutex;
+    std::deque<size_t> chunks;
+  };
+
+  bool planChunks(const std::atomic<bool>& cancel);
+  std::string describePlan() const;
+  /// reads finished chunks of a matching checkpoint, then rewrites it without a torn last record
+  bool openCheckpoint();
+  bool writeCheckpointRecord(size_t chunk, const ChunkResult& result);
+  /// own chunks first, otherwise one stolen from the busiest worker
+  bool takeChunk(size_t worker, size_t& chunk);
+  void workerLoop(size_t worker, const std::atomic<bool>& cancel);
+  void report(double wallTime) const;
+
+  CampaignOptions fOptions;
+  std::vector<long long> fEntries;
+  std::vector<Chunk> fChunks;
+  std::vector<ChunkResult> fResults;
+  std::vector<char> fDone;
+  std::vector<std::unique_ptr<WorkerQueue> > fQueues;
+  /// chunks and entries done by this run, without those read from the checkpoint
+  std::atomic<long long> fChunksDone{0};
+  std::atomic<long long> fEntriesDone{0};
+  std::atomic<long long> fSteals{0};
+  std::atomic<bool> fFailed{false};
+  std::mutex fCheckpointMutex;
+  std::ofstream fCheckpoint;
+};
+
+}
+
+#endif /*  !CAMPAIGNPROCESSOR_H */
@@ -0,0 +1,285 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file ChannelQA.cpp
+ */
+
+#include "ChannelQA.h"
+#include "ByteStream.h"
+#include "DataProcessor.h"
+#include <JPetLoggerInclude.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+namespace jpet_event_display
+{
+
+const double ChannelQA::kDeadSideFraction = 0.1;
+
+namespace
+{
+double median(std::vector<double> values)
+{
+  if (values.empty())
+    return 0.;
+  size_t middle = values.size() / 2;
+  std::nth_element(values.begin(), values.begin() + middle, values.end());
+  double upper = values[middle];
+  if (values.size() % 2)
+    return upper;
+  return (*std::max_element(values.begin(), values.begin() + middle) + upper) / 2.;
+}
+}
+
+bool ChannelQA::run(const std::string& dataFile, const std::atomic<bool>& cancel)
+{
+  clear();
+  fDataFile = dataFile;
+  DataProcessor processor;
+  if (!processor.openFile(dataFile.c_str()))
+    return false;
+  std::map<int, int> strips;
+  for (const auto& angle : processor.getStripAngles())
+    strips[angle.first.first] = std::max(strips[angle.first.first], angle.first.second);
+  setStripsInLayers(strips);
+
+  auto start = std::chrono::steady_clock::now();
+  const long long entries = processor.getNumberOfEvents();
+  for (long long entry = 0; entry < entries; entry++) {
+    if (cancel)
+      return false;
+    if (processor.nthEvent(entry))
+      addEntry(processor.getChannelHits());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  INFO(std::string("Channel QA of " + dataFile + ": " + std::to_string(entries) + " entries in "
+                   + std::to_string(seconds) + " s"));
+  if (fDroppedHits > 0)
+    WARNING(std::string("Channel QA of " + dataFile + ": " + std::to_string(fDroppedHits)
+                        + " hits on strips outside the param bank layout were not counted"));
+  return true;
+}
+
+void ChannelQA::clear()
+{
+  fEntries = 0;
+  fDroppedHits = 0;
+  const StripCounts empty = {{0, 0}, {-1, -1}};
+  for (auto& layer : fCounts)
+    std::fill(layer.begin(), layer.end(), empty);
+}
+
+void ChannelQA::setStripsInLayers(const std::map<int, int>& strips)
+{
+  fStripsInLayers = strips;
+  fCounts.clear();
+  for (const auto& layer : strips) {
+    if (layer.first < 1 || layer.first > kMaxLayers)
+      continue;
+    if (fCounts.size() < static_cast<size_t>(layer.first))
+      fCounts.resize(layer.first);
+    fCounts[layer.first - 1].resize(std::max(0, std::min(layer.second, static_cast<int>(kMaxStrips))));
+  }
+  clear();
+}
+
+ChannelQA::StripCounts* ChannelQA::getCounts(int layer, int strip)
+{
+  if (layer < 1 || strip < 1)
+    return 0;
+  if (fStripsInLayers.empty() && layer <= kMaxLayers && strip <= kMaxStrips) {
+    // no layout, the counters grow with the strips seen
+    const StripCounts empty = {{0, 0}, {-1, -1}};
+    if (fCounts.size() < static_cast<size_t>(layer))
+      fCounts.resize(layer);
+    if (fCounts[layer - 1].size() < static_cast<size_t>(strip))
+      fCounts[layer - 1].resize(strip, empty);
+  }
+  if (static_cast<size_t>(layer) > fCounts.size() || static_cast<size_t>(strip) > fCounts[layer - 1].size())
+    return 0;
+  return &fCounts[layer - 1][strip - 1];
+}
+
+void ChannelQA::addEntry(const ChannelHits& hits)
+{
+  for (size_t i = 0; i < hits.size(); i++) {
+    StripCounts* counts = getCounts(hits.layers[i], hits.strips[i]);
+    if (!counts) {
+      fDroppedHits++;
+      continue;
+    }
+    int side = hits.sides[i] == 'A' ? 0 : 1;
+    if (counts->lastEntry[side] == fEntries)
+      continue;
+    counts->lastEntry[side] = fEntries;
+    counts->fired[side]++;
+  }
+  fEntries++;
+}
+
+std::map<int, int> ChannelQA::getKnownStrips() const
+{
+  if (!fStripsInLayers.empty())
+    return fStripsInLayers;
+  std::map<int, int> strips;
+  for (size_t layer = 0; layer < fCounts.size(); layer++)
+    for (size_t strip = 0; strip < fCounts[layer].size(); strip++)
+      if (fCounts[layer][strip].fired[0] || fCounts[layer][strip].fired[1])
+        strips[layer + 1] = strip + 1;
+  return strips;
+}
+
+/// a strip fired when any of its sides did; the larger count is a lower bound of that
+double ChannelQA::getStripRate(int layerIndex, int stripIndex) const
+{
+  if (fEntries == 0)
+    return 0.;
+  const StripCounts& counts = fCounts[layerIndex][stripIndex];
+  return static_cast<double>(std::max(counts.fired[0], counts.fired[1])) / fEntries;
+}
+
+std::map<std::pair<int, int>, double> ChannelQA::getStripRates() const
+{
+  std::map<std::pair<int, int>, double> rates;
+  for (const auto& layerStrips : getKnownStrips()) {
+    const int layer = layerStrips.first - 1;
+    if (layer < 0 || static_cast<size_t>(layer) >= fCounts.size())
+      continue;
+    const int strips = std::min(layerStrips.second, static_cast<int>(fCounts[layer].size()));
+    for (int strip = 0; strip < strips; strip++)
+      rates[std::make_pair(layer + 1, strip + 1)] = getStripRate(layer, strip);
+  }
+  return rates;
+}
+
+ChannelFlags ChannelQA::findFlags() const
+{
+  ChannelFlags flags;
+  if (fEntries == 0)
+    return flags;
+  for (const auto& layerStrips : getKnownStrips()) {
+    const int layer = layerStrips.first - 1;
+    if (layer < 0 || static_cast<size_t>(layer) >= fCounts.size())
+      continue;
+    const int strips = std::min(layerStrips.second, static_cast<int>(fCounts[layer].size()));
+    if (strips <= 0)
+      continue;
+    std::vector<double> rates(strips);
+    for (int strip = 0; strip < strips; strip++)
+      rates[strip] = getStripRate(layer, strip);
+    const double layerMedian = median(rates);
+    std::vector<double> deviations(strips);
+    for (int strip = 0; strip < strips; strip++)
+      deviations[strip] = std::fabs(rates[strip] - layerMedian);
+    // 1.4826 * MAD estimates sigma of a normal distribution; a floor keeps
+    // perfectly uniform layers from flagging every tiny fluctuation
+    const double spread = std::max(1.4826 * median(deviations), 0.01 * layerMedian);
+
+    for (int strip = 0; strip < strips; strip++) {
+      if (rates[strip] < layerMedian - fK * spread || (rates[strip] == 0. && layerMedian > 0.)) {
+        flags.push_back(ChannelFlag(layer + 1, strip + 1, ChannelFlag::kDead, 0, rates[strip], layerMedian));
+        continue;
+      }
+      if (rates[strip] > layerMedian + fK * spread) {
+        flags.push_back(ChannelFlag(layer + 1, strip + 1, ChannelFlag::kHot, 0, rates[strip], layerMedian));
+        continue;
+      }
+      const StripCounts& counts = fCounts[layer][strip];
+      for (int side = 0; side < 2; side++) {
+        if (counts.fired[side] < kDeadSideFraction * counts.fired[1 - side])
+          flags.push_back(ChannelFlag(layer + 1, strip + 1, ChannelFlag::kDeadSide, side ? 'B' : 'A',
+                                      static_cast<double>(counts.fired[side]) / fEntries, layerMedian));
+      }
+    }
+  }
+  return flags;
+}
+
+std::string ChannelQA::describe(const ChannelFlags& flags, size_t maxLines)
+{
+  static const char* kinds[] = {"dead", "hot", "dead side"};
+  std::ostringstream oss;
+  oss.precision(3);
+  for (size_t i = 0; i < flags.size(); i++) {
+    if (maxLines > 0 && i == maxLines) {
+      oss << "... " << flags.size() - maxLines << " more\n";
+      break;
+    }
+    const ChannelFlag& flag = flags[i];
+    oss << "layer " << flag.layer << " strip " << flag.strip << ": " << kinds[flag.kind];
+    if (flag.side)
+      oss << " " << flag.side;
+    oss << ", rate " << flag.rate << " (median " << flag.layerMedian << ")\n";
+  }
+  return oss.str();
+}
+
+void ChannelQA::serialize(std::string& out) const
+{
+  ByteWriter writer(out);
+  writer.putString(fDataFile);
+  writer.put<double>(fK);
+  writer.put<int64_t>(fEntries);
+  writer.put<uint64_t>(fStripsInLayers.size());
+  for (const auto& layer : fStripsInLayers) {
+    writer.put<int32_t>(layer.first);
+    writer.put<int32_t>(layer.second);
+  }
+  writer.put<int64_t>(fDroppedHits);
+  writer.put<uint64_t>(fCounts.size());
+  for (const auto& layer : fCounts)
+    writer.putVector(layer);
+}
+
+bool ChannelQA::deserialize(const char* data, size_t size)
+{
+  ByteReader reader(data, size);
+  std::string dataFile;
+  reader.getString(dataFile);
+  double k = 0;
+  int64_t entries = 0;
+  uint64_t layers = 0;
+  reader.get(k);
+  reader.get(entries);
+  reader.get(layers);
+  std::map<int, int> stripsInLayers;
+  for (uint64_t i = 0; i < layers && reader.ok(); i++) {
+    int32_t layer = 0, strips = 0;
+    reader.get(layer);
+    reader.get(strips);
+    stripsInLayers[layer] = strips;
+  }
+  int64_t droppedHits = 0;
+  uint64_t countLayers = 0;
+  reader.get(droppedHits);
+  reader.get(countLayers);
+  std::vector<std::vector<StripCounts> > counts;
+  for (uint64_t i = 0; i < countLayers && i < static_cast<uint64_t>(kMaxLayers) && reader.ok(); i++) {
+    counts.push_back(std::vector<StripCounts>());
+    reader.getVector(counts.back());
+  }
+  if (!reader.ok() || countLayers > static_cast<uint64_t>(kMaxLayers)) {
+    clear();
+    return false;
+  }
+  fDataFile = dataFile;
+  fK = k;
+  fEntries = entries;
+  fDroppedHits = droppedHits;
+  fStripsInLayers = stripsInLayers;
+  fCounts.swap(counts);
+  return true;
+}
+
+}
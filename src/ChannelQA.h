@@ -0,0 +1,112 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file ChannelQA.h
+ *  @brief Finds dead and hot strips in one pass over a whole run.
+ */
+
+#ifndef CHANNELQA_H
+#define CHANNELQA_H
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "EventData.h"
+
+namespace jpet_event_display
+{
+
+struct ChannelFlag
+{
+  enum Kind { kDead, kHot, kDeadSide };
+  ChannelFlag(int layer_, int strip_, Kind kind_, char side_, double rate_, double layerMedian_) :
+    layer(layer_), strip(strip_), kind(kind_), side(side_), rate(rate_), layerMedian(layerMedian_) {}
+  int layer;
+  int strip;
+  Kind kind;
+  char side; // 'A' or 'B' for kDeadSide, 0 otherwise
+  double rate;
+  double layerMedian;
+};
+typedef std::vector<ChannelFlag> ChannelFlags;
+
+/**
+ * Counts in how many entries each side of each strip fired. The counters
+ * are sized from the strip layout, so memory does not grow with the run;
+ * hits outside the layout are only counted as such. A strip is flagged when
+ * its rate is outside median +- k * MAD of its layer, one side of a strip
+ * when it fired in less than kDeadSideFraction of the entries of the other.
+ */
+class ChannelQA
+{
+public:
+  /// without a layout counters grow up to these, a guard against broken hits
+  static const int kMaxLayers = 64;
+  static const int kMaxStrips = 4096;
+
+  explicit ChannelQA(double k = 5.) : fK(k) {}
+
+  /// streams every entry of the file through its own DataProcessor, the layout is taken from its param bank
+  bool run(const std::string& dataFile, const std::atomic<bool>& cancel);
+  /// zeroes the counters, the layout is kept
+  void clear();
+  void addEntry(const ChannelHits& hits);
+  /// layer -> number of strips, from the param bank, clears the counters; without it
+  /// strips up to the highest one seen in a layer are assumed to exist
+  void setStripsInLayers(const std::map<int, int>& strips);
+  ChannelFlags findFlags() const;
+
+  /// (layer, strip) -> fraction of entries in which the strip fired, for every known strip
+  std::map<std::pair<int, int>, double> getStripRates() const;
+  inline long long getNumberOfEntries() const { return fEntries; }
+  /// file scanned by run(), empty for counters filled with addEntry()
+  inline const std::string& getDataFile() const { return fDataFile; }
+  /// hits on strips outside the layout or beyond kMaxLayers / kMaxStrips, not counted
+  inline long long getNumberOfDroppedHits() const { return fDroppedHits; }
+  /// data file, counters and strip layout, for session files
+  void serialize(std::string& out) const;
+  /// replaces the counters, false (and cleared counters) on malformed data
+  bool deserialize(const char* data, size_t size);
+  /// one line per flag, at most maxLines (0 means all)
+  static std::string describe(const ChannelFlags& flags, size_t maxLines = 0);
+
+private:
+  static const double kDeadSideFraction;
+
+  /// plain values only, written as is to session files
+  struct StripCounts
+  {
+    /// entries in which side A / B fired
+    long long fired[2];
+    /// last entry counted per side, so several channels of one side count once
+    long long lastEntry[2];
+  };
+
+  /// counters of the strip, 0 for one outside the layout
+  StripCounts* getCounts(int layer, int strip);
+  std::map<int, int> getKnownStrips() const;
+  double getStripRate(int layerIndex, int stripIndex) const;
+
+  double fK;
+  std::string fDataFile;
+  long long fEntries = 0;
+  long long fDroppedHits = 0;
+  /// [layer - 1][strip - 1]
+  std::vector<std::vector<StripCounts> > fCounts;
+  std::map<int, int> fStripsInLayers;
+};
+
+}
+
+#endif /*  !CHANNELQA_H */
@@ -0,0 +1,107 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file CoincidenceFinder.cpp
+ */
+
+#include "CoincidenceFinder.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace jpet_event_display
+{
+
+namespace
+{
+/// leading edges of both sides of a strip waiting for their partner
+struct OpenStrip
+{
+  double sideA = std::numeric_limits<double>::quiet_NaN();
+  double sideB = std::numeric_limits<double>::quiet_NaN();
+  double lastHit = -std::numeric_limits<double>::infinity();
+};
+}
+
+Coincidences CoincidenceFinder::find(const ChannelHits& sortedHits) const
+{
+  Coincidences result;
+  findStripHits(sortedHits, result.hits);
+  const std::vector<StripHit>& hits = result.hits;
+  if (fAngles.empty())
+    return result;
+
+  size_t begin = 0;
+  while (begin < hits.size()) {
+    size_t end = begin + 1;
+    while (end < hits.size() && hits[end].time - hits[begin].time <= fOptions.coincidenceWindow)
+      end++;
+    CoincidenceCluster cluster;
+    cluster.begin = begin;
+    cluster.end = end;
+    for (size_t i = begin; i < end; i++)
+      for (size_t j = i + 1; j < end; j++)
+        if (areOpposite(hits[i], hits[j]))
+          cluster.pairs.push_back(std::make_pair(i, j));
+    if (!cluster.pairs.empty())
+      result.clusters.push_back(cluster);
+    begin = end;
+  }
+  return result;
+}
+
+void CoincidenceFinder::findStripHits(const ChannelHits& sortedHits, std::vector<StripHit>& stripHits) const
+{
+  std::map<std::pair<int, int>, OpenStrip> openStrips;
+  for (size_t i = 0; i < sortedHits.size(); i++) {
+    if (!sortedHits.leading[i])
+      continue;
+    const double time = sortedHits.times[i];
+    OpenStrip& open = openStrips[std::make_pair(sortedHits.layers[i], sortedHits.strips[i])];
+    // higher thresholds of a signal already paired
+    if (time - open.lastHit <= fOptions.sideWindow)
+      continue;
+    double& side = sortedHits.sides[i] == 'A' ? open.sideA : open.sideB;
+    double& other = sortedHits.sides[i] == 'A' ? open.sideB : open.sideA;
+    // keep the earliest edge, i.e. the lowest threshold crossing
+    if (std::isnan(side) || time - side > fOptions.sideWindow)
+      side = time;
+    if (std::isnan(other))
+      continue;
+    if (time - other > fOptions.sideWindow) {
+      other = std::numeric_limits<double>::quiet_NaN();
+      continue;
+    }
+    stripHits.push_back(StripHit(sortedHits.layers[i], sortedHits.strips[i],
+                                 (open.sideA + open.sideB) / 2., open.sideA - open.sideB));
+    open.lastHit = time;
+    open.sideA = open.sideB = std::numeric_limits<double>::quiet_NaN();
+  }
+  // mean times are emitted in the order of the later side, nearly sorted already
+  std::stable_sort(stripHits.begin(), stripHits.end(),
+                   [](const StripHit& a, const StripHit& b) { return a.time < b.time; });
+}
+
+bool CoincidenceFinder::areOpposite(const StripHit& first, const StripHit& second) const
+{
+  if (first.layer == second.layer && first.strip == second.strip)
+    return false;
+  auto firstAngle = fAngles.find(std::make_pair(first.layer, first.strip));
+  auto secondAngle = fAngles.find(std::make_pair(second.layer, second.strip));
+  if (firstAngle == fAngles.end() || secondAngle == fAngles.end())
+    return false;
+  double difference = std::fmod(std::fabs(firstAngle->second - secondAngle->second), 360.);
+  difference = std::min(difference, 360. - difference);
+  return std::fabs(difference - 180.) <= fOptions.angleTolerance;
+}
+
+}
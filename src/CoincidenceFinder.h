@@ -0,0 +1,73 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file CoincidenceFinder.h
+ *  @brief Groups signal channels of a time window into coincidences.
+ */
+
+#ifndef COINCIDENCEFINDER_H
+#define COINCIDENCEFINDER_H
+
+#include <map>
+#include <utility>
+
+#include "EventData.h"
+
+namespace jpet_event_display
+{
+
+/// all times in ps, as in JPetSigCh
+struct CoincidenceOptions
+{
+  double sideWindow = 5000.;        // max |tA - tB| of the two sides of one strip
+  double coincidenceWindow = 3000.; // max time between hits of one cluster
+  double angleTolerance = 30.;      // max deviation from back to back [deg]
+};
+
+/// (layer, strip) -> azimuthal angle of the strip [deg]
+typedef std::map<std::pair<int, int>, double> StripAngles;
+
+/**
+ * Works on hits sorted by time in two sweeps. The first pairs the earliest
+ * leading edges of side A and B of every strip into strip hits, the second
+ * opens a cluster at the first strip hit not yet clustered and closes it
+ * coincidenceWindow later. Strip hits come out of the first sweep in the
+ * order of their later side, so they are re-sorted by mean time in between;
+ * they are at most sideWindow / 2 out of place. Pairs of a cluster are hits
+ * on different strips which are back to back within angleTolerance, all
+ * k * (k - 1) / 2 candidates of a cluster of k hits are checked. Without
+ * strip angles, e.g. for event selection files, only strip hits are found.
+ */
+class CoincidenceFinder
+{
+public:
+  CoincidenceFinder() {}
+
+  inline void setOptions(const CoincidenceOptions& options) { fOptions = options; }
+  inline const CoincidenceOptions& getOptions() const { return fOptions; }
+  inline void setStripAngles(const StripAngles& angles) { fAngles = angles; }
+  inline const StripAngles& getStripAngles() const { return fAngles; }
+  inline bool hasStripAngles() const { return !fAngles.empty(); }
+
+  Coincidences find(const ChannelHits& sortedHits) const;
+
+private:
+  void findStripHits(const ChannelHits& sortedHits, std::vector<StripHit>& stripHits) const;
+  bool areOpposite(const StripHit& first, const StripHit& second) const;
+
+  CoincidenceOptions fOptions;
+  StripAngles fAngles;
+};
+
+}
+
+#endif /*  !COINCIDENCEFINDER_H */
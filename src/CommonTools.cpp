@@ -15,6 +15,10 @@
 
 #include <sstream>
 #include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
 #include <JPetLoggerInclude.h>
 #include "./CommonTools.h"
 
@@ -64,6 +68,82 @@ int CommonTools::stringToInt(const std::string& str) {
   return num;
 }
 // __________________________________________________________________________
+bool CommonTools::isDirectory(const std::string& path) {
+  boost::system::error_code error;
+  return boost::filesystem::is_directory(path, error);
+}
+// __________________________________________________________________________
+std::string CommonTools::findNewestFile(const std::string& directory,
+                                        const std::string& extension) {
+  namespace fs = boost::filesystem;
+  boost::system::error_code error;
+  std::string newest;
+  std::time_t newestTime = 0;
+  for (fs::directory_iterator it(directory, error), end; !error && it != end;
+       it.increment(error)) {
+    if (!fs::is_regular_file(it->status()) ||
+        it->path().extension().string() != extension)
+      continue;
+    std::time_t modified = fs::last_write_time(it->path(), error);
+    if (!error && (newest.empty() || modified >= newestTime)) {
+      newest = it->path().string();
+      newestTime = modified;
+    }
+  }
+  return newest;
+}
+// __________________________________________________________________________
+std::vector<std::string> CommonTools::listFiles(const std::string& directory,
+                                               const std::string& extension) {
+  namespace fs = boost::filesystem;
+  boost::system::error_code error;
+  std::vector<std::string> files;
+  for (fs::directory_iterator it(directory, error), end; !error && it != end;
+       it.increment(error)) {
+    if (fs::is_regular_file(it->status()) &&
+        it->path().extension().string() == extension)
+      files.push_back(it->path().string());
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+// __________________________________________________________________________
+bool CommonTools::getFileStamp(const std::string& filename, long long& size,
+                               long long& time) {
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0)
+    return false;
+  size = info.st_size;
+  time = info.st_mtime;
+  return true;
+}
+// __________________________________________________________________________
+bool CommonTools::writeFileAtomically(const std::string& filename,
+                                      const std::string& data) {
+  const std::string temporary = filename + ".tmp";
+  std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+  out.write(data.data(), data.size());
+  // errors of the last buffered write only show up when closing
+  out.close();
+  if (!out || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+// __________________________________________________________________________
+bool CommonTools::readFile(const std::string& filename, std::string& data) {
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  if (!in)
+    return false;
+  std::ostringstream content;
+  content << in.rdbuf();
+  if (in.bad())
+    return false;
+  data = content.str();
+  return true;
+}
+// __________________________________________________________________________
 bool CommonTools::isStringOnlyPath(const std::string& str) {
   std::string OutFileName;
   size_t i = str.find_last_of("\\/:");
@@ -22,6 +22,7 @@
 #include <cmath>
 #include <cassert>
 #include <algorithm>
+#include <vector>
 
 class CommonTools {
  public :
@@ -33,6 +34,18 @@ class CommonTools {
   // Convert double without floating point part (mantissa) to string
   static std::string doubleToString(double x);  
   static int stringToInt(const std::string& str);
+  static bool isDirectory(const std::string& path);
+  /// most recently modified regular file in directory with given extension, empty if none
+  static std::string findNewestFile(const std::string& directory, const std::string& extension);
+  /// regular files in directory with given extension, sorted by name
+  static std::vector<std::string> listFiles(const std::string& directory, const std::string& extension);
+  /// size and modification time of a file, false if it does not exist
+  static bool getFileStamp(const std::string& filename, long long& size, long long& time);
+  /// writes data to filename.tmp and renames it over filename only if every byte reached the disk,
+  /// so a crash or a full disk never leaves a truncated file behind
+  static bool writeFileAtomically(const std::string& filename, const std::string& data);
+  /// whole content of a file, false if it cannot be read
+  static bool readFile(const std::string& filename, std::string& data);
 
  private:
   CommonTools();
@@ -13,164 +13,163 @@
  */
 
 #include "./DataProcessor.h"
+#include "./ReaderPool.h"
+#include <JPetLoggerInclude.h>
+#include <RVersion.h>
+#include <TFile.h>
+#include <TROOT.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 namespace jpet_event_display
 {
 
+DataProcessor::DataProcessor()
+{
+}
+
+DataProcessor::~DataProcessor()
+{
+}
+
 ScintillatorsInLayers DataProcessor::getActiveScintillators()
 {
-  ScintillatorsInLayers selection;
+  ScintillatorsInLayers selection = selectionFromHits(getChannelHits());
+  activedScintilators = describeSelection(selection);
+  return selection;
+}
+
+ScintillatorsInLayers DataProcessor::getActiveScintillators(const JPetTimeWindow& tWindow)
+{
+  ScintillatorsInLayers selection = selectionFromHits(getChannelHits(tWindow));
+  activedScintilators = describeSelection(selection);
+  return selection;
+}
+
+ScintillatorsInLayers
+DataProcessor::getActiveScintillators(const JPetRawSignal &rawSignal)
+{
+  ScintillatorsInLayers selection = selectionFromHits(getChannelHits(rawSignal));
+  activedScintilators = describeSelection(selection);
+  return selection;
+}
+
+DiagramSignals DataProcessor::getDataForDiagram()
+{
+  return diagramFromHits(getChannelHits());
+}
+
+DiagramSignals DataProcessor::getDataForDiagram(const JPetTimeWindow& tWindow)
+{
+  return diagramFromHits(getChannelHits(tWindow));
+}
+
+DiagramSignals DataProcessor::getDataForDiagram(const JPetRawSignal &rawSignal)
+{
+  return diagramFromHits(getChannelHits(rawSignal));
+}
+
+ChannelHits DataProcessor::getChannelHits()
+{
+  ChannelHits hits;
   switch(fCurrentFileType)
   {
     case FileTypes::fTimeWindow :
-      selection = getActiveScintillators(
+      hits = getChannelHits(
           dynamic_cast<JPetTimeWindow &>(fReader.getCurrentEvent()));
       break;
     case FileTypes::fRawSignal :
-      selection = getActiveScintillators(
+      hits = getChannelHits(
           dynamic_cast<JPetRawSignal &>(fReader.getCurrentEvent()));
       break;
+    case FileTypes::fEventSelection :
+      fSelectionFile->readEvent(fCurrentEntry, hits);
+      break;
     default:
       break;
   }
-
-  return selection;
+  return hits;
 }
 
-ScintillatorsInLayers DataProcessor::getActiveScintillators(const JPetTimeWindow& tWindow)
+long long DataProcessor::getTimeWindowIndex()
 {
-  auto sigChannels = tWindow.getSigChVect();
-  ScintillatorsInLayers selection;
-  for (const auto & channel : sigChannels) {
-    auto PM = channel.getPM();
-    if(PM.isNullObject()) {
-      continue;
-    }
-    auto scin = PM.getScin();
-    if(scin.isNullObject()) {
-      continue;
-    }
-    auto scinId = scin.getID();
-    auto barrel = scin.getBarrelSlot();
-    if (barrel.isNullObject()) {
-      continue;
-    }
-    StripPos pos = fMapper->getStripPos(barrel);
-
-    if (selection.find(pos.layer) != selection.end()) {
-      if (std::find(selection[pos.layer].begin(), selection[pos.layer].end(),
-                    pos.slot) == selection[pos.layer].end())
-        selection[pos.layer].push_back(pos.slot);
-    } else {
-      selection[pos.layer] = {pos.slot};
-    }
-  }
-
-  std::ostringstream oss;
-  for (auto iter = selection.begin(); iter != selection.end(); ++iter) {
-    int layer = iter->first;
-    const std::vector<int> &strips = iter->second;
-    for (auto stripIter = strips.begin(); stripIter != strips.end();
-         ++stripIter) {
-      oss << "layer: " << layer << " scin: " << *stripIter << "\n";
-    }
+  switch(fCurrentFileType)
+  {
+    case FileTypes::fTimeWindow :
+      return dynamic_cast<JPetTimeWindow &>(fReader.getCurrentEvent()).getIndex();
+    case FileTypes::fRawSignal :
+      return dynamic_cast<JPetRawSignal &>(fReader.getCurrentEvent()).getTimeWindowIndex();
+    default:
+      return -1;
   }
-  activedScintilators = oss.str();
-  return selection;
 }
 
-ScintillatorsInLayers
-DataProcessor::getActiveScintillators(const JPetRawSignal &rawSignal)
+ChannelHits DataProcessor::getChannelHits(const JPetTimeWindow& tWindow)
 {
-  auto leadingSigCh = rawSignal.getPoints(JPetSigCh::Leading);
-  auto trailingSigCh = rawSignal.getPoints(JPetSigCh::Trailing);
-  ScintillatorsInLayers selection;
-  for (const auto &channel : leadingSigCh) {
-    auto PM = channel.getPM();
-    if (PM.isNullObject()) {
-      continue;
-    }
-    auto scin = PM.getScin();
-    if (scin.isNullObject()) {
-      continue;
-    }
-    auto scinId = scin.getID();
-    auto barrel = scin.getBarrelSlot();
-    if (barrel.isNullObject()) {
-      continue;
-    }
-    StripPos pos = fMapper->getStripPos(barrel);
-
-    if (selection.find(pos.layer) != selection.end()) {
-      if (std::find(selection[pos.layer].begin(), selection[pos.layer].end(),
-                    pos.slot) == selection[pos.layer].end())
-        selection[pos.layer].push_back(pos.slot);
-    } else {
-      selection[pos.layer] = {pos.slot};
-    }
-  }
-
-  for (const auto &channel : trailingSigCh) {
-    auto PM = channel.getPM();
-    if (PM.isNullObject()) {
-      continue;
-    }
-    auto scin = PM.getScin();
-    if (scin.isNullObject()) {
-      continue;
-    }
-    auto scinId = scin.getID();
-    auto barrel = scin.getBarrelSlot();
-    if (barrel.isNullObject()) {
-      continue;
-    }
-    StripPos pos = fMapper->getStripPos(barrel);
-
-    if (selection.find(pos.layer) != selection.end()) {
-      if (std::find(selection[pos.layer].begin(), selection[pos.layer].end(),
-                    pos.slot) == selection[pos.layer].end())
-        selection[pos.layer].push_back(pos.slot);
-    } else {
-      selection[pos.layer] = {pos.slot};
-    }
-  }
-
-  std::ostringstream oss;
-  for (auto iter = selection.begin(); iter != selection.end(); ++iter) {
-    int layer = iter->first; // table start form 0, layers from 1
-    const std::vector<int> &strips = iter->second;
-    for (auto stripIter = strips.begin(); stripIter != strips.end();
-         ++stripIter) {
-      oss << "layer: " << layer << " scin: " << *stripIter << "\n";
-    }
-  }
-  activedScintilators = oss.str();
-  return selection;
+  ChannelHits hits;
+  for (const auto & channel : tWindow.getSigChVect())
+    addChannelHit(channel, hits);
+  return hits;
 }
 
-DiagramDataMap DataProcessor::getDataForDiagram() 
-{ 
-  DiagramDataMap data;
-  if (fCurrentFileType == FileTypes::fRawSignal)
-    data = getDataForDiagram(
-        dynamic_cast<JPetRawSignal &>(fReader.getCurrentEvent()));
-
-  return data;
+ChannelHits DataProcessor::getChannelHits(const JPetRawSignal &rawSignal)
+{
+  ChannelHits hits;
+  for (const auto &channel : rawSignal.getPoints(JPetSigCh::Leading))
+    addChannelHit(channel, hits);
+  for (const auto &channel : rawSignal.getPoints(JPetSigCh::Trailing))
+    addChannelHit(channel, hits);
+  return hits;
 }
 
-DiagramDataMap DataProcessor::getDataForDiagram(const JPetRawSignal &rawSignal)
+void DataProcessor::addChannelHit(const JPetSigCh &channel, ChannelHits &hits)
 {
-  return rawSignal.getTimesVsThresholdValue(JPetSigCh::Leading);
+  auto PM = channel.getPM();
+  if (PM.isNullObject()) {
+    return;
+  }
+  auto scin = PM.getScin();
+  if (scin.isNullObject()) {
+    return;
+  }
+  auto barrel = scin.getBarrelSlot();
+  if (barrel.isNullObject()) {
+    return;
+  }
+  StripPos pos = fMapper->getStripPos(barrel);
+  hits.add(pos.layer, pos.slot, PM.getID(), PM.getSide() == JPetPM::SideA ? 'A' : 'B',
+           channel.getType() == JPetSigCh::Leading, channel.getValue(), channel.getThreshold());
 }
 
 bool DataProcessor::openFile(const char *filename) {
-  static std::map<std::string, int> compareMap;
-  if (compareMap.empty())
+  // nothing of the previous file stays open, whether it was a ROOT file or a selection
+  closeFile();
+  // initialised once even when several threads open files at the same time
+  static const std::map<std::string, int> compareMap = {
+    {"JPetTimeWindow", FileTypes::fTimeWindow},
+    {"JPetRawSignal", FileTypes::fRawSignal}
+  };
+  // exported selections need neither the framework reader nor the param bank
+  if (EventSelectionFile::isEventSelectionFile(filename))
   {
-    compareMap["JPetTimeWindow"] = FileTypes::fTimeWindow;
-    compareMap["JPetRawSignal"] = FileTypes::fRawSignal;
+    fSelectionFile = std::unique_ptr<EventSelectionFile>(new EventSelectionFile());
+    bool opened = fSelectionFile->open(filename);
+    fCurrentFileType = opened ? FileTypes::fEventSelection : FileTypes::fNone;
+    fNumberOfEventsInFile = opened ? fSelectionFile->getNumberOfEvents() : 0;
+    fCurrentEntry = 0;
+    // the selection has no param bank, angles of a previous file may not match its detector
+    fCoincidenceFinder.setStripAngles(StripAngles());
+    if (opened) {
+      WARNING("No strip angles in an event selection file, coincidences are not paired");
+      setFileName(filename);
+    }
+    return opened;
   }
+  fAccessPattern = kUnknownAccess;
+  fLastEntry = -1;
+  fLastStride = 0;
   bool r = fReader.openFileAndLoadData(filename);
   fNumberOfEventsInFile = fReader.getNbOfAllEvents();
   if(r)
@@ -179,7 +178,13 @@ bool DataProcessor::openFile(const char *filename) {
     TObjArray *arr = fTree->GetListOfBranches();
     TBranch *fBranch = dynamic_cast<TBranch*>(arr->At(0));
     const char *branchName = fBranch->GetClassName();
-    switch(compareMap[branchName])
+    // nothing but the event branch is ever read or prefetched
+    fEventBranchName = fBranch->GetName();
+    fTree->SetBranchStatus("*", 0);
+    fTree->SetBranchStatus((fEventBranchName + "*").c_str(), 1);
+    resetPerfStats(fTree);
+    auto type = compareMap.find(branchName);
+    switch(type == compareMap.end() ? FileTypes::fNone : type->second)
     {
       case FileTypes::fTimeWindow:
         fCurrentFileType = FileTypes::fTimeWindow;
@@ -198,36 +203,243 @@ bool DataProcessor::openFile(const char *filename) {
     JPetParamBank *bank2 =
         dynamic_cast<JPetParamBank *>(fReader.getObjectFromFile("ParamBank"));
     fMapper = std::unique_ptr<JPetGeomMapping>(new JPetGeomMapping(bank));
+    StripAngles angles;
+    for (const auto &slot : bank.getBarrelSlots()) {
+      StripPos pos = fMapper->getStripPos(*slot.second);
+      angles[std::make_pair(pos.layer, pos.slot)] = slot.second->getTheta();
+    }
+    fCoincidenceFinder.setStripAngles(angles);
+    setFileName(filename);
   }
   return r;
 }
 
+long long DataProcessor::refreshEntries()
+{
+  if (fCurrentFileType == FileTypes::fEventSelection)
+    return fNumberOfEventsInFile;
+  // the reader keeps the same TTree object, Refresh() updates it in place
+  // with the baskets flushed since the last call, without reopening the file
+  TTree *tree = dynamic_cast<TTree *>(fReader.getObjectFromFile("tree"));
+  if (tree) {
+    tree->Refresh();
+    fNumberOfEventsInFile = tree->GetEntries();
+  }
+  return fNumberOfEventsInFile;
+}
+
 void DataProcessor::closeFile()
 {
+  {
+    std::lock_guard<std::mutex> lock(fReaderPoolMutex);
+    fReaderPool.reset();
+    fFileName.clear();
+  }
+  if (fSelectionFile) {
+    fSelectionFile.reset();
+    fCurrentFileType = FileTypes::fNone;
+    return;
+  }
+  if (TTree *tree = getTree())
+    tree->SetPerfStats(0);
+  fPerfStats.reset();
+  fReadCacheSize = 0;
   fReader.closeFile();
 }
 
+void DataProcessor::setFileName(const std::string& filename)
+{
+  std::lock_guard<std::mutex> lock(fReaderPoolMutex);
+  fFileName = filename;
+}
+
+TTree *DataProcessor::getTree()
+{
+  if (fCurrentFileType != FileTypes::fTimeWindow && fCurrentFileType != FileTypes::fRawSignal)
+    return 0;
+  return dynamic_cast<TTree *>(fReader.getObjectFromFile("tree"));
+}
+
+void DataProcessor::resetPerfStats(TTree *tree)
+{
+  // only the unzip time is used, its graphs would otherwise grow for as long as the file is read
+  tree->SetPerfStats(0);
+  fPerfStats.reset();
+  fPerfStats = std::unique_ptr<TTreePerfStats>(new TTreePerfStats("ioperf", tree));
+  fPerfStatsEntries = 0;
+}
+
+void DataProcessor::updateAccessPattern(long long entry)
+{
+  long long stride = entry - fLastEntry;
+  AccessPattern pattern = kRandomAccess;
+  if (fLastEntry >= 0 && stride == 1)
+    pattern = kSequentialAccess;
+  else if (fLastEntry >= 0 && stride > 1 && stride == fLastStride)
+    pattern = kStridedAccess;
+  fLastEntry = entry;
+  fLastStride = stride;
+  if (pattern == fAccessPattern)
+    return;
+  fAccessPattern = pattern;
+  configureReading(entry);
+}
+
+/// Sequential stepping (and short strides) read whole clusters ahead through
+/// a TTreeCache. Long strides and jumps would only prefetch baskets that are
+/// never used, so they read the needed baskets directly.
+void DataProcessor::configureReading(long long entry)
+{
+  TTree *tree = getTree();
+  if (!tree)
+    return;
+  bool cached = fAccessPattern == kSequentialAccess ||
+                (fAccessPattern == kStridedAccess && fLastStride <= kMaxCachedStride);
+  if (cached) {
+    tree->SetCacheSize(kSequentialCacheSize);
+    tree->SetCacheLearnEntries(kCacheLearnEntries);
+    tree->AddBranchToCache((fEventBranchName + "*").c_str(), kTRUE);
+    tree->SetCacheEntryRange(entry, fNumberOfEventsInFile);
+  } else {
+    tree->SetCacheSize(0);
+  }
+  fReadCacheSize = tree->GetCacheSize();
+}
+
+bool DataProcessor::enableImplicitMT(unsigned threads)
+{
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 8, 0)
+  ROOT::EnableImplicitMT(threads);
+  return true;
+#else
+  WARNING("Implicit multithreading needs ROOT 6.08 or newer");
+  return false;
+#endif
+}
+
 bool DataProcessor::nextEvent()
 {
+  if (fCurrentFileType == FileTypes::fEventSelection)
+    return nthEvent(fCurrentEntry + 1);
   return fReader.nextEvent();
 }
 
 bool DataProcessor::firstEvent()
 {
+  if (fCurrentFileType == FileTypes::fEventSelection)
+    return nthEvent(0);
   return fReader.firstEvent();
 }
 
 bool DataProcessor::lastEvent()
 {
+  if (fCurrentFileType == FileTypes::fEventSelection)
+    return nthEvent(fNumberOfEventsInFile - 1);
   return fReader.lastEvent();
 }
 
 bool DataProcessor::nthEvent(long long n)
 {
-  if (n < fNumberOfEventsInFile)
-    return fReader.nthEvent(n);
+  if (n < 0 || n >= fNumberOfEventsInFile)
+    return false;
+  if (fCurrentFileType == FileTypes::fEventSelection) {
+    fCurrentEntry = n;
+    return true;
+  }
+  updateAccessPattern(n);
+  TTree *tree = getTree();
+  TFile *file = tree ? tree->GetCurrentFile() : 0;
+  if (tree && ++fPerfStatsEntries > kPerfStatsResetEntries)
+    resetPerfStats(tree);
+  const long long bytesBefore = file ? file->GetBytesRead() : 0;
+  const double unzipBefore = fPerfStats ? fPerfStats->GetUnzipTime() : 0.;
+  auto start = std::chrono::steady_clock::now();
+  bool read = fReader.nthEvent(n);
+  fLastReadStats.readSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fLastReadStats.bytesRead = file ? file->GetBytesRead() - bytesBefore : 0;
+  fLastReadStats.unzipSeconds = fPerfStats ? fPerfStats->GetUnzipTime() - unzipBefore : 0.;
+  fTotalBytesRead += fLastReadStats.bytesRead;
+  return read;
+}
+
+DecodedEvent DataProcessor::decodeEvent(long long n)
+{
+  DecodedEvent event;
+  event.entry = n;
+  if (!nthEvent(n))
+    return event;
+  event.hits = getChannelHits();
+  sortHitsByTime(event.hits);
+  event.selection = selectionFromHits(event.hits);
+  event.diagram = diagramFromHits(event.hits);
+  event.readStats = fLastReadStats;
+  event.coincidences = fCoincidenceFinder.find(event.hits);
+  activedScintilators = describeSelection(event.selection);
+  event.info = getDataInfo() + "coincidences: ";
+  if (fCoincidenceFinder.hasStripAngles())
+    event.info += std::to_string(event.coincidences.getNumberOfPairs())
+                  + " in " + std::to_string(event.coincidences.clusters.size()) + " clusters\n";
   else
+    event.info += "no strip angles\n";
+  if (fCurrentFileType != FileTypes::fEventSelection) {
+    static const char *patterns[] = {"unknown", "sequential", "strided", "random"};
+    std::ostringstream oss;
+    oss.precision(3);
+    oss << "read: " << fLastReadStats.bytesRead / 1024. << " kB in "
+        << fLastReadStats.readSeconds * 1000. << " ms\n"
+        << "unzip: " << fLastReadStats.unzipSeconds * 1000. << " ms ("
+        << patterns[fAccessPattern] << ")\n";
+    event.info += oss.str();
+  }
+  event.valid = true;
+  return event;
+}
+
+std::shared_ptr<const DecodedEvent> DataProcessor::decode(long long n) const
+{
+  std::shared_ptr<ReaderPool> pool;
+  {
+    std::lock_guard<std::mutex> lock(fReaderPoolMutex);
+    if (!fReaderPool && !fFileName.empty()) {
+      const size_t readers = std::min(static_cast<size_t>(kMaxPooledReaders),
+                                      static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency())));
+      fReaderPool = std::make_shared<ReaderPool>(fFileName, fCoincidenceFinder.getOptions(), readers);
+    }
+    pool = fReaderPool;
+  }
+  // entries out of range come back invalid from the pooled reader
+  if (!pool) {
+    std::shared_ptr<DecodedEvent> event = std::make_shared<DecodedEvent>();
+    event->entry = n;
+    return event;
+  }
+  return pool->decode(n);
+}
+
+bool DataProcessor::exportEventSelection(const std::string& outputFile)
+{
+  EventSelectionWriter writer;
+  if (fNumberOfEventsInFile <= 0 || !writer.open(outputFile))
     return false;
+  for (long long entry = 0; entry < fNumberOfEventsInFile; entry++) {
+    if (!nthEvent(entry)) {
+      // nothing is left at outputFile instead of a valid looking file with the events read so far
+      ERROR(std::string("Cannot read entry " + std::to_string(entry) + ", export aborted"));
+      writer.abort();
+      return false;
+    }
+    writer.addEvent(getChannelHits());
+  }
+  return writer.close();
+}
+
+void DataProcessor::setCoincidenceOptions(const CoincidenceOptions& options)
+{
+  std::lock_guard<std::mutex> lock(fReaderPoolMutex);
+  fCoincidenceFinder.setOptions(options);
+  if (fReaderPool)
+    fReaderPool->setCoincidenceOptions(options);
 }
 
 std::string DataProcessor::getDataInfo() { return activedScintilators; }
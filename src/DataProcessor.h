@@ -19,7 +19,13 @@
 #include <sstream> //TO delete
 #include <string>
 #include <vector>
+#include "EventData.h"
 #ifndef __CINT__
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "CoincidenceFinder.h"
+#include "EventSelectionFile.h"
 #include <JPetGeomMapping/JPetGeomMapping.h>
 #include <JPetGeomMappingInterface/JPetGeomMappingInterface.h>
 #include <JPetParamGetterAscii/JPetParamGetterAscii.h>
@@ -29,24 +35,31 @@
 #include <JPetReader/JPetReader.h>
 #include <JPetTimeWindow/JPetTimeWindow.h>
 #include <JPetTreeHeader/JPetTreeHeader.h>
+#include <TTreePerfStats.h>
 #endif
 
 namespace jpet_event_display
 {
 
-typedef std::map<int, std::vector<int> > ScintillatorsInLayers;
-typedef std::map<int, std::pair<float, float>> DiagramDataMap;
+class ReaderPool;
 
 class DataProcessor {
 public:
-  DataProcessor() {}
-  enum FileTypes { fNone, fTimeWindow, fRawSignal };
+  DataProcessor();
+  ~DataProcessor();
+  enum FileTypes { fNone, fTimeWindow, fRawSignal, fEventSelection };
+  /// guessed from the distance between consecutive nthEvent calls
+  enum AccessPattern { kUnknownAccess, kSequentialAccess, kStridedAccess, kRandomAccess };
   /// this method should probably be in some other class
   ScintillatorsInLayers getActiveScintillators();
   ScintillatorsInLayers getActiveScintillators(const JPetTimeWindow& tWindow);
   ScintillatorsInLayers getActiveScintillators(const JPetRawSignal& rawSignal);
-  DiagramDataMap getDataForDiagram();
-  DiagramDataMap getDataForDiagram(const JPetRawSignal &rawSignal);
+  DiagramSignals getDataForDiagram();
+  DiagramSignals getDataForDiagram(const JPetTimeWindow& tWindow);
+  DiagramSignals getDataForDiagram(const JPetRawSignal &rawSignal);
+  ChannelHits getChannelHits();
+  ChannelHits getChannelHits(const JPetTimeWindow& tWindow);
+  ChannelHits getChannelHits(const JPetRawSignal &rawSignal);
 
   bool openFile(const char* filename);
   void closeFile();
@@ -54,8 +67,35 @@ public:
   bool nextEvent();
   bool lastEvent();
   bool nthEvent(long long n);
+  /// moves to entry n and extracts everything needed for drawing it
+  DecodedEvent decodeEvent(long long n);
+  #ifndef __CINT__
+  /// Leaves the cursor alone and may be called from any number of threads,
+  /// also while another one uses the cursor; every call checks out one of
+  /// up to kMaxPooledReaders readers of the open file. Not while the file
+  /// is being opened or closed.
+  std::shared_ptr<const DecodedEvent> decode(long long n) const;
+  #endif
 
   inline FileTypes getCurrentFileType() { return fCurrentFileType; }
+  inline long long getNumberOfEvents() const { return fNumberOfEventsInFile; }
+  /// index of the DAQ time window of the current entry, -1 for files without one
+  long long getTimeWindowIndex();
+  /// rereads the tree header of the open file, for files still being written
+  long long refreshEntries();
+  void setCoincidenceOptions(const CoincidenceOptions& options);
+  /// (layer, strip) -> angle of every strip in the param bank
+  inline const StripAngles& getStripAngles() const { return fCoincidenceFinder.getStripAngles(); }
+  inline AccessPattern getAccessPattern() const { return fAccessPattern; }
+  /// bytes and time spent in the last nthEvent call
+  inline const ReadStats& getLastReadStats() const { return fLastReadStats; }
+  /// safe to call from any thread, also while another one is decoding
+  inline long long getTotalBytesRead() const { return fTotalBytesRead; }
+  inline long long getReadCacheSize() const { return fReadCacheSize; }
+  /// unzips baskets of the event branches in parallel, process wide; call before threads are forked
+  static bool enableImplicitMT(unsigned threads);
+  /// writes every entry of the open file into a columnar EventSelectionFile
+  bool exportEventSelection(const std::string& outputFile);
 
   std::string getDataInfo(); // change when imp new mapper
 
@@ -64,6 +104,25 @@ private:
   DataProcessor(const DataProcessor&) = delete;
   DataProcessor& operator=(const DataProcessor&) = delete;
 
+  void addChannelHit(const JPetSigCh &channel, ChannelHits &hits);
+  TTree *getTree();
+  void updateAccessPattern(long long entry);
+  void configureReading(long long entry);
+  /// fresh perf stats for the tree, the old ones and their graphs are deleted
+  void resetPerfStats(TTree *tree);
+  /// the file decode() reads, set only once the file is open
+  void setFileName(const std::string& filename);
+
+  /// cache for reading entry after entry, baskets are prefetched in big blocks
+  static const Long64_t kSequentialCacheSize = 64 * 1024 * 1024;
+  static const Int_t kCacheLearnEntries = 10;
+  /// strides up to this many entries still mostly hit the same baskets
+  static const long long kMaxCachedStride = 16;
+  /// TTreePerfStats adds graph points on every basket read, so it is replaced after this many entries
+  static const long long kPerfStatsResetEntries = 4096;
+  /// readers opened by decode(), each holds its own param bank and read cache
+  static const size_t kMaxPooledReaders = 8;
+
   std::string activedScintilators; // TODO Change tmp workaround
 
   FileTypes fCurrentFileType = fNone;
@@ -72,6 +131,26 @@ private:
 
   JPetReader fReader;
   std::unique_ptr<JPetGeomMapping> fMapper;
+  /// runs on every decoded entry, strip angles come from the param bank
+  CoincidenceFinder fCoincidenceFinder;
+
+  std::string fEventBranchName;
+  std::unique_ptr<TTreePerfStats> fPerfStats;
+  long long fPerfStatsEntries = 0;
+  AccessPattern fAccessPattern = kUnknownAccess;
+  long long fLastEntry = -1;
+  long long fLastStride = 0;
+  ReadStats fLastReadStats;
+  std::atomic<long long> fTotalBytesRead{0};
+  std::atomic<long long> fReadCacheSize{0};
+
+  /// created by the first decode() on a file, every call keeps it alive while decoding
+  std::string fFileName;
+  mutable std::shared_ptr<ReaderPool> fReaderPool;
+  mutable std::mutex fReaderPoolMutex;
+
+  std::unique_ptr<EventSelectionFile> fSelectionFile;
+  long long fCurrentEntry = 0; // cursor used for fEventSelection files
   #endif
 };
 
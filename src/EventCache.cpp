@@ -0,0 +1,152 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventCache.cpp
+ */
+
+#include "EventCache.h"
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace jpet_event_display
+{
+
+EventCache::EventCache(Decoder decoder, size_t capacity) :
+  fDecoder(decoder), fCapacity(capacity > 0 ? capacity : 1)
+{
+}
+
+EventCache::SnapshotPtr EventCache::get(long long entry)
+{
+  std::promise<SnapshotPtr> promise;
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    auto cached = fIndex.find(entry);
+    if (cached != fIndex.end()) {
+      fHits++;
+      fLruList.splice(fLruList.begin(), fLruList, cached->second);
+      return cached->second->second;
+    }
+    auto inFlight = fInFlight.find(entry);
+    if (inFlight != fInFlight.end()) {
+      fHits++;
+      std::shared_future<SnapshotPtr> pending = inFlight->second;
+      lock.unlock();
+      return pending.get();
+    }
+    fMisses++;
+    fInFlight[entry] = promise.get_future().share();
+  }
+
+  SnapshotPtr result;
+  try {
+    auto snapshot = std::make_shared<EventSnapshot>();
+    snapshot->event = fDecoder(entry);
+    snapshot->json = toJson(*snapshot->event);
+    result = snapshot;
+  } catch (...) {
+    // waiters get the same exception, the next get() tries again
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fInFlight.erase(entry);
+    }
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fInFlight.erase(entry);
+    fLruList.push_front(std::make_pair(entry, result));
+    fIndex[entry] = fLruList.begin();
+    while (fLruList.size() > fCapacity) {
+      fIndex.erase(fLruList.back().first);
+      fLruList.pop_back();
+    }
+  }
+  promise.set_value(result);
+  return result;
+}
+
+size_t EventCache::size()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fLruList.size();
+}
+
+unsigned long long EventCache::getHits()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fHits;
+}
+
+unsigned long long EventCache::getMisses()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fMisses;
+}
+
+namespace
+{
+/// JSON has no NaN or infinity
+void writeNumber(std::ostream& out, double value)
+{
+  if (std::isfinite(value))
+    out << value;
+  else
+    out << "null";
+}
+}
+
+std::string toJson(const DecodedEvent& event)
+{
+  std::ostringstream out;
+  // enough digits to read back the same double, picosecond times are large
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  size_t strips = 0;
+  size_t points = 0;
+  out << "{\"entry\":" << event.entry << ",\"valid\":" << (event.valid ? "true" : "false");
+  out << ",\"layers\":{";
+  for (auto layer = event.selection.begin(); layer != event.selection.end(); ++layer) {
+    out << (layer == event.selection.begin() ? "" : ",") << "\"" << layer->first << "\":[";
+    for (size_t i = 0; i < layer->second.size(); i++)
+      out << (i ? "," : "") << layer->second[i];
+    out << "]";
+    strips += layer->second.size();
+  }
+  out << "},\"diagram\":[";
+  for (size_t i = 0; i < event.diagram.size(); i++) {
+    const DiagramSignal& signal = event.diagram[i];
+    out << (i ? "," : "") << "{\"pm\":" << signal.pmID
+        << ",\"edge\":\"" << (signal.leading ? "leading" : "trailing") << "\",\"t\":[";
+    for (size_t j = 0; j < signal.times.size(); j++) {
+      out << (j ? "," : "");
+      writeNumber(out, signal.times[j]);
+    }
+    out << "],\"thr\":[";
+    for (size_t j = 0; j < signal.thresholds.size(); j++) {
+      out << (j ? "," : "");
+      writeNumber(out, signal.thresholds[j]);
+    }
+    out << "]}";
+    points += signal.times.size();
+  }
+  out << "],\"summary\":{\"layers\":" << event.selection.size()
+      << ",\"strips\":" << strips
+      << ",\"signals\":" << event.diagram.size()
+      << ",\"points\":" << points << "}}";
+  return out.str();
+}
+
+}
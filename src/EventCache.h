@@ -0,0 +1,81 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventCache.h
+ *  @brief Thread safe LRU cache of decoded entries with request coalescing.
+ */
+
+#ifndef EVENTCACHE_H
+#define EVENTCACHE_H
+
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "EventData.h"
+
+namespace jpet_event_display
+{
+
+/// decoded entry together with its serialized form, shared by all readers
+struct EventSnapshot
+{
+  std::shared_ptr<const DecodedEvent> event;
+  std::string json;
+};
+
+/**
+ * Concurrent get() calls for the same entry are coalesced: only the first
+ * one decodes, the others wait for its result. The decoder is called
+ * without the cache lock held. When it throws, the caller and all waiters
+ * for that entry get the exception and nothing is cached.
+ */
+class EventCache
+{
+public:
+  typedef std::function<std::shared_ptr<const DecodedEvent>(long long)> Decoder;
+  typedef std::shared_ptr<const EventSnapshot> SnapshotPtr;
+
+  EventCache(Decoder decoder, size_t capacity);
+
+  SnapshotPtr get(long long entry);
+  size_t size();
+  /// how many get() calls were answered without decoding
+  unsigned long long getHits();
+  unsigned long long getMisses();
+
+private:
+  EventCache(const EventCache&) = delete;
+  EventCache& operator=(const EventCache&) = delete;
+
+  Decoder fDecoder;
+  size_t fCapacity;
+
+  std::mutex fMutex;
+  /// most recently used entry at the front
+  std::list<std::pair<long long, SnapshotPtr> > fLruList;
+  std::map<long long, std::list<std::pair<long long, SnapshotPtr> >::iterator> fIndex;
+  std::map<long long, std::shared_future<SnapshotPtr> > fInFlight;
+  unsigned long long fHits = 0;
+  unsigned long long fMisses = 0;
+};
+
+/// compact JSON: fired strips per layer, diagram points and a short summary
+std::string toJson(const DecodedEvent& event);
+
+}
+
+#endif /*  !EVENTCACHE_H */
@@ -0,0 +1,134 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventData.cpp
+ */
+
+#include "EventData.h"
+#include <algorithm>
+#include <sstream>
+
+namespace jpet_event_display
+{
+
+void ChannelHits::add(int layer, int strip, int pmID, char side, bool isLeading,
+                      double time, float threshold)
+{
+  layers.push_back(layer);
+  strips.push_back(strip);
+  pmIDs.push_back(pmID);
+  sides.push_back(side);
+  leading.push_back(isLeading ? 1 : 0);
+  times.push_back(time);
+  thresholds.push_back(threshold);
+}
+
+void ChannelHits::clear()
+{
+  layers.clear();
+  strips.clear();
+  pmIDs.clear();
+  sides.clear();
+  leading.clear();
+  times.clear();
+  thresholds.clear();
+}
+
+ScintillatorsInLayers selectionFromHits(const ChannelHits& hits)
+{
+  ScintillatorsInLayers selection;
+  for (size_t i = 0; i < hits.size(); i++) {
+    std::vector<int> &strips = selection[hits.layers[i]];
+    if (std::find(strips.begin(), strips.end(), hits.strips[i]) == strips.end())
+      strips.push_back(hits.strips[i]);
+  }
+  return selection;
+}
+
+DiagramSignals diagramFromHits(const ChannelHits& hits)
+{
+  DiagramSignals data;
+  std::map<std::pair<int, bool>, size_t> signalIndex;
+  for (size_t i = 0; i < hits.size(); i++) {
+    auto key = std::make_pair(hits.pmIDs[i], hits.leading[i] != 0);
+    auto found = signalIndex.find(key);
+    if (found == signalIndex.end()) {
+      found = signalIndex.insert(std::make_pair(key, data.size())).first;
+      data.push_back(DiagramSignal());
+      data.back().pmID = key.first;
+      data.back().leading = key.second;
+    }
+    DiagramSignal &signal = data[found->second];
+    signal.times.push_back(hits.times[i]);
+    signal.thresholds.push_back(hits.thresholds[i]);
+  }
+  return data;
+}
+
+namespace
+{
+template <typename T>
+void permute(std::vector<T>& column, const std::vector<size_t>& order)
+{
+  std::vector<T> sorted;
+  sorted.reserve(column.size());
+  for (size_t i : order)
+    sorted.push_back(column[i]);
+  column.swap(sorted);
+}
+}
+
+void sortHitsByTime(ChannelHits& hits)
+{
+  const std::vector<double>& times = hits.times;
+  if (std::is_sorted(times.begin(), times.end()))
+    return;
+  std::vector<size_t> order(hits.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&times](size_t a, size_t b) { return times[a] < times[b]; });
+  permute(hits.layers, order);
+  permute(hits.strips, order);
+  permute(hits.pmIDs, order);
+  permute(hits.sides, order);
+  permute(hits.leading, order);
+  permute(hits.times, order);
+  permute(hits.thresholds, order);
+}
+
+std::pair<size_t, size_t> hitRangeInTime(const ChannelHits& hits, double from, double to)
+{
+  auto first = std::lower_bound(hits.times.begin(), hits.times.end(), from);
+  auto last = std::lower_bound(first, hits.times.end(), to);
+  return std::make_pair(first - hits.times.begin(), last - hits.times.begin());
+}
+
+size_t Coincidences::getNumberOfPairs() const
+{
+  size_t pairs = 0;
+  for (const auto& cluster : clusters)
+    pairs += cluster.pairs.size();
+  return pairs;
+}
+
+std::string describeSelection(const ScintillatorsInLayers& selection)
+{
+  std::ostringstream oss;
+  for (auto iter = selection.begin(); iter != selection.end(); ++iter) {
+    for (auto stripIter = iter->second.begin(); stripIter != iter->second.end(); ++stripIter)
+      oss << "layer: " << iter->first << " scin: " << *stripIter << "\n";
+  }
+  return oss.str();
+}
+
+}
@@ -0,0 +1,132 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventData.h
+ *  @brief Data extracted from a single entry, shared by processing and drawing.
+ */
+
+#ifndef EVENTDATA_H
+#define EVENTDATA_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jpet_event_display
+{
+
+/// layer number (from 1) -> fired strips (from 1)
+typedef std::map<int, std::vector<int> > ScintillatorsInLayers;
+
+/// time vs threshold points of one edge of a signal from a single PM
+struct DiagramSignal
+{
+  DiagramSignal() : pmID(0), leading(true) {}
+  int pmID;
+  bool leading;
+  std::vector<double> times;
+  std::vector<double> thresholds;
+};
+typedef std::vector<DiagramSignal> DiagramSignals;
+
+/// signal channels of an entry stored column wise, one element per channel
+struct ChannelHits
+{
+  std::vector<int> layers;
+  std::vector<int> strips;
+  std::vector<int> pmIDs;
+  std::vector<char> sides;   // 'A' or 'B'
+  std::vector<char> leading; // 1 for leading edge, 0 for trailing
+  std::vector<double> times;
+  std::vector<float> thresholds;
+
+  inline size_t size() const { return times.size(); }
+  void add(int layer, int strip, int pmID, char side, bool isLeading, double time, float threshold);
+  void clear();
+};
+
+/// a strip which became fired or not fired, for incremental view updates
+struct StripChange
+{
+  StripChange(int layer_, int strip_, bool fired_) : layer(layer_), strip(strip_), fired(fired_) {}
+  int layer;
+  int strip;
+  bool fired;
+};
+
+/// unique fired strips per layer, in order of first appearance
+ScintillatorsInLayers selectionFromHits(const ChannelHits& hits);
+/// one signal per PM and edge type, in order of first appearance
+DiagramSignals diagramFromHits(const ChannelHits& hits);
+/// reorders all columns so that times are ascending, equal times keep their order
+void sortHitsByTime(ChannelHits& hits);
+/// [first, last) indices of the hits with from <= time < to, hits have to be sorted by time
+std::pair<size_t, size_t> hitRangeInTime(const ChannelHits& hits, double from, double to);
+/// "layer: x scin: y" lines, shown in the Info tab
+std::string describeSelection(const ScintillatorsInLayers& selection);
+
+/// a strip with leading edges from both sides close enough in time
+struct StripHit
+{
+  StripHit() : layer(0), strip(0), time(0.), timeDifference(0.) {}
+  StripHit(int layer_, int strip_, double time_, double timeDifference_) :
+    layer(layer_), strip(strip_), time(time_), timeDifference(timeDifference_) {}
+  int layer;
+  int strip;
+  double time;           // mean of both sides
+  double timeDifference; // side A - side B
+};
+
+/// strip hits [begin, end) within one coincidence window and the opposite pairs among them
+struct CoincidenceCluster
+{
+  CoincidenceCluster() : begin(0), end(0) {}
+  size_t begin;
+  size_t end;
+  std::vector<std::pair<size_t, size_t> > pairs;
+};
+
+struct Coincidences
+{
+  std::vector<StripHit> hits; // sorted by time
+  std::vector<CoincidenceCluster> clusters;
+
+  size_t getNumberOfPairs() const;
+};
+
+/// I/O spent on reading one entry from the file
+struct ReadStats
+{
+  ReadStats() : bytesRead(0), readSeconds(0.), unzipSeconds(0.) {}
+  long long bytesRead;
+  double readSeconds;  // whole GetEntry, including unzipping and streaming
+  double unzipSeconds; // basket decompression only
+};
+
+/// everything the views need to draw one entry
+struct DecodedEvent
+{
+  DecodedEvent() : entry(-1), valid(false) {}
+  long long entry;
+  bool valid;
+  ScintillatorsInLayers selection;
+  DiagramSignals diagram;
+  ChannelHits hits; // sorted by time
+  Coincidences coincidences;
+  ReadStats readStats;
+  std::string info;
+};
+
+}
+
+#endif /*  !EVENTDATA_H */
@@ -15,6 +15,11 @@
 
 #include "EventDisplay.h"
 #include <JPetLoggerInclude.h>
+#include <TSystem.h>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <sstream>
 
 namespace jpet_event_display
 {
@@ -22,15 +27,25 @@ namespace jpet_event_display
 const char *filetypes[] = {
     "All files", "*",
     "ROOT files", "*.root",
+    "Event selections", "*.sel",
     "Text files", "*.[tT][xX][tT]",
     0, 0};
 
-EventDisplay::EventDisplay() 
+EventDisplay::EventDisplay() : EventDisplay(EventDisplayOptions()) {}
+
+EventDisplay::EventDisplay(const EventDisplayOptions &options) : fOptions(options)
 {
+  logStartupPhase("ROOT initialised");
+  openSession();
+  dataProcessor->setCoincidenceOptions(fOptions.coincidence);
   fGUIControls->eventNo = 0;
   fGUIControls->stepNo = 0;
+  fGUIControls->playbackRate = 10;
+  startPreload();
   run();
+  logStartupPhase("window mapped");
   updateGUIControlls();
+  finishPreload();
   fApplication->Run();
   DATE_AND_TIME();
   INFO("J-PET Event Display created");
@@ -38,6 +53,19 @@ EventDisplay::EventDisplay()
 }
 
 EventDisplay::~EventDisplay() {
+  stopComparison();
+  fFileProbeCancel = true;
+  if (fFileProbeRun.valid())
+    fFileProbeRun.wait();
+  fChannelQACancel = true;
+  if (fChannelQARun.valid())
+    fChannelQARun.wait();
+  fSampleCancel = true;
+  if (fSampleRun.valid())
+    fSampleRun.wait();
+  fIndexCancel = true;
+  if (fIndexBuild.valid())
+    fIndexBuild.wait();
   fMainWindow->Cleanup();
 }
 
@@ -79,6 +107,17 @@ void EventDisplay::run()
   CreateOptionsFrame(optionsFrame); 
   CreateDisplayFrame(displayFrame);
 
+  fStatusBar = std::unique_ptr<TGStatusBar>(new TGStatusBar(baseFrame, w_GlobalFrame, 20));
+  baseFrame->AddFrame(fStatusBar.get(), new TGLayoutHints(kLHintsBottom | kLHintsExpandX, 0, 0, 2, 0));
+
+  fLoaderTimer->Connect("Timeout()", "jpet_event_display::EventDisplay", this, "handleLoadedEvent()");
+  fLoaderTimer->TurnOn();
+  fPlaybackTimer->Connect("Timeout()", "jpet_event_display::EventDisplay", this, "doPlaybackTick()");
+  fLiveTimer->Connect("Timeout()", "jpet_event_display::EventDisplay", this, "doLivePoll()");
+  fResourceTimer->Connect("Timeout()", "jpet_event_display::EventDisplay", this, "doResourceSample()");
+  fLastResourceLog = std::chrono::steady_clock::now();
+  fResourceTimer->TurnOn();
+
   globalFrame->Resize(globalFrame->GetDefaultSize());
   baseFrame->Resize(baseFrame->GetDefaultSize());
 
@@ -96,7 +135,13 @@ void EventDisplay::CreateDisplayFrame(TGGroupFrame* parentFrame) {
   AddTab(fDisplayTabView, visualizator->getCanvas2d(), "2d view", "2dViewCanvas");
   AddTab(fDisplayTabView, visualizator->getCanvasDiagrams(), "Diagram view", "diagramCanvas");
 
+  visualizator->getCanvas2d()->GetCanvas()->Connect(
+      "ProcessedEvent(Int_t,Int_t,Int_t,TObject*)", "jpet_event_display::EventDisplay", this,
+      "handle2dClick(Int_t,Int_t,Int_t,TObject*)");
+
   fDisplayTabView->SetEnabled(1, kTRUE);
+  fDisplayTabView->Connect("Selected(Int_t)", "jpet_event_display::EventDisplay", this, "handleTabSelected(Int_t)");
+  fActiveTab = fDisplayTabView->GetCurrent();
   parentFrame->AddFrame(
       fDisplayTabView.get(), new TGLayoutHints(kLHintsTop | kLHintsExpandX | kLHintsExpandY,
                                    2, 2, 5, 1));
@@ -134,6 +179,92 @@ void EventDisplay::CreateOptionsFrame(TGGroupFrame* parentFrame)
   fInputInfo->SetTextJustify(kTextTop | kTextLeft);
   tabFrame1->AddFrame(fInputInfo.get(), new TGLayoutHints(kLHintsExpandX | kLHintsExpandY,1,1,1,1));
 
+  TGCompositeFrame* tf2 = pTab->AddTab("Strip");
+  tf2->ChangeBackground(fFrameBackgroundColor);
+
+  TGCompositeFrame* tabFrame2 =
+    AddCompositeFrame(tf2, 1, 1, kVerticalFrame, kLHintsExpandX | kLHintsExpandY, 5, 5, 5, 5);
+
+  fStripQueryInfo = std::unique_ptr<TGLabel>(new TGLabel(tabFrame2,
+                                             "Click a strip in the 2d view.",
+                                             TGLabel::GetDefaultGC()(),
+                                             TGLabel::GetDefaultFontStruct(),
+                                             kChildFrame,
+                                             fFrameBackgroundColor));
+  fStripQueryInfo->SetTextJustify(kTextTop | kTextLeft);
+  tabFrame2->AddFrame(fStripQueryInfo.get(), new TGLayoutHints(kLHintsExpandX | kLHintsExpandY,1,1,1,1));
+
+  TGCompositeFrame *tabFrame2_1 =
+    AddCompositeFrame(tabFrame2, 1, 1, kHorizontalFrame, kLHintsExpandX | kLHintsBottom, 1, 1, 1, 1);
+  AddButton(tabFrame2_1, "< Prev hit", "doStripPrevious()");
+  AddButton(tabFrame2_1, "Next hit >", "doStripNext()");
+
+  TGCompositeFrame* tf3 = pTab->AddTab("QA");
+  tf3->ChangeBackground(fFrameBackgroundColor);
+
+  TGCompositeFrame* tabFrame3 =
+    AddCompositeFrame(tf3, 1, 1, kVerticalFrame, kLHintsExpandX | kLHintsExpandY, 5, 5, 5, 5);
+
+  fChannelQAInfo = std::unique_ptr<TGLabel>(new TGLabel(tabFrame3,
+                                            "Run Channel QA from the File menu.",
+                                            TGLabel::GetDefaultGC()(),
+                                            TGLabel::GetDefaultFontStruct(),
+                                            kChildFrame,
+                                            fFrameBackgroundColor));
+  fChannelQAInfo->SetTextJustify(kTextTop | kTextLeft);
+  tabFrame3->AddFrame(fChannelQAInfo.get(), new TGLayoutHints(kLHintsExpandX | kLHintsExpandY,1,1,1,1));
+
+  TGCompositeFrame *tabFrame3_1 =
+    AddCompositeFrame(tabFrame3, 1, 1, kHorizontalFrame, kLHintsExpandX | kLHintsTop, 1, 1, 1, 1);
+  AddButton(tabFrame3_1, "Sample", "doSample()");
+  fNumberEntrySamples = std::unique_ptr<TGNumberEntry>(new TGNumberEntry(tabFrame3_1,
+                                                       2000, 7, -1, TGNumberFormat::kNESInteger,
+                                                       TGNumberFormat::kNEAPositive));
+  tabFrame3_1->AddFrame(fNumberEntrySamples.get(), new TGLayoutHints(kLHintsLeft, 5, 5, 3, 4));
+  fStratifiedCheck = std::unique_ptr<TGCheckButton>(new TGCheckButton(tabFrame3_1, "Stratified"));
+  fStratifiedCheck->ChangeBackground(fFrameBackgroundColor);
+  tabFrame3_1->AddFrame(fStratifiedCheck.get(), new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 1, 1, 1, 1));
+
+  fSampleInfo = std::unique_ptr<TGLabel>(new TGLabel(tabFrame3,
+                                         "Sample entries for a quick estimate.",
+                                         TGLabel::GetDefaultGC()(),
+                                         TGLabel::GetDefaultFontStruct(),
+                                         kChildFrame,
+                                         fFrameBackgroundColor));
+  fSampleInfo->SetTextJustify(kTextTop | kTextLeft);
+  tabFrame3->AddFrame(fSampleInfo.get(), new TGLayoutHints(kLHintsExpandX | kLHintsExpandY,1,1,1,1));
+
+  TGCompositeFrame* tf4 = pTab->AddTab("Compare");
+  tf4->ChangeBackground(fFrameBackgroundColor);
+
+  TGCompositeFrame* tabFrame4 =
+    AddCompositeFrame(tf4, 1, 1, kVerticalFrame, kLHintsExpandX | kLHintsExpandY, 5, 5, 5, 5);
+
+  fRunRatioCheck = std::unique_ptr<TGCheckButton>(new TGCheckButton(tabFrame4, "Whole run ratio"));
+  fRunRatioCheck->ChangeBackground(fFrameBackgroundColor);
+  fRunRatioCheck->Connect("Toggled(Bool_t)", "jpet_event_display::EventDisplay", this, "doRunRatioToggle()");
+  tabFrame4->AddFrame(fRunRatioCheck.get(), new TGLayoutHints(kLHintsLeft | kLHintsTop, 1, 1, 1, 1));
+
+  fCompareInfo = std::unique_ptr<TGLabel>(new TGLabel(tabFrame4,
+                                          "Compare With... in the File menu.",
+                                          TGLabel::GetDefaultGC()(),
+                                          TGLabel::GetDefaultFontStruct(),
+                                          kChildFrame,
+                                          fFrameBackgroundColor));
+  fCompareInfo->SetTextJustify(kTextTop | kTextLeft);
+  tabFrame4->AddFrame(fCompareInfo.get(), new TGLayoutHints(kLHintsExpandX | kLHintsExpandY,1,1,1,1));
+
+  TGCompositeFrame* tf5 = pTab->AddTab("Files");
+  tf5->ChangeBackground(fFrameBackgroundColor);
+
+  TGCompositeFrame* tabFrame5 =
+    AddCompositeFrame(tf5, 1, 1, kVerticalFrame, kLHintsExpandX | kLHintsExpandY, 5, 5, 5, 5);
+
+  fFileList = std::unique_ptr<TGListBox>(new TGListBox(tabFrame5));
+  fFileList->AddEntry("Browse Directory... in the File menu.", -1);
+  fFileList->Connect("DoubleClicked(Int_t)", "jpet_event_display::EventDisplay", this, "doBrowsedFileSelected(Int_t)");
+  tabFrame5->AddFrame(fFileList.get(), new TGLayoutHints(kLHintsExpandX | kLHintsExpandY,1,1,1,1));
+
   pTab->SetEnabled(1,kTRUE);
   frame1_2->AddFrame(pTab, new TGLayoutHints(kLHintsTop | kLHintsExpandX | kLHintsExpandY, 2, 2, 5, 1));
 
@@ -174,6 +305,97 @@ void EventDisplay::CreateOptionsFrame(TGGroupFrame* parentFrame)
   frame1_3_2->AddFrame(fNumberEntryEventNo.get(), new TGLayoutHints(kLHintsExpandX));
   fNumberEntryEventNo->Connect("ValueSet(Long_t)", "jpet_event_display::EventDisplay", this, "updateGUIControlls()");
 
+  TGCompositeFrame *frame1_3_3 =
+    AddCompositeFrame(frame1_3, 1, 1, kHorizontalFrame, kLHintsExpandX| kLHintsTop, 5, 5, 5, 5);
+
+  TGLabel *labelTime = new TGLabel(frame1_3_3,"Time [s]",TGLabel::GetDefaultGC()(),TGLabel::GetDefaultFontStruct(),kChildFrame,fFrameBackgroundColor);
+  labelTime->SetTextJustify(36);
+  frame1_3_3->AddFrame(labelTime, new TGLayoutHints(kLHintsLeft | kLHintsTop,2,2,2,2));
+
+  fNumberEntryTime = std::unique_ptr<TGNumberEntry>(new TGNumberEntry(frame1_3_3,
+                                                    0, 9, -1, TGNumberFormat::kNESReal,
+                                                    TGNumberFormat::kNEAAnyNumber));
+  frame1_3_3->AddFrame(fNumberEntryTime.get(), new TGLayoutHints(kLHintsExpandX, 5, 5, 3, 4));
+  fNumberEntryTime->Connect("ValueSet(Long_t)", "jpet_event_display::EventDisplay", this, "doGoToTime()");
+  AddButton(frame1_3_3, "Go", "doGoToTime()");
+
+  fTimeInfo = std::unique_ptr<TGLabel>(new TGLabel(frame1_3,
+                                       "",
+                                       TGLabel::GetDefaultGC()(),
+                                       TGLabel::GetDefaultFontStruct(),
+                                       kChildFrame,
+                                       fFrameBackgroundColor));
+  fTimeInfo->SetTextJustify(kTextLeft);
+  frame1_3->AddFrame(fTimeInfo.get(), new TGLayoutHints(kLHintsExpandX | kLHintsTop, 5, 5, 0, 2));
+
+  TGCompositeFrame *frame1_3_4 =
+    AddCompositeFrame(frame1_3, 1, 1, kHorizontalFrame, kLHintsExpandX| kLHintsTop, 5, 5, 5, 5);
+
+  fSliceCheck = std::unique_ptr<TGCheckButton>(new TGCheckButton(frame1_3_4, "Time slice"));
+  fSliceCheck->ChangeBackground(fFrameBackgroundColor);
+  fSliceCheck->Connect("Toggled(Bool_t)", "jpet_event_display::EventDisplay", this, "doSliceToggle()");
+  frame1_3_4->AddFrame(fSliceCheck.get(), new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 2, 2, 2, 2));
+
+  TGLabel *labelSliceWidth = new TGLabel(frame1_3_4,"Width [ns]",TGLabel::GetDefaultGC()(),TGLabel::GetDefaultFontStruct(),kChildFrame,fFrameBackgroundColor);
+  labelSliceWidth->SetTextJustify(36);
+  frame1_3_4->AddFrame(labelSliceWidth, new TGLayoutHints(kLHintsLeft | kLHintsTop,2,2,2,2));
+
+  fNumberEntrySliceWidth = std::unique_ptr<TGNumberEntry>(new TGNumberEntry(frame1_3_4,
+                                                         50, 5, -1, TGNumberFormat::kNESReal,
+                                                         TGNumberFormat::kNEAPositive,
+                                                         TGNumberFormat::kNELLimitMin, 0.001));
+  frame1_3_4->AddFrame(fNumberEntrySliceWidth.get(), new TGLayoutHints(kLHintsCenterX,5,5,3,4));
+  fNumberEntrySliceWidth->Connect("ValueSet(Long_t)", "jpet_event_display::EventDisplay", this, "updateSlice()");
+
+  fCoincidenceCheck = std::unique_ptr<TGCheckButton>(new TGCheckButton(frame1_3_4, "Coincidences"));
+  fCoincidenceCheck->ChangeBackground(fFrameBackgroundColor);
+  fCoincidenceCheck->Connect("Toggled(Bool_t)", "jpet_event_display::EventDisplay", this, "doCoincidenceToggle()");
+  frame1_3_4->AddFrame(fCoincidenceCheck.get(), new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 2, 2, 2, 2));
+
+  fHitPositionCheck = std::unique_ptr<TGCheckButton>(new TGCheckButton(frame1_3_4, "Hit positions"));
+  fHitPositionCheck->ChangeBackground(fFrameBackgroundColor);
+  fHitPositionCheck->Connect("Toggled(Bool_t)", "jpet_event_display::EventDisplay", this, "doHitPositionToggle()");
+  frame1_3_4->AddFrame(fHitPositionCheck.get(), new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 2, 2, 2, 2));
+
+  fSliceSlider = std::unique_ptr<TGHSlider>(new TGHSlider(frame1_3, 150, kSlider1 | kScaleNo));
+  fSliceSlider->SetRange(0, 1000);
+  fSliceSlider->SetPosition(0);
+  fSliceSlider->ChangeBackground(fFrameBackgroundColor);
+  fSliceSlider->Connect("PositionChanged(Int_t)", "jpet_event_display::EventDisplay", this, "updateSlice()");
+  frame1_3->AddFrame(fSliceSlider.get(), new TGLayoutHints(kLHintsExpandX, 5, 5, 3, 4));
+
+  fSliceInfo = std::unique_ptr<TGLabel>(new TGLabel(frame1_3,
+                                        "Whole entry shown",
+                                        TGLabel::GetDefaultGC()(),
+                                        TGLabel::GetDefaultFontStruct(),
+                                        kChildFrame,
+                                        fFrameBackgroundColor));
+  frame1_3->AddFrame(fSliceInfo.get(), new TGLayoutHints(kLHintsExpandX, 5, 5, 3, 4));
+
+  TGCompositeFrame *frame1_3_3 =
+    AddCompositeFrame(frame1_3, 1, 1, kHorizontalFrame, kLHintsExpandX| kLHintsTop, 5, 5, 5, 5);
+
+  fPlayButton = AddButton(frame1_3_3, "&Play", "doPlayPause()");
+
+  TGLabel *labelRate = new TGLabel(frame1_3_3,"Events/s",TGLabel::GetDefaultGC()(),TGLabel::GetDefaultFontStruct(),kChildFrame,fFrameBackgroundColor);
+  labelRate->SetTextJustify(36);
+  frame1_3_3->AddFrame(labelRate, new TGLayoutHints(kLHintsLeft | kLHintsTop,2,2,2,2));
+
+  fNumberEntryRate = std::unique_ptr<TGNumberEntry>(new TGNumberEntry(frame1_3_3,
+                                                  10, 3, -1, TGNumberFormat::kNESInteger,
+                                                  TGNumberFormat::kNEAPositive,
+                                                  TGNumberFormat::kNELLimitMinMax, 1, 60));
+  frame1_3_3->AddFrame(fNumberEntryRate.get(), new TGLayoutHints(kLHintsCenterX,5,5,3,4));
+  fNumberEntryRate->Connect("ValueSet(Long_t)", "jpet_event_display::EventDisplay", this, "updatePlaybackRate()");
+
+  fPlaybackInfo = std::unique_ptr<TGLabel>(new TGLabel(frame1_3,
+                                           "Playback stopped",
+                                           TGLabel::GetDefaultGC()(),
+                                           TGLabel::GetDefaultFontStruct(),
+                                           kChildFrame,
+                                           fFrameBackgroundColor));
+  frame1_3->AddFrame(fPlaybackInfo.get(), new TGLayoutHints(kLHintsExpandX, 5, 5, 3, 4));
+
   fProgBar = std::unique_ptr<TGHProgressBar>(new TGHProgressBar(frame1_3,TGProgressBar::kFancy,250));
   fProgBar->SetBarColor("lightblue");
   fProgBar->ShowPosition(kTRUE,kFALSE,"%.0f events");
@@ -195,9 +417,9 @@ void EventDisplay::AddTab(std::unique_ptr<TGTab> &pTabViews,
       new TGLayoutHints(kLHintsExpandX | kLHintsExpandY, 10, 10, 10, 1));
 }
 
-void EventDisplay::AddButton(TGCompositeFrame *parentFrame,
-                             const char *buttonText,
-                             const char *signalFunction) {
+TGTextButton *EventDisplay::AddButton(TGCompositeFrame *parentFrame,
+                                      const char *buttonText,
+                                      const char *signalFunction) {
   TGTextButton *button = new TGTextButton(parentFrame, buttonText);
   parentFrame->AddFrame(
       button, new TGLayoutHints(kLHintsExpandX | kLHintsExpandY, 5, 5, 3, 4));
@@ -205,6 +427,7 @@ void EventDisplay::AddButton(TGCompositeFrame *parentFrame,
                   signalFunction);
   button->SetTextJustify(36);
   button->ChangeBackground(fFrameBackgroundColor);
+  return button;
 }
 
 TGGroupFrame* EventDisplay::AddGroupFrame(TGCompositeFrame *parentFrame,
@@ -245,6 +468,16 @@ void EventDisplay::AddMenuBar(TGCompositeFrame *parentFrame)
   fMenuFile->AddSeparator();
   fMenuFile->AddEntry(" &Open Data...\tCtrl+O", E_OpenData);
   fMenuFile->AddSeparator();
+  fMenuFile->AddEntry(" &Follow Live File...", E_FollowFile);
+  fMenuFile->AddEntry(" Follow Live &Directory...", E_FollowDirectory);
+  fMenuFile->AddEntry(" &Stop Following", E_StopFollowing);
+  fMenuFile->AddSeparator();
+  fMenuFile->AddEntry(" Run Channel &QA", E_ChannelQA);
+  fMenuFile->AddEntry(" Compare &With...", E_CompareWith);
+  fMenuFile->AddEntry(" Stop &Comparing", E_StopComparing);
+  fMenuFile->AddSeparator();
+  fMenuFile->AddEntry(" &Browse Directory...", E_BrowseDirectory);
+  fMenuFile->AddSeparator();
   fMenuFile->AddEntry(" E&xit\tCtrl+Q", E_Close);
   fMenuFile->Associate(fMainWindow.get());
   fMenuFile->Connect("Activated(Int_t)", "jpet_event_display::EventDisplay", this, "handleMenu(Int_t)");
@@ -256,7 +489,11 @@ void EventDisplay::AddMenuBar(TGCompositeFrame *parentFrame)
   parentFrame->AddFrame(fMenuBar, fMenuBarLayout);
 }
 
-void EventDisplay::CloseWindow() { gApplication->Terminate(); }
+void EventDisplay::CloseWindow()
+{
+  saveSession();
+  gApplication->Terminate();
+}
 
 void EventDisplay::handleMenu(Int_t id)
 {
@@ -271,7 +508,8 @@ void EventDisplay::handleMenu(Int_t id)
       if(fFileInfo->fFilename == 0)
         return;
       assert(visualizator);
-      visualizator->loadGeometry(fFileInfo->fFilename);
+      if (visualizator->loadGeometry(fFileInfo->fFilename))
+        fGeometryFile = fFileInfo->fFilename;
       visualizator->drawOnlyGeometry();
     }
     break;
@@ -283,8 +521,8 @@ void EventDisplay::handleMenu(Int_t id)
       new TGFileDialog(gClient->GetRoot(), fMainWindow.get(), kFDOpen, fFileInfo.get());
       if(fFileInfo->fFilename == 0)
         return;
-      assert(dataProcessor);
-      dataProcessor->openFile(fFileInfo->fFilename);
+      stopFollowing();
+      openDataFile(fFileInfo->fFilename);
       /*switch(dataProcessor->getCurrentFileType())
       {
         case DataProcessor::FileTypes::fTimeWindow:
@@ -297,7 +535,60 @@ void EventDisplay::handleMenu(Int_t id)
         default:
           break;
       }*/
-      drawSelectedStrips();
+      showData();
+    }
+    break;
+    case E_FollowFile:
+    case E_FollowDirectory:
+    {
+      TString dir("");
+      fFileInfo->fFileTypes = filetypes;
+      fFileInfo->fIniDir = StrDup(dir);
+      new TGFileDialog(gClient->GetRoot(), fMainWindow.get(), kFDOpen, fFileInfo.get());
+      if(fFileInfo->fFilename == 0)
+        return;
+      // any file picked in the directory selects the directory itself
+      std::string path = id == E_FollowFile ? fFileInfo->fFilename
+                                            : gSystem->DirName(fFileInfo->fFilename);
+      startFollowing(path);
+    }
+    break;
+    case E_StopFollowing:
+    {
+      stopFollowing();
+    }
+    break;
+    case E_ChannelQA:
+    {
+      startChannelQA();
+    }
+    break;
+    case E_CompareWith:
+    {
+      TString dir("");
+      fFileInfo->fFileTypes = filetypes;
+      fFileInfo->fIniDir = StrDup(dir);
+      new TGFileDialog(gClient->GetRoot(), fMainWindow.get(), kFDOpen, fFileInfo.get());
+      if(fFileInfo->fFilename == 0)
+        return;
+      startComparison(fFileInfo->fFilename);
+    }
+    break;
+    case E_StopComparing:
+    {
+      stopComparison();
+    }
+    break;
+    case E_BrowseDirectory:
+    {
+      TString dir("");
+      fFileInfo->fFileTypes = filetypes;
+      fFileInfo->fIniDir = StrDup(dir);
+      new TGFileDialog(gClient->GetRoot(), fMainWindow.get(), kFDOpen, fFileInfo.get());
+      if(fFileInfo->fFilename == 0)
+        return;
+      // any file picked in the directory selects the directory itself
+      startFileProbe(gSystem->DirName(fFileInfo->fFilename));
     }
     break;
     case E_Close:
@@ -313,6 +604,7 @@ void EventDisplay::updateGUIControlls()
 {
   fGUIControls->eventNo = fNumberEntryEventNo->GetIntNumber();
   fGUIControls->stepNo = fNumberEntryStep->GetIntNumber();
+  fGUIControls->playbackRate = fNumberEntryRate->GetIntNumber();
 }
 
 void EventDisplay::doReset() {
@@ -331,18 +623,862 @@ void EventDisplay::doNext()
 
 void EventDisplay::showData()
 {
+  if (fPlaying)
+    stopPlayback();
   updateGUIControlls();
-  dataProcessor->nthEvent(fGUIControls->eventNo);
+  fEventLoader->requestEntry(fGUIControls->eventNo);
+}
+
+void EventDisplay::handleLoadedEvent()
+{
+  checkOpenedFile();
+  checkLiveEntries();
+  checkIndexes();
+  checkChannelQA();
+  checkSampling();
+  checkFileProbe();
+  checkComparison();
+  if (!fPendingSliceChanges.empty())
+    flushSliceChanges();
+  DecodedEvent event;
+  if (!fEventLoader->takeResult(event) || !event.valid)
+    return;
+  showDecodedEvent(std::move(event));
+}
+
+void EventDisplay::showDecodedEvent(DecodedEvent &&event)
+{
+  fCurrentEvent = std::move(event);
+  if (fCompareLoader)
+    fCompareLoader->requestEntry(fCurrentEvent.entry);
+  fTimeSlice.reset(&fCurrentEvent.hits);
+  fPendingSliceChanges.clear();
+  if (fSliceEnabled) {
+    std::vector<StripChange> changes;
+    moveSlice(changes);
+  }
   drawSelectedStrips();
-  updateProgressBar();
-  fInputInfo->ChangeText(dataProcessor->getDataInfo().c_str());
+  updateProgressBar(fCurrentEvent.entry);
+  fInputInfo->ChangeText(fCurrentEvent.info.c_str());
+  if (fFirstEventPending) {
+    fFirstEventPending = false;
+    logStartupPhase("first event shown");
+  }
+}
+
+void EventDisplay::doPlayPause()
+{
+  if (fPlaying) {
+    stopPlayback();
+    return;
+  }
+  updateGUIControlls();
+  fPlaying = true;
+  fDroppedFrames = 0;
+  fFramesInRateWindow = 0;
+  fLastFrameTime = fRateWindowStart = std::chrono::steady_clock::now();
+  fEventLoader->startPlayback(fGUIControls->eventNo + fGUIControls->stepNo, fGUIControls->stepNo);
+  fPlaybackTimer->SetTime(1000 / fGUIControls->playbackRate);
+  fPlaybackTimer->TurnOn();
+  fPlayButton->SetText("&Pause");
+}
+
+void EventDisplay::stopPlayback()
+{
+  fPlaying = false;
+  fPlaybackTimer->TurnOff();
+  fEventLoader->stopPlayback();
+  fPlayButton->SetText("&Play");
+}
+
+void EventDisplay::updatePlaybackRate()
+{
+  updateGUIControlls();
+  if (fPlaying)
+    fPlaybackTimer->SetTime(1000 / fGUIControls->playbackRate);
+}
+
+void EventDisplay::doPlaybackTick()
+{
+  if (!fPlaying)
+    return;
+  auto now = std::chrono::steady_clock::now();
+  const double period = 1. / fGUIControls->playbackRate;
+  const double sinceLastFrame = std::chrono::duration<double>(now - fLastFrameTime).count();
+  // if drawing lagged, several frames are due at once and only the newest is shown
+  size_t framesDue = std::max<size_t>(1, static_cast<size_t>(sinceLastFrame / period));
+
+  DecodedEvent event;
+  size_t dropped = 0;
+  bool finished = false;
+  if (fEventLoader->takePlaybackFrame(framesDue, event, dropped, finished)) {
+    fDroppedFrames += dropped;
+    fFramesInRateWindow++;
+    fLastFrameTime = now;
+    showDecodedEvent(std::move(event));
+    fNumberEntryEventNo->SetIntNumber(fCurrentEvent.entry);
+  }
+
+  const double windowLength = std::chrono::duration<double>(now - fRateWindowStart).count();
+  if (windowLength >= 1.) {
+    fPlaybackInfo->ChangeText(Form("%.1f / %d events/s, dropped %lu",
+                                   fFramesInRateWindow / windowLength,
+                                   fGUIControls->playbackRate,
+                                   static_cast<unsigned long>(fDroppedFrames)));
+    fFramesInRateWindow = 0;
+    fRateWindowStart = now;
+  }
+  if (finished)
+    stopPlayback();
 }
 
 void EventDisplay::drawSelectedStrips()
 {
-  std::map<int, std::vector<int> > selection = dataProcessor->getActiveScintillators();
-  visualizator->drawStrips(selection);
-  visualizator->drawDiagram(dataProcessor->getDataForDiagram());
+  for (int i = 0; i < kNumberOfTabs; i++)
+    fViewOutdated[i] = true;
+  drawView(fActiveTab);
+}
+
+/// Only the visible tab is redrawn on event change, the others are
+/// brought up to date from the cached event when they get selected.
+void EventDisplay::drawView(Int_t tab)
+{
+  if (tab < 0 || tab >= kNumberOfTabs || !fViewOutdated[tab])
+    return;
+  switch (tab)
+  {
+    case kTab3d:
+      visualizator->drawStrips3d(currentSelection());
+      visualizator->drawCoincidences3d(fShowCoincidences ? fCurrentEvent.coincidences : Coincidences());
+      visualizator->drawHits3d(fShowHitPositions ? fCurrentEvent.coincidences.hits : std::vector<StripHit>());
+      break;
+    case kTab2d:
+      if (fShowRunRatio && fRunComparison && !fRunComparisonRun.valid()) {
+        // log2 ratio saturates at a factor of 4 either way
+        visualizator->drawOccupancyRatio2d(fRunComparison->getLogRatios(), 2.);
+        break;
+      }
+      if (fCompareLoader && fCompareEvent.valid && fCompareEvent.entry == fCurrentEvent.entry) {
+        visualizator->drawStripDifference2d(fCurrentEvent.selection, fCompareEvent.selection);
+        break;
+      }
+      visualizator->drawStrips2d(currentSelection());
+      if (fShowCoincidences)
+        visualizator->drawCoincidences2d(fCurrentEvent.coincidences);
+      break;
+    case kTabDiagram:
+      visualizator->drawDiagram(fCurrentEvent.diagram);
+      break;
+  }
+  fViewOutdated[tab] = false;
+}
+
+const ScintillatorsInLayers &EventDisplay::currentSelection()
+{
+  if (!fSliceEnabled)
+    return fCurrentEvent.selection;
+  fSliceSelection = fTimeSlice.getSelection();
+  return fSliceSelection;
+}
+
+void EventDisplay::doCoincidenceToggle()
+{
+  fShowCoincidences = fCoincidenceCheck->IsOn();
+  fViewOutdated[kTab3d] = fViewOutdated[kTab2d] = true;
+  drawView(fActiveTab);
+}
+
+void EventDisplay::doHitPositionToggle()
+{
+  fShowHitPositions = fHitPositionCheck->IsOn();
+  fViewOutdated[kTab3d] = true;
+  drawView(fActiveTab);
+}
+
+void EventDisplay::doSliceToggle()
+{
+  fSliceEnabled = fSliceCheck->IsOn();
+  fTimeSlice.reset(&fCurrentEvent.hits);
+  fPendingSliceChanges.clear();
+  if (fSliceEnabled) {
+    std::vector<StripChange> changes;
+    moveSlice(changes);
+  } else {
+    fSliceInfo->ChangeText("Whole entry shown");
+  }
+  drawSelectedStrips();
+}
+
+/// Hits are sorted by time once per entry, a slider move costs two binary
+/// searches plus the hits which entered or left the slice.
+void EventDisplay::moveSlice(std::vector<StripChange> &changes)
+{
+  const double first = fTimeSlice.getFirstTime();
+  const double last = fTimeSlice.getLastTime();
+  const double width = fNumberEntrySliceWidth->GetNumber() * 1000.; // ns -> ps
+  const double from = first + (last - first) * fSliceSlider->GetPosition() / 1000.;
+  fTimeSlice.setRange(from, from + width, changes);
+  fSliceInfo->ChangeText(Form("[%.1f, %.1f) ns, %zu hits", from / 1000., (from + width) / 1000.,
+                              fTimeSlice.getNumberOfHits()));
+}
+
+void EventDisplay::updateSlice()
+{
+  if (!fSliceEnabled)
+    return;
+  moveSlice(fPendingSliceChanges);
+  const auto frameInterval = std::chrono::milliseconds(16);
+  if (std::chrono::steady_clock::now() - fLastSliceDraw >= frameInterval)
+    flushSliceChanges();
+}
+
+/// Only the visible view is updated in place, the others are redrawn
+/// from the slice selection when their tab gets selected.
+void EventDisplay::flushSliceChanges()
+{
+  if (fActiveTab == kTab2d && !fViewOutdated[kTab2d])
+    visualizator->applyStripChanges2d(fPendingSliceChanges);
+  else
+    fViewOutdated[kTab2d] = true;
+  if (fActiveTab == kTab3d && !fViewOutdated[kTab3d])
+    visualizator->applyStripChanges3d(fPendingSliceChanges);
+  else
+    fViewOutdated[kTab3d] = true;
+  fPendingSliceChanges.clear();
+  fLastSliceDraw = std::chrono::steady_clock::now();
+}
+
+void EventDisplay::handleTabSelected(Int_t id)
+{
+  fActiveTab = id;
+  drawView(fActiveTab);
+}
+
+/// Only posts the file to the loader thread, entries requested after this
+/// are decoded from it. checkOpenedFile sets up the rest once it is open.
+void EventDisplay::openDataFile(const char *filename)
+{
+  assert(fEventLoader);
+  if (fPlaying)
+    stopPlayback();
+  fDataPreloadPending = false;
+  fEventLoader->requestOpen(filename);
+}
+
+void EventDisplay::checkOpenedFile()
+{
+  EventLoader::OpenedFile opened;
+  if (!fEventLoader->takeOpenedFile(opened))
+    return;
+  // following may open a new run file on its own, which ends playback in the loader
+  if (fPlaying)
+    stopPlayback();
+  const bool preload = fDataPreloadPending;
+  fDataPreloadPending = false;
+  if (opened.entries < 0) {
+    ERROR(std::string("Error opening file:" + opened.filename));
+    return;
+  }
+  const bool changed = fDataFile != opened.filename;
+  // the counters restored from the session belong to the preloaded file
+  if (!preload && changed)
+    clearChannelQA();
+  // a running comparison was against the previous first file
+  const std::string secondFile = changed ? fCompareFile : std::string();
+  if (changed && fCompareLoader)
+    stopComparison();
+  fDataFile = opened.filename;
+  setMaxProgressBar(opened.entries);
+  if (!fLivePath.empty()) {
+    // a new run file in the followed directory, shown from its newest entry
+    fLiveEntries = 0;
+    showLiveEntries(opened.entries);
+  }
+  if (preload) {
+    logStartupPhase("data file opened");
+    fNumberEntryEventNo->SetIntNumber(std::max(0LL, std::min(fOptions.entry, opened.entries - 1)));
+    fFirstEventPending = true;
+    showData();
+  }
+  startIndexes(fDataFile);
+  if (!secondFile.empty())
+    startComparison(secondFile);
+}
+
+/// Streams the whole open file on its own thread, like the strip index.
+void EventDisplay::startChannelQA()
+{
+  if (fDataFile.empty()) {
+    fChannelQAInfo->ChangeText("No file read.");
+    return;
+  }
+  fChannelQACancel = true;
+  if (fChannelQARun.valid())
+    fChannelQARun.wait();
+  fChannelQACancel = false;
+  fChannelQA = std::unique_ptr<ChannelQA>(new ChannelQA());
+  ChannelQA *qa = fChannelQA.get();
+  const std::string dataFile = fDataFile;
+  fChannelQARun = std::async(std::launch::async, [this, qa, dataFile] {
+    return qa->run(dataFile, fChannelQACancel);
+  });
+  fChannelQAInfo->ChangeText("Scanning all entries...");
+}
+
+/// Reads only the sampled entries, on its own thread with its own DataProcessor.
+void EventDisplay::doSample()
+{
+  if (fDataFile.empty()) {
+    fSampleInfo->ChangeText("No file read.");
+    return;
+  }
+  fSampleCancel = true;
+  if (fSampleRun.valid())
+    fSampleRun.wait();
+  fSampleCancel = false;
+  fSampler = std::unique_ptr<EventSampler>(new EventSampler());
+  fSampleShown = -1;
+  EventSampler *sampler = fSampler.get();
+  const std::string dataFile = fDataFile;
+  const long long samples = fNumberEntrySamples->GetIntNumber();
+  const bool stratified = fStratifiedCheck->IsOn();
+  const uint64_t seed = std::random_device()();
+  fSampleRun = std::async(std::launch::async, [this, sampler, dataFile, samples, stratified, seed] {
+    return sampler->run(dataFile, samples, stratified, seed, fSampleCancel);
+  });
+  fSampleInfo->ChangeText("Sampling...");
+}
+
+void EventDisplay::checkSampling()
+{
+  if (!fSampler || !fSampleRun.valid())
+    return;
+  const bool finished = fSampleRun.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  if (finished && !fSampleRun.get()) {
+    fSampler.reset();
+    fSampleInfo->ChangeText("Sampling failed.");
+    return;
+  }
+  // the estimate only changes when a round of the sample is complete
+  SampleEstimate estimate = fSampler->getEstimate();
+  if (estimate.sampled == fSampleShown && !finished)
+    return;
+  fSampleShown = estimate.sampled;
+  const size_t maxLines = 10;
+  std::string text = EventSampler::describe(estimate, maxLines);
+  if (!finished)
+    text = "sampling...\n" + text;
+  fSampleInfo->ChangeText(text.c_str());
+}
+
+/// Only tree headers are read, many files at a time, so even a directory of
+/// a few hundred runs is listed in seconds.
+void EventDisplay::startFileProbe(const std::string &directory)
+{
+  fFileProbeCancel = true;
+  if (fFileProbeRun.valid())
+    fFileProbeRun.wait();
+  fFileProbeCancel = false;
+  fBrowsedFiles.clear();
+  const std::vector<std::string> files = CommonTools::listFiles(directory, ".root");
+  const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  fFileProbeRun = std::async(std::launch::async, [this, files, threads] {
+    return FileProbe::probeAll(files, threads, fFileProbeCancel);
+  });
+  fFileList->RemoveAll();
+  fFileList->AddEntry(("Probing " + std::to_string(files.size()) + " files in " + directory + "...").c_str(), -1);
+  fFileList->Layout();
+}
+
+void EventDisplay::checkFileProbe()
+{
+  if (!fFileProbeRun.valid() ||
+      fFileProbeRun.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+  fBrowsedFiles = fFileProbeRun.get();
+  fFileList->RemoveAll();
+  if (fBrowsedFiles.empty())
+    fFileList->AddEntry("No .root files in the directory.", -1);
+  for (size_t i = 0; i < fBrowsedFiles.size(); i++)
+    fFileList->AddEntry(FileProbe::describe(fBrowsedFiles[i]).c_str(), i);
+  fFileList->Layout();
+}
+
+void EventDisplay::doBrowsedFileSelected(Int_t id)
+{
+  if (id < 0 || id >= static_cast<Int_t>(fBrowsedFiles.size()) || !fBrowsedFiles[id].ok())
+    return;
+  stopFollowing();
+  openDataFile(fBrowsedFiles[id].path.c_str());
+  showData();
+}
+
+/// The second file gets its own DataProcessor and loader thread, so both
+/// are decoded at the same time; the whole-run scan runs next to them.
+void EventDisplay::startComparison(const std::string &secondFile)
+{
+  stopComparison();
+  if (fDataFile.empty()) {
+    fCompareInfo->ChangeText("Open the first file before comparing.");
+    return;
+  }
+  fCompareProcessor = std::unique_ptr<DataProcessor>(new DataProcessor());
+  fCompareProcessor->setCoincidenceOptions(fOptions.coincidence);
+  fCompareLoader = std::unique_ptr<EventLoader>(new EventLoader(*fCompareProcessor));
+  // a file which cannot be opened stops the comparison in checkComparison
+  fCompareLoader->requestOpen(secondFile);
+  fCompareFile = secondFile;
+  if (fCurrentEvent.valid)
+    fCompareLoader->requestEntry(fCurrentEvent.entry);
+
+  fRunComparisonCancel = false;
+  fRunComparison = std::unique_ptr<RunComparison>(new RunComparison());
+  RunComparison *comparison = fRunComparison.get();
+  const std::string firstFile = fDataFile;
+  fRunComparisonRun = std::async(std::launch::async, [this, comparison, firstFile, secondFile] {
+    return comparison->run(firstFile, secondFile, fRunComparisonCancel);
+  });
+  updateComparisonInfo();
+}
+
+void EventDisplay::stopComparison()
+{
+  fRunComparisonCancel = true;
+  if (fRunComparisonRun.valid())
+    fRunComparisonRun.wait();
+  fRunComparisonRun = std::future<bool>();
+  fRunComparison.reset();
+  fCompareLoader.reset();
+  fCompareProcessor.reset();
+  fCompareFile.clear();
+  fCompareEvent = DecodedEvent();
+  if (fCompareInfo)
+    updateComparisonInfo();
+  fViewOutdated[kTab2d] = true;
+}
+
+void EventDisplay::checkComparison()
+{
+  if (!fCompareLoader)
+    return;
+  EventLoader::OpenedFile opened;
+  if (fCompareLoader->takeOpenedFile(opened) && opened.entries < 0) {
+    ERROR(std::string("Error opening file:" + opened.filename));
+    stopComparison();
+    return;
+  }
+  DecodedEvent event;
+  if (fCompareLoader->takeResult(event) && event.valid) {
+    fCompareEvent = std::move(event);
+    fViewOutdated[kTab2d] = true;
+    drawView(fActiveTab);
+  }
+  if (fRunComparisonRun.valid() &&
+      fRunComparisonRun.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    if (!fRunComparisonRun.get())
+      fRunComparison.reset();
+    updateComparisonInfo();
+    fViewOutdated[kTab2d] = true;
+    drawView(fActiveTab);
+  }
+}
+
+void EventDisplay::updateComparisonInfo()
+{
+  if (fCompareFile.empty()) {
+    fCompareInfo->ChangeText("Compare With... in the File menu.");
+    return;
+  }
+  std::string text = "with " + fCompareFile + "\n"
+                     "2d: red only here, blue only there,\nwhite in both\n";
+  if (fRunComparisonRun.valid())
+    text += "scanning both runs...\n";
+  else if (fRunComparison)
+    text += "run ratio (red: more here)\n" + fRunComparison->describe(15);
+  else
+    text += "whole run scan failed\n";
+  fCompareInfo->ChangeText(text.c_str());
+}
+
+void EventDisplay::doRunRatioToggle()
+{
+  fShowRunRatio = fRunRatioCheck->IsOn();
+  fViewOutdated[kTab2d] = true;
+  drawView(fActiveTab);
+}
+
+void EventDisplay::checkChannelQA()
+{
+  if (!fChannelQARun.valid() ||
+      fChannelQARun.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+  if (!fChannelQARun.get()) {
+    fChannelQA.reset();
+    fChannelQAInfo->ChangeText("Channel QA failed.");
+    return;
+  }
+  showChannelQA();
+  saveSession();
+}
+
+void EventDisplay::showChannelQA()
+{
+  ChannelFlags flags = fChannelQA->findFlags();
+  visualizator->setFlaggedStrips(flags);
+  const size_t maxLines = 20;
+  std::string text = std::to_string(fChannelQA->getNumberOfEntries()) + " entries, "
+                     + std::to_string(flags.size()) + " flagged\n" + ChannelQA::describe(flags, maxLines);
+  fChannelQAInfo->ChangeText(text.c_str());
+  fViewOutdated[kTab3d] = fViewOutdated[kTab2d] = true;
+  drawView(fActiveTab);
+}
+
+void EventDisplay::clearChannelQA()
+{
+  fChannelQACancel = true;
+  if (fChannelQARun.valid())
+    fChannelQARun.wait();
+  fChannelQARun = std::future<bool>();
+  fChannelQACancel = false;
+  if (!fChannelQA)
+    return;
+  fChannelQA.reset();
+  visualizator->setFlaggedStrips(ChannelFlags());
+  fChannelQAInfo->ChangeText("Run Channel QA from the File menu.");
+  fViewOutdated[kTab3d] = fViewOutdated[kTab2d] = true;
+}
+
+/// The strip index may come from the session and the time index from the
+/// file stored next to the data file. What is missing is built in one scan
+/// on its own thread with its own DataProcessor; a scan of the previous file
+/// is cancelled first.
+void EventDisplay::startIndexes(const std::string &dataFile)
+{
+  fIndexCancel = true;
+  if (fIndexBuild.valid())
+    fIndexBuild.wait();
+  fIndexCancel = false;
+  const bool buildStrips = !fStripIndex || fStripIndex->getDataFile() != dataFile;
+  if (buildStrips)
+    fStripIndex.reset();
+  fTimeIndex.reset();
+  const double windowLength = fOptions.timeWindowLength;
+  fIndexBuild = std::async(std::launch::async, [this, dataFile, buildStrips, windowLength]() -> FileIndexes {
+    FileIndexes indexes;
+    indexes.times = std::unique_ptr<TimeIndex>(new TimeIndex(windowLength));
+    const std::string sidecar = TimeIndex::getSidecarName(dataFile);
+    const bool buildTimes = !indexes.times->load(sidecar) || indexes.times->getDataFile() != dataFile;
+    if (buildStrips)
+      indexes.strips = std::unique_ptr<StripIndex>(new StripIndex());
+    if (!buildStrips && !buildTimes)
+      return indexes;
+    if (!buildIndexes(dataFile, indexes.strips.get(), buildTimes ? indexes.times.get() : 0, fIndexCancel))
+      return FileIndexes();
+    if (buildTimes && !indexes.times->save(sidecar))
+      WARNING(std::string("Cannot store time index: " + sidecar));
+    return indexes;
+  });
+  fTimeInfo->ChangeText("Indexing times...");
+  updateStripQueryInfo();
+}
+
+void EventDisplay::checkIndexes()
+{
+  if (!fIndexBuild.valid() ||
+      fIndexBuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+  FileIndexes indexes = fIndexBuild.get();
+  fTimeIndex = std::move(indexes.times);
+  if (!fTimeIndex || fTimeIndex->size() == 0) {
+    fTimeInfo->ChangeText("No time windows in file.");
+  } else {
+    std::ostringstream oss;
+    oss.precision(6);
+    oss << "Times " << fTimeIndex->getFirstTime() * 1e-12 << " - " << fTimeIndex->getLastTime() * 1e-12 << " s";
+    fTimeInfo->ChangeText(oss.str().c_str());
+  }
+  if (!indexes.strips) {
+    updateStripQueryInfo();
+    return;
+  }
+  fStripIndex = std::move(indexes.strips);
+  updateStripQueryInfo();
+  // the caches are what a session saves time on, playback alone is only saved on exit
+  saveSession();
+}
+
+void EventDisplay::doGoToTime()
+{
+  if (!fTimeIndex) {
+    if (!fIndexBuild.valid())
+      fTimeInfo->ChangeText("No file read.");
+    return;
+  }
+  double startTime = 0.;
+  long long entry = fTimeIndex->findEntry(fNumberEntryTime->GetNumber() * 1e12, &startTime);
+  if (entry < 0)
+    return;
+  std::ostringstream oss;
+  oss.precision(9);
+  oss << "Entry " << entry << " starts at " << startTime * 1e-12 << " s";
+  fTimeInfo->ChangeText(oss.str().c_str());
+  fNumberEntryEventNo->SetIntNumber(entry);
+  showData();
+}
+
+void EventDisplay::handle2dClick(Int_t event, Int_t px, Int_t py, TObject *)
+{
+  if (event != kButton1Down)
+    return;
+  int layer = 0, strip = 0;
+  if (!visualizator->findStrip2d(px, py, layer, strip))
+    return;
+  fQueryLayer = layer;
+  fQueryStrip = strip;
+  visualizator->selectStrip2d(layer, strip);
+  updateStripQueryInfo();
+}
+
+void EventDisplay::updateStripQueryInfo()
+{
+  if (fQueryLayer == 0) {
+    fStripQueryInfo->ChangeText(fIndexBuild.valid() ? "Indexing strips..."
+                                                         : "Click a strip in the 2d view.");
+    return;
+  }
+  std::ostringstream oss;
+  oss << "Strip " << fQueryLayer << "/" << fQueryStrip << "\n";
+  if (!fStripIndex) {
+    oss << (fIndexBuild.valid() ? "indexing..." : "no index");
+    fStripQueryInfo->ChangeText(oss.str().c_str());
+    return;
+  }
+  size_t count = fStripIndex->getCount(fQueryLayer, fQueryStrip);
+  oss << "fired in " << count << " of " << fStripIndex->getNumberOfEntries() << " entries\n"
+      << "hit rate " << 100. * fStripIndex->getHitRate(fQueryLayer, fQueryStrip) << " %\n";
+  const size_t maxListed = 10;
+  long long entry = -1;
+  for (size_t i = 0; i < count && i < maxListed; i++) {
+    entry = fStripIndex->nextEntry(fQueryLayer, fQueryStrip, entry);
+    oss << (i == 0 ? "entries: " : ", ") << entry;
+  }
+  if (count > maxListed)
+    oss << ", ...";
+  fStripQueryInfo->ChangeText(oss.str().c_str());
+}
+
+void EventDisplay::doStripPrevious()
+{
+  if (!fStripIndex || fQueryLayer == 0)
+    return;
+  updateGUIControlls();
+  long long entry = fStripIndex->previousEntry(fQueryLayer, fQueryStrip, fGUIControls->eventNo);
+  if (entry < 0)
+    return;
+  fNumberEntryEventNo->SetIntNumber(entry);
+  showData();
+}
+
+void EventDisplay::doStripNext()
+{
+  if (!fStripIndex || fQueryLayer == 0)
+    return;
+  updateGUIControlls();
+  long long entry = fStripIndex->nextEntry(fQueryLayer, fQueryStrip, fGUIControls->eventNo);
+  if (entry < 0)
+    return;
+  fNumberEntryEventNo->SetIntNumber(entry);
+  showData();
+}
+
+/// Geometry and data files given on the command line are read on their own
+/// threads while run() builds the window, the data file on the loader thread.
+/// Only the geometry bytes are read here, ROOT objects are built on the GUI thread.
+void EventDisplay::startPreload()
+{
+  if (!fOptions.geometryFile.empty())
+    fGeometryPreload = std::async(std::launch::async, [this] {
+      std::string contents;
+      CommonTools::readFile(fOptions.geometryFile, contents);
+      return contents;
+    });
+  if (!fOptions.dataFile.empty()) {
+    fDataPreloadPending = true;
+    fEventLoader->requestOpen(fOptions.dataFile);
+  }
+}
+
+/// Builds and draws the geometry and whatever the session kept, on the GUI
+/// thread once the window is mapped.
+/// The data file may still be opening, checkOpenedFile picks it up.
+void EventDisplay::finishPreload()
+{
+  if (fGeometryPreload.valid()) {
+    const std::string contents = fGeometryPreload.get();
+    if (contents.empty())
+      ERROR(std::string("Error opening file:" + fOptions.geometryFile));
+    else if (visualizator->loadGeometry(fOptions.geometryFile, contents)) {
+      fGeometryFile = fOptions.geometryFile;
+      if (fSession)
+        visualizator->setCamera(fSession->getState().camera);
+      visualizator->drawOnlyGeometry();
+      logStartupPhase("geometry drawn");
+    }
+  }
+  restoreSession();
+  checkOpenedFile();
+}
+
+/// Files and entry missing on the command line are taken from the session.
+void EventDisplay::openSession()
+{
+  if (fOptions.sessionFile.empty() || !fOptions.restoreSession)
+    return;
+  fSession = std::unique_ptr<SessionFile>(new SessionFile());
+  if (!fSession->open(fOptions.sessionFile)) {
+    fSession.reset();
+    return;
+  }
+  const SessionState &state = fSession->getState();
+  if (fOptions.geometryFile.empty())
+    fOptions.geometryFile = state.geometryFile;
+  if (fOptions.dataFile.empty()) {
+    fOptions.dataFile = state.dataFile;
+    fOptions.entry = state.entry;
+  }
+  INFO(std::string("Restoring session from: " + fOptions.sessionFile));
+}
+
+/// Shows the saved entry and reuses the saved index and QA counters when the
+/// data file did not change, nothing is decoded or scanned again.
+void EventDisplay::restoreSession()
+{
+  if (!fSession)
+    return;
+  const SessionState &state = fSession->getState();
+  fNumberEntryStep->SetIntNumber(state.step);
+  if (state.dataFile == fOptions.dataFile && fSession->isDataFileCurrent()) {
+    if (state.hits.size() > 0 && state.entry == fOptions.entry) {
+      DecodedEvent event;
+      event.entry = state.entry;
+      event.valid = true;
+      event.hits = state.hits;
+      event.selection = selectionFromHits(event.hits);
+      event.diagram = diagramFromHits(event.hits);
+      event.info = "restored from session";
+      showDecodedEvent(std::move(event));
+    }
+    std::unique_ptr<StripIndex> index(new StripIndex());
+    if (fSession->restoreStripIndex(*index)) {
+      fStripIndex = std::move(index);
+      updateStripQueryInfo();
+    }
+    std::unique_ptr<ChannelQA> qa(new ChannelQA());
+    if (fSession->restoreChannelQA(*qa)) {
+      fChannelQA = std::move(qa);
+      showChannelQA();
+    }
+  }
+  fSession.reset();
+  logStartupPhase("session restored");
+}
+
+void EventDisplay::saveSession()
+{
+  if (fOptions.sessionFile.empty())
+    return;
+  SessionState state;
+  state.geometryFile = fGeometryFile;
+  state.dataFile = fDataFile;
+  if (!fDataFile.empty())
+    CommonTools::getFileStamp(fDataFile, state.dataFileSize, state.dataFileTime);
+  state.entry = fCurrentEvent.valid ? fCurrentEvent.entry : fGUIControls->eventNo;
+  state.step = fGUIControls->stepNo;
+  visualizator->getCamera(state.camera);
+  if (fCurrentEvent.valid)
+    state.hits = fCurrentEvent.hits;
+  // caches still being built are not saved, the next start builds them again
+  const StripIndex *index = fStripIndex && fStripIndex->getDataFile() == fDataFile ? fStripIndex.get() : 0;
+  const ChannelQA *qa = fChannelQA && !fChannelQARun.valid() && fChannelQA->getDataFile() == fDataFile
+                            ? fChannelQA.get() : 0;
+  if (!SessionFile::write(fOptions.sessionFile, state, index, qa))
+    WARNING(std::string("Cannot write session file: " + fOptions.sessionFile));
+}
+
+void EventDisplay::doResourceSample()
+{
+  ResourceSample sample = fResourceMonitor.sample();
+  visualizator->countOwnedObjects(sample.owned);
+  sample.readCacheBytes = dataProcessor->getReadCacheSize();
+  sample.bytesRead = dataProcessor->getTotalBytesRead();
+  if (fCompareProcessor) {
+    sample.readCacheBytes += fCompareProcessor->getReadCacheSize();
+    sample.bytesRead += fCompareProcessor->getTotalBytesRead();
+  }
+  if (fStripIndex)
+    sample.indexBytes = fStripIndex->getMemoryUsage();
+  const std::string text = fResourceMonitor.describe(sample);
+  fStatusBar->SetText(text.c_str());
+
+  auto now = std::chrono::steady_clock::now();
+  if (fOptions.monitorLogSeconds > 0 &&
+      now - fLastResourceLog >= std::chrono::seconds(fOptions.monitorLogSeconds)) {
+    fLastResourceLog = now;
+    INFO(std::string("Resources: ") + text);
+  }
+}
+
+void EventDisplay::logStartupPhase(const char *phase)
+{
+  double ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - fOptions.startTime).count();
+  INFO(std::string("Startup: ") + phase + " after " + std::to_string(ms) + " ms");
+}
+
+void EventDisplay::startFollowing(const std::string &path)
+{
+  stopFollowing();
+  fLivePath = path;
+  INFO(std::string("Following live data in: " + fLivePath));
+  doLivePoll();
+  fLiveTimer->TurnOn();
+}
+
+void EventDisplay::stopFollowing()
+{
+  fLiveTimer->TurnOff();
+  fLivePath.clear();
+  fLiveEntries = 0;
+}
+
+/// Called at a bounded rate by fLiveTimer. The directory scan and the refresh
+/// run on the loader thread; the open file is only refreshed, it is reopened
+/// only when a newer run file shows up in the followed directory.
+void EventDisplay::doLivePoll()
+{
+  if (fLivePath.empty())
+    return;
+  fEventLoader->requestFollow(fLivePath);
+}
+
+void EventDisplay::checkLiveEntries()
+{
+  long long entries = 0;
+  if (!fEventLoader->takeRefreshedEntries(entries) || fLivePath.empty())
+    return;
+  showLiveEntries(entries);
+}
+
+void EventDisplay::showLiveEntries(long long entries)
+{
+  if (entries == fLiveEntries || entries <= 0)
+    return;
+  fLiveEntries = entries;
+  setMaxProgressBar(entries);
+  fNumberEntryEventNo->SetLimitValues(0, entries - 1);
+  fNumberEntryEventNo->SetIntNumber(entries - 1);
+  updateGUIControlls();
+  fEventLoader->requestEntry(entries - 1);
 }
 
 void EventDisplay::setMaxProgressBar (Int_t maxEvent) {
@@ -17,6 +17,7 @@
 #define EVENTDISPLAY_H
 
 #include <memory>
+#include <chrono>
 #include <string>
 
 #include <TRint.h>
@@ -30,17 +31,34 @@
 #include <TGProgressBar.h>
 #include <TGButtonGroup.h>
 #include <TGTab.h>
+#include <TGListBox.h>
+#include <TGSlider.h>
 
 #include <TGraph.h>
 #include <TBox.h>
 #include <TMarker.h>
 #include <TRootEmbeddedCanvas.h>
 #include <TCanvas.h>
+#include <TTimer.h>
 
 #include <RQ_OBJECT.h>
 
 #include "GeometryVisualizator.h"
 #include "DataProcessor.h"
+#ifndef __CINT__
+#include <atomic>
+#include <future>
+#include "EventLoader.h"
+#include "StripIndex.h"
+#include "TimeSlice.h"
+#include "ChannelQA.h"
+#include "EventSampler.h"
+#include "FileProbe.h"
+#include "RunComparison.h"
+#include "ResourceMonitor.h"
+#include "SessionFile.h"
+#include "TimeIndex.h"
+#endif
 
 
 namespace jpet_event_display
@@ -51,8 +69,36 @@ struct GUIControlls
   Int_t eventNo;
   Int_t stepNo;
   Int_t rootEntries;
+  Int_t playbackRate;
 };
 
+#ifndef __CINT__
+/// files given on the command line, loaded while the window is being built
+struct EventDisplayOptions
+{
+  CoincidenceOptions coincidence;
+  std::string geometryFile;
+  std::string dataFile;
+  long long entry = 0;
+  /// resources are shown in the status bar every second and logged at this interval
+  int monitorLogSeconds = 600;
+  /// written on exit and when a strip index or channel QA is done, empty disables sessions
+  std::string sessionFile;
+  /// fill files, entry and caches from sessionFile at start
+  bool restoreSession = true;
+  /// DAQ time window length, turns window indices into times for go to time [ps]
+  double timeWindowLength = TimeIndex::kDefaultWindowLength;
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+};
+
+/// indexes of one data file, either is missing when it was not built
+struct FileIndexes
+{
+  std::unique_ptr<StripIndex> strips;
+  std::unique_ptr<TimeIndex> times;
+};
+#endif
+
 enum EMessageTypes {
  M_FILE_OPEN,
  M_FILE_SAVE,
@@ -67,6 +113,7 @@ public:
   ~EventDisplay();
 
 #ifndef __CINT__
+  explicit EventDisplay(const EventDisplayOptions &options);
   void run();
   void drawSelectedStrips();
   void setMaxProgressBar (Int_t maxEvent);
@@ -77,7 +124,14 @@ public:
   {
     E_OpenGeometry,
     E_OpenData,
-    E_Close
+    E_Close,
+    E_FollowFile,
+    E_FollowDirectory,
+    E_StopFollowing,
+    E_ChannelQA,
+    E_CompareWith,
+    E_StopComparing,
+    E_BrowseDirectory
   };
 #endif
 
@@ -88,6 +142,24 @@ public:
   void doNext();
   void doReset();
   void showData();
+  void handleTabSelected(Int_t id);
+  void handleLoadedEvent();
+  void doPlayPause();
+  void doPlaybackTick();
+  void updatePlaybackRate();
+  void doLivePoll();
+  void handle2dClick(Int_t event, Int_t x, Int_t y, TObject *selected);
+  void doStripPrevious();
+  void doStripNext();
+  void doSliceToggle();
+  void doCoincidenceToggle();
+  void doHitPositionToggle();
+  void doRunRatioToggle();
+  void doGoToTime();
+  void doSample();
+  void doBrowsedFileSelected(Int_t id);
+  void doResourceSample();
+  void updateSlice();
   
 private:
   
@@ -103,8 +175,8 @@ private:
               std::unique_ptr<TRootEmbeddedCanvas> &saveCanvasPtr,
               const char *tabName, const char *canvasName);
 
-  void AddButton(TGCompositeFrame *parentFrame, const char *buttonText,
-                 const char *signalFunction);
+  TGTextButton *AddButton(TGCompositeFrame *parentFrame, const char *buttonText,
+                          const char *signalFunction);
 
   TGGroupFrame *AddGroupFrame(TGCompositeFrame *parentFrame,
                               const char *frameName, Int_t width, Int_t height);
@@ -118,20 +190,161 @@ private:
 
   void AddMenuBar(TGCompositeFrame *parentFrame);
 
+  /// order has to match the order of AddTab calls in CreateDisplayFrame
+  enum DisplayTabs { kTab3d = 0, kTab2d, kTabDiagram, kNumberOfTabs };
+  void drawView(Int_t tab);
+  void showDecodedEvent(DecodedEvent &&event);
+  void stopPlayback();
+  void startFollowing(const std::string &path);
+  void stopFollowing();
+  void checkLiveEntries();
+  /// moves to the newest entry when the followed file grew
+  void showLiveEntries(long long entries);
+  void openDataFile(const char *filename);
+  void checkOpenedFile();
+  void startPreload();
+  void finishPreload();
+  void logStartupPhase(const char *phase);
+  void startIndexes(const std::string &dataFile);
+  void checkIndexes();
+  void updateStripQueryInfo();
+  void startChannelQA();
+  void checkChannelQA();
+  void checkSampling();
+  void startFileProbe(const std::string &directory);
+  void checkFileProbe();
+  void showChannelQA();
+  /// stops a running scan and drops the counters and flags of the previous file
+  void clearChannelQA();
+  void openSession();
+  void restoreSession();
+  void saveSession();
+  void startComparison(const std::string &secondFile);
+  void stopComparison();
+  void checkComparison();
+  void updateComparisonInfo();
+  const ScintillatorsInLayers &currentSelection();
+  void moveSlice(std::vector<StripChange> &changes);
+  void flushSliceChanges();
+
+  EventDisplayOptions fOptions;
+  std::future<std::string> fGeometryPreload;
+  /// the file being opened is the one from the command line or the session
+  bool fDataPreloadPending = false;
+  /// kept mapped from the constructor until the caches are restored
+  std::unique_ptr<SessionFile> fSession;
+  std::string fGeometryFile;
+  bool fFirstEventPending = false;
+
+  Int_t fActiveTab = kTab3d;
+  bool fViewOutdated[kNumberOfTabs] = {false, false, false};
+  DecodedEvent fCurrentEvent;
+
   ULong_t fFrameBackgroundColor = 0;
 
   std::unique_ptr<GeometryVisualizator> visualizator = std::unique_ptr<GeometryVisualizator>(new GeometryVisualizator());
   std::unique_ptr<DataProcessor> dataProcessor = std::unique_ptr<DataProcessor>(new DataProcessor());
+  std::unique_ptr<EventLoader> fEventLoader = std::unique_ptr<EventLoader>(new EventLoader(*dataProcessor));
+  /// polls fEventLoader for decoded events, drawing happens only on the GUI thread
+  std::unique_ptr<TTimer> fLoaderTimer = std::unique_ptr<TTimer>(new TTimer(20));
 
-  std::unique_ptr<TRint> fApplication = std::unique_ptr<TRint>(new TRint("EventDisplay Gui", 0, 0));
+  /// fires at the target rate, the newest decoded event is shown when drawing lags behind
+  std::unique_ptr<TTimer> fPlaybackTimer = std::unique_ptr<TTimer>(new TTimer(100));
+  bool fPlaying = false;
+  std::chrono::steady_clock::time_point fLastFrameTime;
+  std::chrono::steady_clock::time_point fRateWindowStart;
+  int fFramesInRateWindow = 0;
+  size_t fDroppedFrames = 0;
+
+  /// live mode: polls a growing file, or the newest file in a directory
+  std::unique_ptr<TTimer> fLiveTimer = std::unique_ptr<TTimer>(new TTimer(1000));
+  std::string fLivePath;
+  long long fLiveEntries = 0;
+
+  /// memory and primitive counts, for spotting leaks over a long shift
+  ResourceMonitor fResourceMonitor;
+  std::unique_ptr<TTimer> fResourceTimer = std::unique_ptr<TTimer>(new TTimer(1000));
+  std::chrono::steady_clock::time_point fLastResourceLog;
+  std::unique_ptr<TGStatusBar> fStatusBar;
+
+  std::unique_ptr<TRint> fApplication = std::unique_ptr<TRint>(new TRint("EventDisplay Gui", 0, 0, 0, 0, kTRUE));
   std::unique_ptr<GUIControlls> fGUIControls = std::unique_ptr<GUIControlls>(new GUIControlls);
   std::unique_ptr<TGTab> fDisplayTabView;
   std::unique_ptr<TGMainFrame> fMainWindow;
   std::unique_ptr<TGNumberEntry> fNumberEntryStep;
   std::unique_ptr<TGNumberEntry> fNumberEntryEventNo;
+  std::unique_ptr<TGNumberEntry> fNumberEntryRate;
+  std::unique_ptr<TGLabel> fPlaybackInfo;
+  TGTextButton *fPlayButton = nullptr;
   std::unique_ptr<TGHProgressBar> fProgBar;
   std::unique_ptr<TGLabel> fInputInfo;
 
+  /// built in the background for every opened file, queried by clicking the 2d view
+  std::unique_ptr<StripIndex> fStripIndex;
+  /// strip and time index of a file, from one scan
+  std::future<FileIndexes> fIndexBuild;
+  std::atomic<bool> fIndexCancel{false};
+  int fQueryLayer = 0;
+  int fQueryStrip = 0;
+  std::unique_ptr<TGLabel> fStripQueryInfo;
+
+  /// entry start times, loaded from next to the data file or built with the strip index
+  std::unique_ptr<TimeIndex> fTimeIndex;
+  std::unique_ptr<TGNumberEntry> fNumberEntryTime;
+  std::unique_ptr<TGLabel> fTimeInfo;
+
+  /// only hits in [t, t + width) of the current entry are shown while enabled
+  TimeSlice fTimeSlice;
+  ScintillatorsInLayers fSliceSelection;
+  bool fSliceEnabled = false;
+  /// slider moves faster than the screen refresh are merged into one redraw
+  std::vector<StripChange> fPendingSliceChanges;
+  std::chrono::steady_clock::time_point fLastSliceDraw;
+  std::unique_ptr<TGCheckButton> fSliceCheck;
+  std::unique_ptr<TGHSlider> fSliceSlider;
+  std::unique_ptr<TGNumberEntry> fNumberEntrySliceWidth;
+  std::unique_ptr<TGLabel> fSliceInfo;
+
+  /// file last opened by fEventLoader, scanned by the background passes
+  std::string fDataFile;
+
+  std::future<bool> fChannelQARun;
+  std::unique_ptr<ChannelQA> fChannelQA;
+  std::atomic<bool> fChannelQACancel{false};
+  std::unique_ptr<TGLabel> fChannelQAInfo;
+
+  /// run files of the browsed directory, probed in parallel without opening them
+  std::future<std::vector<FileMetadata> > fFileProbeRun;
+  std::atomic<bool> fFileProbeCancel{false};
+  std::vector<FileMetadata> fBrowsedFiles;
+  std::unique_ptr<TGListBox> fFileList;
+
+  /// estimate of the sample taken so far is shown while more entries are read
+  std::future<bool> fSampleRun;
+  std::unique_ptr<EventSampler> fSampler;
+  std::atomic<bool> fSampleCancel{false};
+  long long fSampleShown = -1;
+  std::unique_ptr<TGNumberEntry> fNumberEntrySamples;
+  std::unique_ptr<TGCheckButton> fStratifiedCheck;
+  std::unique_ptr<TGLabel> fSampleInfo;
+
+  /// second file stepped in lockstep with the first one, with its own processor
+  std::string fCompareFile;
+  std::unique_ptr<DataProcessor> fCompareProcessor;
+  std::unique_ptr<EventLoader> fCompareLoader;
+  DecodedEvent fCompareEvent;
+  std::future<bool> fRunComparisonRun;
+  std::unique_ptr<RunComparison> fRunComparison;
+  std::atomic<bool> fRunComparisonCancel{false};
+  bool fShowRunRatio = false;
+  std::unique_ptr<TGCheckButton> fRunRatioCheck;
+  std::unique_ptr<TGLabel> fCompareInfo;
+
+  bool fShowCoincidences = false;
+  std::unique_ptr<TGCheckButton> fCoincidenceCheck;
+  bool fShowHitPositions = false;
+  std::unique_ptr<TGCheckButton> fHitPositionCheck;
+
   std::unique_ptr<TGFileInfo> fFileInfo = std::unique_ptr<TGFileInfo>(new TGFileInfo);
 #endif
   
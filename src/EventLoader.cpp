@@ -0,0 +1,269 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventLoader.cpp
+ */
+
+#include "EventLoader.h"
+#include "CommonTools.h"
+
+namespace jpet_event_display
+{
+
+EventLoader::EventLoader(DataProcessor& processor) : fProcessor(processor)
+{
+  fWorker = std::thread(&EventLoader::workerLoop, this);
+}
+
+EventLoader::~EventLoader()
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fCondition.notify_all();
+  if (fWorker.joinable())
+    fWorker.join();
+}
+
+void EventLoader::requestOpen(const std::string& filename)
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    dropRequests();
+    fOpenPending = true;
+    fOpenFilename = filename;
+    fHasOpenedFile = false;
+  }
+  fCondition.notify_one();
+}
+
+bool EventLoader::takeOpenedFile(OpenedFile& file)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (!fHasOpenedFile)
+    return false;
+  file = std::move(fOpenedFile);
+  fHasOpenedFile = false;
+  return true;
+}
+
+void EventLoader::requestFollow(const std::string& path)
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fFollowPending = true;
+    fFollowPath = path;
+  }
+  fCondition.notify_one();
+}
+
+bool EventLoader::takeRefreshedEntries(long long& entries)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (!fHasRefreshedEntries)
+    return false;
+  entries = fRefreshedEntries;
+  fHasRefreshedEntries = false;
+  return true;
+}
+
+void EventLoader::requestEntry(long long entry)
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fPendingEntry = entry;
+  }
+  fCondition.notify_one();
+}
+
+bool EventLoader::takeResult(DecodedEvent& event)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (!fHasResult)
+    return false;
+  event = std::move(fResult);
+  fHasResult = false;
+  return true;
+}
+
+void EventLoader::startPlayback(long long first, long long step, size_t capacity)
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fPlaying = true;
+    fPlaybackFinished = false;
+    fPlaybackNext = first;
+    fPlaybackStep = step > 0 ? step : 1;
+    fPlaybackCapacity = capacity > 0 ? capacity : 1;
+    fPlaybackQueue.clear();
+    fGeneration++;
+  }
+  fCondition.notify_one();
+}
+
+void EventLoader::stopPlayback()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  fPlaying = false;
+  fPlaybackQueue.clear();
+}
+
+bool EventLoader::takePlaybackFrame(size_t framesDue, DecodedEvent& event, size_t& dropped, bool& finished)
+{
+  bool taken = false;
+  dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    for (size_t i = 0; i < framesDue && !fPlaybackQueue.empty(); i++) {
+      if (taken)
+        dropped++;
+      event = std::move(fPlaybackQueue.front());
+      fPlaybackQueue.pop_front();
+      taken = true;
+    }
+    finished = fPlaybackFinished && fPlaybackQueue.empty();
+  }
+  if (taken)
+    fCondition.notify_one(); // there is room to decode ahead again
+  return taken;
+}
+
+void EventLoader::workerLoop()
+{
+  while (true) {
+    long long entry = kNoRequest;
+    unsigned generation = 0;
+    bool forPlayback = false;
+    bool open = false;
+    bool follow = false;
+    std::string filename;
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fCondition.wait(lock, [this] {
+        return fStop || fOpenPending || fFollowPending || fPendingEntry != kNoRequest
+               || (fPlaying && !fPlaybackFinished && fPlaybackQueue.size() < fPlaybackCapacity);
+      });
+      if (fStop)
+        return;
+      generation = fGeneration;
+      // entries requested after the open are for the new file, so it goes first,
+      // explicit requests always go before reading ahead
+      if (fOpenPending) {
+        fOpenPending = false;
+        open = true;
+        filename = fOpenFilename;
+      } else if (fFollowPending) {
+        fFollowPending = false;
+        follow = true;
+        filename = fFollowPath;
+      } else if (fPendingEntry != kNoRequest) {
+        entry = fPendingEntry;
+        fPendingEntry = kNoRequest;
+      } else {
+        entry = fPlaybackNext;
+        fPlaybackNext += fPlaybackStep;
+        forPlayback = true;
+      }
+    }
+
+    if (open) {
+      openRequestedFile(filename);
+      continue;
+    }
+    if (follow) {
+      followRequestedPath(filename);
+      continue;
+    }
+
+    DecodedEvent event;
+    {
+      std::lock_guard<std::mutex> processorLock(fProcessorMutex);
+      event = fProcessor.decodeEvent(entry);
+    }
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (generation != fGeneration)
+      continue;
+    if (forPlayback) {
+      if (!fPlaying)
+        continue;
+      if (!event.valid)
+        fPlaybackFinished = true;
+      else
+        fPlaybackQueue.push_back(std::move(event));
+      continue;
+    }
+    if (fPendingEntry != kNoRequest)
+      continue; // outdated while decoding, go straight to the newest request
+    fResult = std::move(event);
+    fHasResult = true;
+  }
+}
+
+void EventLoader::dropRequests()
+{
+  // requests for the previous file are meaningless now
+  fPendingEntry = kNoRequest;
+  fHasResult = false;
+  fHasRefreshedEntries = false;
+  fGeneration++;
+  fPlaying = false;
+  fPlaybackQueue.clear();
+}
+
+void EventLoader::openRequestedFile(const std::string& filename)
+{
+  // a file which fails to open is not retried by following
+  fWorkerFile = filename;
+  OpenedFile opened;
+  opened.filename = filename;
+  {
+    std::lock_guard<std::mutex> processorLock(fProcessorMutex);
+    if (fProcessor.openFile(filename.c_str()))
+      opened.entries = fProcessor.getNumberOfEvents();
+  }
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (fOpenPending)
+    return; // another file was requested meanwhile, only that one is reported
+  fOpenedFile = std::move(opened);
+  fHasOpenedFile = true;
+}
+
+void EventLoader::followRequestedPath(const std::string& path)
+{
+  const std::string newest = CommonTools::isDirectory(path) ? CommonTools::findNewestFile(path, ".root") : path;
+  if (newest.empty())
+    return;
+  if (newest != fWorkerFile) {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if (fOpenPending)
+        return; // an explicitly requested file goes first
+      dropRequests();
+    }
+    openRequestedFile(newest);
+    return;
+  }
+  long long entries = 0;
+  {
+    std::lock_guard<std::mutex> processorLock(fProcessorMutex);
+    entries = fProcessor.refreshEntries();
+  }
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (fOpenPending)
+    return;
+  fRefreshedEntries = entries;
+  fHasRefreshedEntries = true;
+}
+
+}
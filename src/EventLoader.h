@@ -0,0 +1,128 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventLoader.h
+ *  @brief Decodes requested entries on a worker thread, newest request wins.
+ */
+
+#ifndef EVENTLOADER_H
+#define EVENTLOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "DataProcessor.h"
+#include "EventData.h"
+
+namespace jpet_event_display
+{
+
+/**
+ * The GUI posts entries with requestEntry() and polls takeResult() from
+ * a timer. Only one request is kept pending: posting a new one drops the
+ * older one, and a result which got outdated while decoding is discarded.
+ * Files are opened on the worker as well, before any entry requested after
+ * them, and the outcome is polled with takeOpenedFile(). Live data is
+ * followed there too, so neither a directory scan nor a tree refresh
+ * waits on the GUI thread.
+ * All access to the DataProcessor goes through this class once it exists.
+ */
+class EventLoader
+{
+public:
+  explicit EventLoader(DataProcessor& processor);
+  ~EventLoader();
+
+  struct OpenedFile
+  {
+    std::string filename;
+    /// -1 when the file could not be opened
+    long long entries = -1;
+  };
+
+  /// drops requests for the previous file, only the newest requested file is reported
+  void requestOpen(const std::string& filename);
+  /// non blocking, returns true once the newest requested file was opened or failed
+  bool takeOpenedFile(OpenedFile& file);
+  /**
+   * Refreshes the entry count of the open file, unless path is another file
+   * or a directory with a newer .root file, which is then opened and reported
+   * by takeOpenedFile like a requested one.
+   */
+  void requestFollow(const std::string& path);
+  /// non blocking, returns true if the open file was refreshed since the last call
+  bool takeRefreshedEntries(long long& entries);
+  void requestEntry(long long entry);
+  /// non blocking, returns true if a new decoded event was moved into event
+  bool takeResult(DecodedEvent& event);
+
+  /// decode first, first + step, ... ahead of display, at most capacity events
+  void startPlayback(long long first, long long step, size_t capacity = 8);
+  void stopPlayback();
+  /**
+   * Takes up to framesDue decoded events and moves the newest one into event,
+   * the older ones taken with it are counted in dropped. Returns false when
+   * nothing is decoded yet. finished is set once the end of file is reached
+   * and all decoded events were taken.
+   */
+  bool takePlaybackFrame(size_t framesDue, DecodedEvent& event, size_t& dropped, bool& finished);
+
+private:
+  EventLoader(const EventLoader&) = delete;
+  EventLoader& operator=(const EventLoader&) = delete;
+
+  void workerLoop();
+  /// called with fMutex held
+  void dropRequests();
+  void openRequestedFile(const std::string& filename);
+  void followRequestedPath(const std::string& path);
+
+  static const long long kNoRequest = -1;
+
+  DataProcessor& fProcessor;
+  std::mutex fProcessorMutex;
+
+  std::mutex fMutex;
+  std::condition_variable fCondition;
+  long long fPendingEntry = kNoRequest;
+  bool fHasResult = false;
+  bool fStop = false;
+  bool fOpenPending = false;
+  std::string fOpenFilename;
+  bool fHasOpenedFile = false;
+  OpenedFile fOpenedFile;
+  bool fFollowPending = false;
+  std::string fFollowPath;
+  bool fHasRefreshedEntries = false;
+  long long fRefreshedEntries = 0;
+  /// last file opened by the worker, only used by the worker
+  std::string fWorkerFile;
+  /// bumped on every open and startPlayback so stale results are dropped
+  unsigned fGeneration = 0;
+  DecodedEvent fResult;
+
+  bool fPlaying = false;
+  bool fPlaybackFinished = false;
+  long long fPlaybackNext = 0;
+  long long fPlaybackStep = 1;
+  size_t fPlaybackCapacity = 0;
+  std::deque<DecodedEvent> fPlaybackQueue;
+
+  std::thread fWorker;
+};
+
+}
+
+#endif /*  !EVENTLOADER_H */
@@ -0,0 +1,240 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventSampler.cpp
+ */
+
+#include "EventSampler.h"
+#include "DataProcessor.h"
+#include <JPetLoggerInclude.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <unordered_set>
+
+namespace jpet_event_display
+{
+
+namespace
+{
+const double kZ = 1.96;
+/// strips with the whole interval outside these multiples of the layer median are listed
+const double kLowFactor = 0.5;
+const double kHighFactor = 2.;
+
+SampleInterval meanInterval(double sum, double sumSquares, long long n, double correction)
+{
+  SampleInterval interval;
+  if (n <= 0)
+    return interval;
+  interval.value = sum / n;
+  double variance = n > 1 ? std::max(0., (sumSquares - n * interval.value * interval.value) / (n - 1)) : 0.;
+  double half = kZ * std::sqrt(variance / n * correction);
+  interval.low = std::max(0., interval.value - half);
+  interval.high = interval.value + half;
+  return interval;
+}
+
+/// stays inside [0, 1] and is not degenerate for strips which never fired in the sample
+SampleInterval wilsonInterval(long long count, long long n, double correction)
+{
+  SampleInterval interval;
+  if (n <= 0)
+    return interval;
+  const double p = static_cast<double>(count) / n;
+  const double z2 = kZ * kZ * correction;
+  const double denominator = 1. + z2 / n;
+  const double centre = (p + z2 / (2. * n)) / denominator;
+  const double half = std::sqrt(z2 * (p * (1. - p) / n + z2 / (4. * n * n))) / denominator;
+  interval.value = p;
+  interval.low = std::max(0., centre - half);
+  interval.high = std::min(1., centre + half);
+  return interval;
+}
+
+void printInterval(std::ostream& out, const SampleInterval& interval)
+{
+  out << interval.value << " [" << interval.low << ", " << interval.high << "]";
+}
+}
+
+std::vector<long long> EventSampler::drawEntries(long long entries, long long samples, bool stratified,
+                                                 uint64_t seed)
+{
+  std::vector<long long> drawn;
+  samples = std::min(samples, entries);
+  if (samples <= 0)
+    return drawn;
+  std::mt19937_64 generator(seed);
+  drawn.reserve(samples);
+  if (stratified) {
+    for (long long i = 0; i < samples; i++) {
+      std::uniform_int_distribution<long long> stratum(i * entries / samples, (i + 1) * entries / samples - 1);
+      drawn.push_back(stratum(generator));
+    }
+  } else {
+    // Floyd's algorithm, distinct entries without building a list of the whole file
+    std::unordered_set<long long> chosen;
+    for (long long j = entries - samples; j < entries; j++) {
+      long long entry = std::uniform_int_distribution<long long>(0, j)(generator);
+      if (!chosen.insert(entry).second) {
+        entry = j;
+        chosen.insert(entry);
+      }
+      drawn.push_back(entry);
+    }
+  }
+  std::shuffle(drawn.begin(), drawn.end(), generator);
+  size_t round = kFirstRound;
+  for (size_t begin = 0; begin < drawn.size(); begin += round, round *= 2)
+    std::sort(drawn.begin() + begin, drawn.begin() + std::min(drawn.size(), begin + round));
+  return drawn;
+}
+
+bool EventSampler::run(const std::string& dataFile, long long samples, bool stratified, uint64_t seed,
+                       const std::atomic<bool>& cancel)
+{
+  fEntries = 0;
+  fHits[0] = fHits[1] = 0.;
+  fStrips[0] = fStrips[1] = 0.;
+  fLayers.clear();
+  fStripCounts.clear();
+  {
+    std::lock_guard<std::mutex> lock(fEstimateMutex);
+    fEstimate = SampleEstimate();
+  }
+  DataProcessor processor;
+  if (!processor.openFile(dataFile.c_str()))
+    return false;
+  // strips which never fire in the sample still get an estimate
+  for (const auto& angle : processor.getStripAngles()) {
+    fStripCounts[angle.first] = 0;
+    fLayers[angle.first.first] = std::make_pair(0., 0.);
+  }
+  fPopulation = processor.getNumberOfEvents();
+  fStratified = stratified;
+  const std::vector<long long> entries = drawEntries(fPopulation, samples, stratified, seed);
+  fRequested = entries.size();
+
+  auto start = std::chrono::steady_clock::now();
+  size_t round = kFirstRound;
+  for (size_t begin = 0; begin < entries.size(); begin += round, round *= 2) {
+    const size_t end = std::min(entries.size(), begin + round);
+    for (size_t i = begin; i < end; i++) {
+      if (cancel)
+        return false;
+      if (processor.nthEvent(entries[i]))
+        addEntry(processor.getChannelHits());
+    }
+    publish();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  INFO(std::string("Sampled " + std::to_string(fEntries) + " of " + std::to_string(fPopulation)
+                   + " entries of " + dataFile + " in " + std::to_string(seconds) + " s"));
+  return true;
+}
+
+void EventSampler::addEntry(const ChannelHits& hits)
+{
+  ScintillatorsInLayers selection = selectionFromHits(hits);
+  double strips = 0.;
+  for (const auto& layer : selection) {
+    const double fired = layer.second.size();
+    std::pair<double, double>& sums = fLayers[layer.first];
+    sums.first += fired;
+    sums.second += fired * fired;
+    strips += fired;
+    for (int strip : layer.second)
+      fStripCounts[std::make_pair(layer.first, strip)]++;
+  }
+  fHits[0] += hits.size();
+  fHits[1] += static_cast<double>(hits.size()) * hits.size();
+  fStrips[0] += strips;
+  fStrips[1] += strips * strips;
+  fEntries++;
+}
+
+void EventSampler::publish()
+{
+  SampleEstimate estimate;
+  estimate.sampled = fEntries;
+  estimate.requested = fRequested;
+  estimate.population = fPopulation;
+  estimate.stratified = fStratified;
+  const double correction = fPopulation > 1 ? static_cast<double>(fPopulation - fEntries) / (fPopulation - 1) : 0.;
+  estimate.hitsPerEntry = meanInterval(fHits[0], fHits[1], fEntries, correction);
+  estimate.stripsPerEntry = meanInterval(fStrips[0], fStrips[1], fEntries, correction);
+  for (const auto& layer : fLayers)
+    estimate.layers[layer.first] = meanInterval(layer.second.first, layer.second.second, fEntries, correction);
+  for (const auto& strip : fStripCounts)
+    estimate.strips[strip.first] = wilsonInterval(strip.second, fEntries, correction);
+  std::lock_guard<std::mutex> lock(fEstimateMutex);
+  fEstimate = std::move(estimate);
+}
+
+SampleEstimate EventSampler::getEstimate() const
+{
+  std::lock_guard<std::mutex> lock(fEstimateMutex);
+  return fEstimate;
+}
+
+std::string EventSampler::describe(const SampleEstimate& estimate, size_t maxLines)
+{
+  std::ostringstream oss;
+  oss.precision(3);
+  oss << "sampled " << estimate.sampled << " of " << estimate.population << " entries ("
+      << (estimate.stratified ? "stratified" : "uniform");
+  if (estimate.sampled < estimate.requested)
+    oss << ", " << estimate.requested << " requested";
+  oss << "), 95% CL\nhits per entry: ";
+  printInterval(oss, estimate.hitsPerEntry);
+  oss << "\nstrips per entry: ";
+  printInterval(oss, estimate.stripsPerEntry);
+  oss << "\n";
+  for (const auto& layer : estimate.layers) {
+    oss << "layer " << layer.first << ": ";
+    printInterval(oss, layer.second);
+    oss << " strips\n";
+  }
+
+  std::map<int, std::vector<double> > layerValues;
+  for (const auto& strip : estimate.strips)
+    layerValues[strip.first.first].push_back(strip.second.value);
+  std::map<int, double> medians;
+  for (auto& values : layerValues) {
+    std::nth_element(values.second.begin(), values.second.begin() + values.second.size() / 2, values.second.end());
+    medians[values.first] = values.second[values.second.size() / 2];
+  }
+  size_t lines = 0, skipped = 0;
+  for (const auto& strip : estimate.strips) {
+    const double median = medians[strip.first.first];
+    const bool low = strip.second.high < kLowFactor * median;
+    const bool high = median > 0. && strip.second.low > kHighFactor * median;
+    if (!low && !high)
+      continue;
+    if (maxLines > 0 && lines == maxLines) {
+      skipped++;
+      continue;
+    }
+    oss << "layer " << strip.first.first << " strip " << strip.first.second << ": " << (low ? "low " : "high ");
+    printInterval(oss, strip.second);
+    oss << " (median " << median << ")\n";
+    lines++;
+  }
+  if (skipped)
+    oss << "... " << skipped << " more\n";
+  return oss.str();
+}
+
+}
@@ -0,0 +1,103 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventSampler.h
+ *  @brief Estimates occupancy and multiplicity of a run from a random sample of entries.
+ */
+
+#ifndef EVENTSAMPLER_H
+#define EVENTSAMPLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "EventData.h"
+
+namespace jpet_event_display
+{
+
+/// estimate with its 95% confidence interval
+struct SampleInterval
+{
+  double value = 0.;
+  double low = 0.;
+  double high = 0.;
+};
+
+struct SampleEstimate
+{
+  long long sampled = 0;
+  long long requested = 0;
+  long long population = 0;
+  bool stratified = false;
+  SampleInterval hitsPerEntry;
+  SampleInterval stripsPerEntry;
+  /// layer -> fired strips per entry
+  std::map<int, SampleInterval> layers;
+  /// (layer, strip) -> fraction of entries in which the strip fired
+  std::map<std::pair<int, int>, SampleInterval> strips;
+};
+
+/**
+ * Reads K entries instead of the whole file. The sample is split into
+ * rounds of doubling size, each a sample of the whole run read in entry
+ * order, so reads stay mostly forward while the estimate published after
+ * every round is never biased towards the beginning of the file.
+ * Stratified samples take one entry from each of K equal entry ranges.
+ * Intervals include the finite population correction: Wilson intervals
+ * for strip occupancies, normal ones for the per entry means.
+ */
+class EventSampler
+{
+public:
+  EventSampler() {}
+
+  /// sorted only within rounds, see above
+  static std::vector<long long> drawEntries(long long entries, long long samples, bool stratified, uint64_t seed);
+  bool run(const std::string& dataFile, long long samples, bool stratified, uint64_t seed,
+           const std::atomic<bool>& cancel);
+  /// estimate after the last complete round, safe to call while run() is going
+  SampleEstimate getEstimate() const;
+  /// multiplicities, then strips whose interval lies far below or above the median of their layer
+  static std::string describe(const SampleEstimate& estimate, size_t maxLines = 0);
+
+private:
+  EventSampler(const EventSampler&) = delete;
+  EventSampler& operator=(const EventSampler&) = delete;
+
+  static const long long kFirstRound = 32;
+
+  void addEntry(const ChannelHits& hits);
+  void publish();
+
+  long long fEntries = 0;
+  long long fRequested = 0;
+  long long fPopulation = 0;
+  bool fStratified = false;
+  /// sums and sums of squares of per entry values
+  double fHits[2] = {0., 0.};
+  double fStrips[2] = {0., 0.};
+  std::map<int, std::pair<double, double> > fLayers;
+  /// (layer, strip) -> entries in which it fired, known strips start at 0
+  std::map<std::pair<int, int>, long long> fStripCounts;
+
+  mutable std::mutex fEstimateMutex;
+  SampleEstimate fEstimate;
+};
+
+}
+
+#endif /*  !EVENTSAMPLER_H */
@@ -0,0 +1,259 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventSelectionFile.cpp
+ */
+
+#include "EventSelectionFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace jpet_event_display
+{
+
+using namespace event_selection_format;
+
+namespace
+{
+const char kMagic[8] = {'J', 'P', 'E', 'T', 'S', 'E', 'L', '1'};
+const char kFooterMagic[8] = {'J', 'P', 'E', 'T', 'S', 'E', 'L', 'E'};
+const uint32_t kVersion = 1;
+const uint32_t kCodecRaw = 0;
+const size_t kHeaderSize = 16;
+const size_t kFooterSize = 32;
+
+inline size_t padded(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+/// byte offsets of the columns inside a block payload
+struct BlockLayout
+{
+  size_t hitOffsets, layers, strips, pmIDs, sides, leading, times, thresholds, total;
+
+  BlockLayout(uint32_t events, uint32_t hits)
+  {
+    hitOffsets = 0;
+    layers = hitOffsets + padded((static_cast<size_t>(events) + 1) * sizeof(uint32_t));
+    strips = layers + padded(hits * sizeof(uint16_t));
+    pmIDs = strips + padded(hits * sizeof(uint16_t));
+    sides = pmIDs + padded(hits * sizeof(int32_t));
+    leading = sides + padded(hits * sizeof(char));
+    times = leading + padded(hits * sizeof(uint8_t));
+    thresholds = times + padded(hits * sizeof(double));
+    total = thresholds + padded(hits * sizeof(float));
+  }
+};
+
+template <typename Column, typename Value>
+void writeColumn(std::ofstream& out, const std::vector<Value>& values)
+{
+  std::vector<Column> column(values.begin(), values.end());
+  if (!column.empty())
+    out.write(reinterpret_cast<const char*>(&column[0]), column.size() * sizeof(Column));
+  static const char zeros[8] = {0};
+  size_t bytes = column.size() * sizeof(Column);
+  out.write(zeros, padded(bytes) - bytes);
+}
+
+template <typename Column, typename Value>
+void readColumn(const char* payload, size_t offset, uint32_t begin, uint32_t end, std::vector<Value>& values)
+{
+  const Column* column = reinterpret_cast<const Column*>(payload + offset);
+  values.assign(column + begin, column + end);
+}
+}
+
+EventSelectionWriter::EventSelectionWriter(size_t eventsPerBlock) :
+  fEventsPerBlock(eventsPerBlock > 0 ? eventsPerBlock : 1)
+{
+}
+
+EventSelectionWriter::~EventSelectionWriter()
+{
+  abort();
+}
+
+bool EventSelectionWriter::open(const std::string& filename)
+{
+  abort();
+  fFilename = filename;
+  fOut.open(getTemporaryName().c_str(), std::ios::binary | std::ios::trunc);
+  if (!fOut)
+    return false;
+  uint32_t flags = 0;
+  fOut.write(kMagic, sizeof(kMagic));
+  fOut.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+  fOut.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+  fEvents = 0;
+  fIndex.clear();
+  fBlockHits.clear();
+  fBlockHitOffsets.assign(1, 0);
+  return static_cast<bool>(fOut);
+}
+
+void EventSelectionWriter::addEvent(const ChannelHits& hits)
+{
+  for (size_t i = 0; i < hits.size(); i++)
+    fBlockHits.add(hits.layers[i], hits.strips[i], hits.pmIDs[i], hits.sides[i],
+                   hits.leading[i] != 0, hits.times[i], hits.thresholds[i]);
+  fBlockHitOffsets.push_back(fBlockHits.size());
+  fEvents++;
+  if (fBlockHitOffsets.size() - 1 >= fEventsPerBlock)
+    flushBlock();
+}
+
+void EventSelectionWriter::flushBlock()
+{
+  const uint32_t events = fBlockHitOffsets.size() - 1;
+  if (events == 0)
+    return;
+  const uint32_t hits = fBlockHits.size();
+  BlockIndexEntry entry;
+  entry.fileOffset = fOut.tellp();
+  entry.firstEvent = fEvents - events;
+  entry.events = events;
+  entry.hits = hits;
+  fIndex.push_back(entry);
+
+  BlockHeader header;
+  header.firstEvent = entry.firstEvent;
+  header.events = events;
+  header.hits = hits;
+  header.codec = kCodecRaw;
+  header.reserved = 0;
+  header.payloadBytes = BlockLayout(events, hits).total;
+  fOut.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  writeColumn<uint32_t>(fOut, fBlockHitOffsets);
+  writeColumn<uint16_t>(fOut, fBlockHits.layers);
+  writeColumn<uint16_t>(fOut, fBlockHits.strips);
+  writeColumn<int32_t>(fOut, fBlockHits.pmIDs);
+  writeColumn<char>(fOut, fBlockHits.sides);
+  writeColumn<uint8_t>(fOut, fBlockHits.leading);
+  writeColumn<double>(fOut, fBlockHits.times);
+  writeColumn<float>(fOut, fBlockHits.thresholds);
+
+  fBlockHits.clear();
+  fBlockHitOffsets.assign(1, 0);
+}
+
+bool EventSelectionWriter::close()
+{
+  if (!fOut.is_open())
+    return false;
+  flushBlock();
+  uint64_t indexOffset = fOut.tellp();
+  if (!fIndex.empty())
+    fOut.write(reinterpret_cast<const char*>(&fIndex[0]), fIndex.size() * sizeof(BlockIndexEntry));
+  uint64_t blocks = fIndex.size();
+  uint64_t events = fEvents;
+  fOut.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+  fOut.write(reinterpret_cast<const char*>(&blocks), sizeof(blocks));
+  fOut.write(reinterpret_cast<const char*>(&events), sizeof(events));
+  fOut.write(kFooterMagic, sizeof(kFooterMagic));
+  fOut.close();
+  if (!fOut || std::rename(getTemporaryName().c_str(), fFilename.c_str()) != 0) {
+    std::remove(getTemporaryName().c_str());
+    return false;
+  }
+  return true;
+}
+
+void EventSelectionWriter::abort()
+{
+  if (!fOut.is_open())
+    return;
+  fOut.close();
+  std::remove(getTemporaryName().c_str());
+}
+
+bool EventSelectionFile::isEventSelectionFile(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool EventSelectionFile::open(const std::string& filename)
+{
+  close();
+  if (!fFile.open(filename))
+    return false;
+  const char* data = fFile.data();
+  const size_t size = fFile.size();
+  if (size < kHeaderSize + kFooterSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0
+      || std::memcmp(data + size - sizeof(kFooterMagic), kFooterMagic, sizeof(kFooterMagic)) != 0) {
+    close();
+    return false;
+  }
+  const uint64_t* footer = reinterpret_cast<const uint64_t*>(data + size - kFooterSize);
+  const uint64_t indexOffset = footer[0];
+  fBlocks = footer[1];
+  fEvents = footer[2];
+  // written as is, so the index cannot be misaligned or overlap the footer
+  if (indexOffset % 8 != 0 || indexOffset > size - kFooterSize
+      || fBlocks > (size - kFooterSize - indexOffset) / sizeof(BlockIndexEntry)) {
+    close();
+    return false;
+  }
+  fIndex = reinterpret_cast<const BlockIndexEntry*>(data + indexOffset);
+  return true;
+}
+
+void EventSelectionFile::close()
+{
+  fFile.close();
+  fIndex = 0;
+  fBlocks = 0;
+  fEvents = 0;
+}
+
+bool EventSelectionFile::readEvent(long long entry, ChannelHits& hits) const
+{
+  hits.clear();
+  if (!fIndex || entry < 0 || entry >= fEvents)
+    return false;
+  const BlockIndexEntry* block = std::upper_bound(fIndex, fIndex + fBlocks, static_cast<uint64_t>(entry),
+      [](uint64_t value, const BlockIndexEntry& candidate) { return value < candidate.firstEvent; });
+  if (block == fIndex)
+    return false;
+  --block;
+  // a corrupt file fails here instead of reading past the mapping
+  const size_t size = fFile.size();
+  if (block->fileOffset % 8 != 0 || block->fileOffset > size || sizeof(BlockHeader) > size - block->fileOffset)
+    return false;
+  const BlockHeader* header = reinterpret_cast<const BlockHeader*>(fFile.data() + block->fileOffset);
+  const uint64_t local = static_cast<uint64_t>(entry) - header->firstEvent;
+  if (header->codec != kCodecRaw || header->payloadBytes > size - block->fileOffset - sizeof(BlockHeader)
+      || static_cast<uint64_t>(entry) < header->firstEvent || local >= header->events)
+    return false;
+  const char* payload = reinterpret_cast<const char*>(header + 1);
+  const BlockLayout layout(header->events, header->hits);
+  if (layout.total > header->payloadBytes)
+    return false;
+  const uint32_t* hitOffsets = reinterpret_cast<const uint32_t*>(payload + layout.hitOffsets);
+  const uint32_t begin = hitOffsets[local];
+  const uint32_t end = hitOffsets[local + 1];
+  if (begin > end || end > header->hits)
+    return false;
+
+  readColumn<uint16_t>(payload, layout.layers, begin, end, hits.layers);
+  readColumn<uint16_t>(payload, layout.strips, begin, end, hits.strips);
+  readColumn<int32_t>(payload, layout.pmIDs, begin, end, hits.pmIDs);
+  readColumn<char>(payload, layout.sides, begin, end, hits.sides);
+  readColumn<uint8_t>(payload, layout.leading, begin, end, hits.leading);
+  readColumn<double>(payload, layout.times, begin, end, hits.times);
+  readColumn<float>(payload, layout.thresholds, begin, end, hits.thresholds);
+  return true;
+}
+
+}
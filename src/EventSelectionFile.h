@@ -0,0 +1,117 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file EventSelectionFile.h
+ *  @brief Columnar file with fired channels per event, readable without ROOT.
+ *
+ *  Layout (little endian, every block starts at an 8 byte boundary):
+ *    "JPETSEL1" | uint32 version | uint32 flags
+ *    block*     : BlockHeader, then columns, each padded to 8 bytes:
+ *                 uint32 hitOffsets[events + 1], uint16 layer[hits],
+ *                 uint16 strip[hits], int32 pmID[hits], char side[hits],
+ *                 uint8 leading[hits], double time[hits], float threshold[hits]
+ *    index      : BlockIndexEntry[blocks]
+ *    footer     : uint64 indexOffset | uint64 blocks | uint64 events | "JPETSELE"
+ *  BlockHeader::codec is reserved for compressed blocks, only 0 (raw) is
+ *  written and read for now.
+ */
+
+#ifndef EVENTSELECTIONFILE_H
+#define EVENTSELECTIONFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "EventData.h"
+#include "MappedFile.h"
+
+namespace jpet_event_display
+{
+
+namespace event_selection_format
+{
+struct BlockHeader
+{
+  uint64_t firstEvent;
+  uint32_t events;
+  uint32_t hits;
+  uint32_t codec;
+  uint32_t reserved;
+  uint64_t payloadBytes;
+};
+
+struct BlockIndexEntry
+{
+  uint64_t fileOffset;
+  uint64_t firstEvent;
+  uint32_t events;
+  uint32_t hits;
+};
+}
+
+class EventSelectionWriter
+{
+public:
+  explicit EventSelectionWriter(size_t eventsPerBlock = 4096);
+  ~EventSelectionWriter();
+
+  /// the events go to filename.tmp until close()
+  bool open(const std::string& filename);
+  void addEvent(const ChannelHits& hits);
+  /// writes the last block and the index, then renames the file to its final name
+  bool close();
+  /// drops the output, also done by the destructor of a writer which was not closed
+  void abort();
+
+private:
+  EventSelectionWriter(const EventSelectionWriter&) = delete;
+  EventSelectionWriter& operator=(const EventSelectionWriter&) = delete;
+
+  void flushBlock();
+  inline std::string getTemporaryName() const { return fFilename + ".tmp"; }
+
+  std::ofstream fOut;
+  std::string fFilename;
+  size_t fEventsPerBlock;
+  uint64_t fEvents = 0;
+  ChannelHits fBlockHits;
+  std::vector<uint32_t> fBlockHitOffsets;
+  std::vector<event_selection_format::BlockIndexEntry> fIndex;
+};
+
+class EventSelectionFile
+{
+public:
+  EventSelectionFile() {}
+
+  static bool isEventSelectionFile(const std::string& filename);
+  bool open(const std::string& filename);
+  void close();
+  inline long long getNumberOfEvents() const { return fEvents; }
+  /// O(log blocks) seek, then the columns of the entry are copied into hits
+  bool readEvent(long long entry, ChannelHits& hits) const;
+
+private:
+  EventSelectionFile(const EventSelectionFile&) = delete;
+  EventSelectionFile& operator=(const EventSelectionFile&) = delete;
+
+  MappedFile fFile;
+  const event_selection_format::BlockIndexEntry* fIndex = 0;
+  uint64_t fBlocks = 0;
+  long long fEvents = 0;
+};
+
+}
+
+#endif /*  !EVENTSELECTIONFILE_H */
@@ -0,0 +1,100 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file FileProbe.cpp
+ */
+
+#include "FileProbe.h"
+#include "CommonTools.h"
+#include "EventSelectionFile.h"
+#include <JPetTreeHeader/JPetTreeHeader.h>
+#include <TBranch.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+namespace jpet_event_display
+{
+
+FileMetadata FileProbe::probe(const std::string& filename)
+{
+  FileMetadata metadata;
+  metadata.path = filename;
+  long long time = 0;
+  if (!CommonTools::getFileStamp(filename, metadata.size, time))
+    return metadata;
+  if (EventSelectionFile::isEventSelectionFile(filename)) {
+    EventSelectionFile selection;
+    if (selection.open(filename)) {
+      metadata.type = "selection";
+      metadata.entries = selection.getNumberOfEvents();
+    }
+    return metadata;
+  }
+  std::unique_ptr<TFile> file(TFile::Open(filename.c_str(), "READ"));
+  if (!file || file->IsZombie())
+    return metadata;
+  // the tree belongs to the file, the header object to us
+  TTree* tree = dynamic_cast<TTree*>(file->Get("tree"));
+  TBranch* branch = tree ? dynamic_cast<TBranch*>(tree->GetListOfBranches()->At(0)) : 0;
+  if (!branch)
+    return metadata;
+  metadata.type = branch->GetClassName();
+  metadata.entries = tree->GetEntries();
+  std::unique_ptr<JPetTreeHeader> header(dynamic_cast<JPetTreeHeader*>(file->Get("header")));
+  if (header)
+    metadata.runID = header->getRunNumber();
+  return metadata;
+}
+
+std::vector<FileMetadata> FileProbe::probeAll(const std::vector<std::string>& files, unsigned threads,
+                                              const std::atomic<bool>& cancel)
+{
+  std::vector<FileMetadata> results(files.size());
+  std::atomic<size_t> next(0);
+  auto work = [&] {
+    for (size_t i = next++; i < files.size() && !cancel; i = next++)
+      results[i] = probe(files[i]);
+  };
+  // mostly waiting for small reads, so more threads than files would only idle
+  threads = std::max(1u, std::min<unsigned>(threads, files.size()));
+  std::vector<std::thread> workers;
+  for (unsigned i = 1; i < threads; i++)
+    workers.push_back(std::thread(work));
+  work();
+  for (auto& worker : workers)
+    worker.join();
+  return results;
+}
+
+std::string FileProbe::describe(const FileMetadata& metadata)
+{
+  std::ostringstream oss;
+  oss.precision(3);
+  const size_t slash = metadata.path.find_last_of('/');
+  oss << (slash == std::string::npos ? metadata.path : metadata.path.substr(slash + 1)) << "  ";
+  if (!metadata.ok())
+    return oss.str() + "unreadable";
+  std::string type = metadata.type;
+  if (type.compare(0, 4, "JPet") == 0)
+    type = type.substr(4);
+  oss << type << ", " << metadata.entries << " entries, " << metadata.size / 1024. / 1024. << " MB";
+  if (metadata.runID >= 0)
+    oss << ", run " << metadata.runID;
+  return oss.str();
+}
+
+}
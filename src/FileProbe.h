@@ -0,0 +1,59 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file FileProbe.h
+ *  @brief Reads type, entries and run number of data files without opening them for reading events.
+ */
+
+#ifndef FILEPROBE_H
+#define FILEPROBE_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace jpet_event_display
+{
+
+struct FileMetadata
+{
+  std::string path;
+  /// class of the event branch, "selection" for exported files, empty if unreadable
+  std::string type;
+  long long entries = 0;
+  long long size = 0;
+  int runID = -1;
+  inline bool ok() const { return !type.empty(); }
+};
+
+/**
+ * Only the tree header and the tree header object of the framework are
+ * read: no baskets, no param bank and no mapper, unlike
+ * DataProcessor::openFile, so a probe costs a few small reads per file.
+ */
+class FileProbe
+{
+public:
+  static FileMetadata probe(const std::string& filename);
+  /// probes on up to threads threads, results are in the order of files
+  static std::vector<FileMetadata> probeAll(const std::vector<std::string>& files, unsigned threads,
+                                            const std::atomic<bool>& cancel);
+  /// name, type, entries, size and run, one line
+  static std::string describe(const FileMetadata& metadata);
+
+private:
+  FileProbe() = delete;
+};
+
+}
+
+#endif /*  !FILEPROBE_H */
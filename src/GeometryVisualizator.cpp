@@ -14,41 +14,153 @@
  */
 
 #include "GeometryVisualizator.h"
+#include "ResourceMonitor.h"
 #include <JPetLoggerInclude.h>
 #include <TCanvas.h>
+#include <TColor.h>
 #include <TFile.h>
+#include <TGeoBBox.h>
+#include <TMemFile.h>
 
 #include <TPolyLine3D.h>
+#include <TList.h>
 #include <TRandom.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
 #include <memory>
 
 namespace jpet_event_display
 {
 
-GeometryVisualizator::GeometryVisualizator() { }
+namespace
+{
+/// number in a node name like layer_2_1 or XStrip_17, 0 if it has none
+int nodeNumber(const TGeoNode* node, const char* format)
+{
+  int number = 0;
+  return std::sscanf(node->GetName(), format, &number) == 1 && number > 0 ? number : 0;
+}
+
+/// nodes ordered by the number in their name, unnamed ones after them in daughter order
+std::vector<TGeoNode*> orderedDaughters(TGeoVolume* volume, const char* format)
+{
+  std::vector<std::pair<int, TGeoNode*> > numbered;
+  std::vector<TGeoNode*> unnumbered;
+  for (int i = 0; i < volume->GetNdaughters(); i++) {
+    TGeoNode* node = volume->GetNode(i);
+    int number = nodeNumber(node, format);
+    if (number > 0)
+      numbered.push_back(std::make_pair(number, node));
+    else
+      unnumbered.push_back(node);
+  }
+  std::stable_sort(numbered.begin(), numbered.end(),
+                   [](const std::pair<int, TGeoNode*>& a, const std::pair<int, TGeoNode*>& b) { return a.first < b.first; });
+  std::vector<TGeoNode*> nodes;
+  for (const auto& node : numbered) {
+    nodes.resize(std::max<size_t>(nodes.size(), node.first - 1), 0);
+    nodes.push_back(node.second);
+  }
+  nodes.insert(nodes.end(), unnumbered.begin(), unnumbered.end());
+  return nodes;
+}
+}
+
+GeometryVisualizator::GeometryVisualizator() : allScintilatorsCanv(0) { }
+
+  GeometryVisualizator::~GeometryVisualizator()
+  {
+    // graphs are owned by fDiagramGraphs, not by the multigraph
+    if (fDiagramMultiGraph && fDiagramMultiGraph->GetListOfGraphs())
+      fDiagramMultiGraph->GetListOfGraphs()->Clear("nodelete");
+  }
+
+  bool GeometryVisualizator::acquireCanvas(std::unique_ptr<TCanvas>& canvas,
+                                           const std::unique_ptr<TRootEmbeddedCanvas>& rootCanvas)
+  {
+    if (canvas)
+      return true;
+    if (rootCanvas == 0) {
+      WARNING("Canvas not set");
+      return false;
+    }
+    canvas = std::unique_ptr<TCanvas>(rootCanvas->GetCanvas());
+    return true;
+  }
+
+  void GeometryVisualizator::createBatchCanvases(int width, int height)
+  {
+    fCanvas3d = std::unique_ptr<TCanvas>(new TCanvas("batch3dViewCanvas", "3d view", width, height));
+    fCanvas2d = std::unique_ptr<TCanvas>(new TCanvas("batch2dViewCanvas", "2d view", width, height));
+    fCanvasDiagrams = std::unique_ptr<TCanvas>(new TCanvas("batchDiagramCanvas", "Diagram view", width, height));
+  }
 
-  GeometryVisualizator::~GeometryVisualizator() { }
+  void GeometryVisualizator::saveViews(const std::string& prefix, const std::string& format,
+                                       bool save3d, bool save2d, bool saveDiagram)
+  {
+    if (save3d && fCanvas3d)
+      fCanvas3d->SaveAs((prefix + "_3d." + format).c_str());
+    if (save2d && fCanvas2d)
+      fCanvas2d->SaveAs((prefix + "_2d." + format).c_str());
+    if (saveDiagram && fCanvasDiagrams)
+      fCanvasDiagrams->SaveAs((prefix + "_diagram." + format).c_str());
+  }
 
-  void GeometryVisualizator::loadGeometry(const std::string& geomFile)
+  bool GeometryVisualizator::loadGeometry(const std::string& geomFile)
   {
     std::shared_ptr<TFile> inputGeomFile = std::make_shared<TFile>(static_cast<TString>(geomFile));
-    if (inputGeomFile->IsZombie()) {
+    return readGeoManager(*inputGeomFile, geomFile);
+  }
+
+  bool GeometryVisualizator::loadGeometry(const std::string& geomFile, const std::string& contents)
+  {
+    // TMemFile copies the buffer, it is never written through
+    TMemFile inputGeomFile(geomFile.c_str(), const_cast<char*>(contents.data()), contents.size());
+    return readGeoManager(inputGeomFile, geomFile);
+  }
+
+  bool GeometryVisualizator::readGeoManager(TFile& inputGeomFile, const std::string& geomFile)
+  {
+    if (inputGeomFile.IsZombie()) {
       assert(1 == 0);
       ERROR(std::string("Error opening file:" + geomFile));
-      return;
+      return false;
     }
-    fGeoManager = std::unique_ptr<TGeoManager>(static_cast<TGeoManager*>(inputGeomFile->Get("mgr")));
+    fGeoManager = std::unique_ptr<TGeoManager>(static_cast<TGeoManager*>(inputGeomFile.Get("mgr")));
     assert(fGeoManager);
+    if (!fGeoManager)
+      return false;
+    buildNodeTable();
+    return true;
+  }
+
+  /// Layers (or modules) are the daughters of the top volume and strips their
+  /// daughters, numbered from the node names where the names carry a number.
+  /// Lookups by layer and strip number are then plain indexing.
+  void GeometryVisualizator::buildNodeTable()
+  {
+    fLayerNodes = orderedDaughters(fGeoManager->GetTopVolume(), "layer_%d");
+    fStripNodes.assign(fLayerNodes.size(), std::vector<TGeoNode*>());
+    for (size_t i = 0; i < fLayerNodes.size(); i++) {
+      if (fLayerNodes[i])
+        fStripNodes[i] = orderedDaughters(fLayerNodes[i]->GetVolume(), "XStrip_%d");
+    }
+  }
+
+  TGeoNode* GeometryVisualizator::getStripNode(int layer, int strip) const
+  {
+    if (layer < 1 || layer > static_cast<int>(fStripNodes.size()) ||
+        strip < 1 || strip > static_cast<int>(fStripNodes[layer - 1].size()))
+      return 0;
+    return fStripNodes[layer - 1][strip - 1];
   }
 
   void GeometryVisualizator::drawOnlyGeometry()
   {
-    if (fRootCanvas3d == 0) {
-      WARNING("Canvas not set");
+    if (!acquireCanvas(fCanvas3d, fRootCanvas3d))
       return;
-    }
-    if(fCanvas3d == 0)
-      fCanvas3d = std::unique_ptr<TCanvas>(fRootCanvas3d->GetCanvas());
     setAllStripsUnvisible();
     //fGeoManager->GetTopVolume()->Draw();
     drawPads();
@@ -59,53 +171,107 @@ GeometryVisualizator::GeometryVisualizator() { }
     draw2dGeometry();
   }
 
+  /// The 2d view is the transverse plane: every strip is a box at the (x, y)
+  /// of its centre, so barrels with any number of layers and modular
+  /// detectors are laid out the same way. Strips at about the same radius
+  /// form a ring with an angular lookup table used for picking.
   void GeometryVisualizator::draw2dGeometry()
   {
-    if (fRootCanvas2d == 0) {
-      WARNING("Canvas not set");
+    if (!acquireCanvas(fCanvas2d, fRootCanvas2d))
       return;
-    }
-    if(fCanvas2d == 0)
-      fCanvas2d = std::unique_ptr<TCanvas>(fRootCanvas2d->GetCanvas());
-    const int marginBetweenScin = 5;
-    const int marginBetweenLayers = 10;
-    const int topMargin = 10;
-    const int bottomMargin = 10;
-    const int leftMargin = 20;
-    const int rightMargin = 20;
-    const int canvasScale = 900;
-    int startX = canvasScale - leftMargin;
-    int startY = canvasScale - topMargin;
-    int canvasWidth = canvasScale - leftMargin - rightMargin;
-    int canvasHeight = canvasScale - topMargin - bottomMargin;
+    const double canvasScale = 900;
+    const double margin = 20;
     fCanvas2d->cd();
     fCanvas2d->Range(0, 0, canvasScale, canvasScale);
-    TGeoVolume* topVolume = fGeoManager->GetTopVolume();
-    numberOfLayers = topVolume->GetNdaughters();
+    numberOfLayers = fStripNodes.size();
     numberOfScintilatorsInLayer = new int[numberOfLayers];
     if(numberOfLayers == 0)
       return;
-    double layerWidth = (canvasWidth - (marginBetweenLayers * numberOfLayers)) / numberOfLayers;
+
+    struct StripCentre { int layer; int strip; double radius; double angle; };
+    std::vector<StripCentre> centres;
+    for (int i = 0; i < numberOfLayers; i++) {
+      numberOfScintilatorsInLayer[i] = fStripNodes[i].size();
+      for (int j = 0; j < numberOfScintilatorsInLayer[i]; j++) {
+        double centre[3];
+        if (getStripCenter(i + 1, j + 1, centre))
+          centres.push_back(StripCentre{i, j, std::hypot(centre[0], centre[1]), std::atan2(centre[1], centre[0])});
+      }
+    }
+    std::sort(centres.begin(), centres.end(),
+              [](const StripCentre& a, const StripCentre& b) { return a.radius < b.radius; });
+
+    // strips closer in radius than kRingTolerance share a ring
+    fStripRings.clear();
+    fPickStrips.clear();
+    std::vector<std::vector<const StripCentre*> > ringStrips;
+    for (const auto& centre : centres) {
+      if (ringStrips.empty() || centre.radius - ringStrips.back().front()->radius > kRingTolerance)
+        ringStrips.push_back(std::vector<const StripCentre*>());
+      ringStrips.back().push_back(&centre);
+    }
+    std::vector<double> halfSizes(ringStrips.size());
+    double maxRadius = 0;
+    for (size_t r = 0; r < ringStrips.size(); r++) {
+      std::vector<const StripCentre*>& ring = ringStrips[r];
+      std::sort(ring.begin(), ring.end(), [](const StripCentre* a, const StripCentre* b) { return a->angle < b->angle; });
+      double radius = 0;
+      for (const StripCentre* centre : ring)
+        radius += centre->radius / ring.size();
+      double minGap = 2 * M_PI;
+      for (size_t k = 0; k < ring.size(); k++) {
+        double gap = k + 1 < ring.size() ? ring[k + 1]->angle - ring[k]->angle : ring[0]->angle + 2 * M_PI - ring[k]->angle;
+        if (gap > 0)
+          minGap = std::min(minGap, gap);
+      }
+      double radialGap = std::numeric_limits<double>::max();
+      if (r > 0)
+        radialGap = std::min(radialGap, ringStrips[r][0]->radius - ringStrips[r - 1].back()->radius);
+      if (r + 1 < ringStrips.size())
+        radialGap = std::min(radialGap, ringStrips[r + 1][0]->radius - ring.back()->radius);
+      halfSizes[r] = 0.45 * std::min(minGap * radius, radialGap);
+      StripRing stripRing;
+      stripRing.radius = radius;
+      stripRing.halfWidth = std::max(radius - ring.front()->radius, ring.back()->radius - radius) + halfSizes[r];
+      stripRing.lut.assign(kAngularBins, -1);
+      for (const StripCentre* centre : ring) {
+        // a bin belongs to the strip whose box covers its angle
+        const double halfAngle = halfSizes[r] / std::max(centre->radius, halfSizes[r]);
+        const int firstBin = static_cast<int>(std::floor((centre->angle - halfAngle + M_PI) / (2 * M_PI) * kAngularBins));
+        const int lastBin = static_cast<int>(std::floor((centre->angle + halfAngle + M_PI) / (2 * M_PI) * kAngularBins));
+        for (int bin = firstBin; bin <= lastBin; bin++)
+          stripRing.lut[(bin % kAngularBins + kAngularBins) % kAngularBins] = fPickStrips.size();
+        fPickStrips.push_back(std::make_pair(centre->layer, centre->strip));
+      }
+      fStripRings.push_back(stripRing);
+      maxRadius = std::max(maxRadius, ring.back()->radius + halfSizes[r]);
+    }
+    f2dCentre = canvasScale / 2;
+    f2dScale = maxRadius > 0 ? (canvasScale / 2 - margin) / maxRadius : 1.;
+
     allScintilatorsCanv = new ScintillatorCanv *[numberOfLayers];
     for (int i = 0; i < numberOfLayers; i++) {
-      TGeoNode* node = topVolume->GetNode(i);
-      numberOfScintilatorsInLayer[i] = node->GetNdaughters();
-      double scintilatorHeight = canvasHeight / numberOfScintilatorsInLayer[i];
-      allScintilatorsCanv[i] =
-          new ScintillatorCanv[numberOfScintilatorsInLayer[i]];
+      allScintilatorsCanv[i] = new ScintillatorCanv[numberOfScintilatorsInLayer[i]];
+      for (int j = 0; j < numberOfScintilatorsInLayer[i]; j++)
+        allScintilatorsCanv[i][j].image = 0;
+    }
+    for (size_t r = 0; r < ringStrips.size(); r++) {
+      const double half = halfSizes[r] * f2dScale;
+      for (const StripCentre* centre : ringStrips[r]) {
+        const double x = f2dCentre + centre->radius * std::cos(centre->angle) * f2dScale;
+        const double y = f2dCentre + centre->radius * std::sin(centre->angle) * f2dScale;
+        allScintilatorsCanv[centre->layer][centre->strip].image = new TBox(x - half, y - half, x + half, y + half);
+      }
+    }
+    for (int i = 0; i < numberOfLayers; i++) {
       for (int j = 0; j < numberOfScintilatorsInLayer[i]; j++) {
-        allScintilatorsCanv[i][j].image = new TBox(
-            leftMargin + (layerWidth * i), 
-            startY - ((j + 1) * scintilatorHeight) + marginBetweenScin, 
-            leftMargin + (layerWidth * (i + 1)) - marginBetweenLayers, 
-            startY - (j * scintilatorHeight)
-            );
-        allScintilatorsCanv[i][j].image->SetFillColor(1);
-        allScintilatorsCanv[i][j].image->Draw();
-        //allScintilatorsCanv[i][j].event = new TMarker(0.5, 0.5, 3);
-        //allScintilatorsCanv[i][j].event->SetMarkerColor(2);
-        //allScintilatorsCanv[i][j].event->SetMarkerSize(3);
-        //allScintilatorsCanv[i][j].event->Draw();
+        TBox*& box = allScintilatorsCanv[i][j].image;
+        if (!box) // strip missing from the geometry, kept so indices stay valid
+          box = new TBox(f2dCentre, f2dCentre, f2dCentre, f2dCentre);
+        box->SetFillColor(1);
+        // picking goes through the angular table, the pad need not test every box
+        box->SetBit(TObject::kCannotPick);
+        box->Draw();
       }
     }
 
@@ -120,7 +286,7 @@ GeometryVisualizator::GeometryVisualizator() { }
     {
       for(int j = 0; j < numberOfScintilatorsInLayer[i]; j++)
       {
-        allScintilatorsCanv[i][j].image->SetFillColor(1);
+        allScintilatorsCanv[i][j].image->SetFillColor(baseColor2d(i, j));
       }
     }
     fCanvas2d->Modified();
@@ -136,7 +302,8 @@ GeometryVisualizator::GeometryVisualizator() { }
         int strip = *stripIter - 1; // scintilators start from 1
         if (layer < numberOfLayers && layer >= 0 &&
             strip < numberOfScintilatorsInLayer[layer] && strip >= 0) {
-          allScintilatorsCanv[layer][strip].image->SetFillColor(2);
+          allScintilatorsCanv[layer][strip].image->SetFillColor(
+              isStripSelected2d(layer, strip) ? kGreen : kRed);
         }
       }
     }
@@ -145,6 +312,12 @@ GeometryVisualizator::GeometryVisualizator() { }
   }
 
   void GeometryVisualizator::drawStrips(const std::map<int, std::vector<int> >& selection)
+  {
+    drawStrips2d(selection);
+    drawStrips3d(selection);
+  }
+
+  void GeometryVisualizator::drawStrips3d(const std::map<int, std::vector<int> >& selection)
   {
     if (fCanvas3d == 0) {
       WARNING("Canvas not set");
@@ -154,6 +327,329 @@ GeometryVisualizator::GeometryVisualizator() { }
     drawPads();
   }
 
+  void GeometryVisualizator::drawStrips2d(const std::map<int, std::vector<int> >& selection)
+  {
+    if (fCanvas2d == 0) {
+      WARNING("Canvas not set");
+      return;
+    }
+    setAllStripsUnvisible2d();
+    setVisibility2d(selection);
+  }
+
+  void GeometryVisualizator::applyStripChanges2d(const std::vector<StripChange>& changes)
+  {
+    if (fCanvas2d == 0 || allScintilatorsCanv == 0)
+      return;
+    for (const auto& change : changes) {
+      int layer = change.layer - 1;
+      int strip = change.strip - 1;
+      if (layer < 0 || layer >= numberOfLayers || strip < 0 || strip >= numberOfScintilatorsInLayer[layer])
+        continue;
+      bool selected = isStripSelected2d(layer, strip);
+      allScintilatorsCanv[layer][strip].image->SetFillColor(
+          change.fired ? (selected ? kGreen : kRed) : baseColor2d(layer, strip));
+    }
+    fCanvas2d->Modified();
+    fCanvas2d->Update();
+  }
+
+  void GeometryVisualizator::applyStripChanges3d(const std::vector<StripChange>& changes)
+  {
+    if (fCanvas3d == 0 || !fGeoManager)
+      return;
+    for (const auto& change : changes) {
+      if (TGeoNode* nodeStrip = getStripNode(change.layer, change.strip))
+        nodeStrip->SetVisibility(change.fired);
+    }
+    // the painter reads node visibility when painting, no need to redraw the volume
+    fCanvas3d->Modified();
+    fCanvas3d->Update();
+  }
+
+  void GeometryVisualizator::drawCoincidences2d(const Coincidences& coincidences)
+  {
+    if (fCanvas2d == 0 || allScintilatorsCanv == 0)
+      return;
+    for (const auto& cluster : coincidences.clusters) {
+      for (const auto& pair : cluster.pairs) {
+        const StripHit* hits[] = {&coincidences.hits[pair.first], &coincidences.hits[pair.second]};
+        for (const StripHit* hit : hits) {
+          int layer = hit->layer - 1;
+          int strip = hit->strip - 1;
+          if (layer >= 0 && layer < numberOfLayers && strip >= 0 && strip < numberOfScintilatorsInLayer[layer])
+            allScintilatorsCanv[layer][strip].image->SetFillColor(kCoincidence);
+        }
+      }
+    }
+    fCanvas2d->Modified();
+    fCanvas2d->Update();
+  }
+
+  void GeometryVisualizator::drawCoincidences3d(const Coincidences& coincidences)
+  {
+    if (fCanvas3d == 0 || !fGeoManager)
+      return;
+    for (auto& line : fCoincidenceLines)
+      fCanvas3d->GetListOfPrimitives()->Remove(line.get());
+    fCoincidenceLines.clear();
+    fCanvas3d->cd();
+    for (const auto& cluster : coincidences.clusters) {
+      for (const auto& pair : cluster.pairs) {
+        const StripHit& first = coincidences.hits[pair.first];
+        const StripHit& second = coincidences.hits[pair.second];
+        double from[3], to[3];
+        if (!getStripCenter(first.layer, first.strip, from) || !getStripCenter(second.layer, second.strip, to))
+          continue;
+        std::unique_ptr<TPolyLine3D> line(new TPolyLine3D(2));
+        line->SetPoint(0, from[0], from[1], from[2]);
+        line->SetPoint(1, to[0], to[1], to[2]);
+        line->SetLineColor(kCoincidence);
+        line->SetLineWidth(2);
+        line->Draw();
+        fCoincidenceLines.push_back(std::move(line));
+      }
+    }
+    fCanvas3d->Modified();
+    fCanvas3d->Update();
+  }
+
+  /// All hits of the event go into kHitTimeBins markers, so the pad holds the
+  /// same few primitives for ten hits or ten thousand. Coordinate buffers are
+  /// kept between events and only copied into the markers.
+  void GeometryVisualizator::drawHits3d(const std::vector<StripHit>& hits)
+  {
+    if (fCanvas3d == 0 || !fGeoManager)
+      return;
+    if (fHitMarkers.empty()) {
+      for (int i = 0; i < kHitTimeBins; i++) {
+        fHitMarkers.push_back(std::unique_ptr<TPolyMarker3D>(new TPolyMarker3D(0, 20)));
+        int color = TColor::GetColorPalette(i * (TColor::GetNumberOfColors() - 1) / (kHitTimeBins - 1));
+        fHitMarkers.back()->SetMarkerColor(color);
+        fHitMarkers.back()->SetMarkerSize(0.8);
+      }
+      fHitCoordinates.resize(kHitTimeBins);
+    }
+    for (int i = 0; i < kHitTimeBins; i++) {
+      fCanvas3d->GetListOfPrimitives()->Remove(fHitMarkers[i].get());
+      fHitCoordinates[i].clear();
+    }
+    if (hits.empty()) {
+      fCanvas3d->Modified();
+      fCanvas3d->Update();
+      return;
+    }
+    auto range = std::minmax_element(hits.begin(), hits.end(),
+                                     [](const StripHit& a, const StripHit& b) { return a.time < b.time; });
+    const double firstTime = range.first->time;
+    const double timeSpan = range.second->time - firstTime;
+    for (const auto& hit : hits) {
+      double point[3];
+      // side A lies at negative local z, a hit closer to it reaches A first
+      if (!getStripPoint(hit.layer, hit.strip, 0.5 * kStripLightVelocity * hit.timeDifference, point))
+        continue;
+      int bin = timeSpan > 0 ? static_cast<int>((hit.time - firstTime) / timeSpan * kHitTimeBins) : 0;
+      std::vector<double>& coordinates = fHitCoordinates[std::min(bin, kHitTimeBins - 1)];
+      coordinates.insert(coordinates.end(), point, point + 3);
+    }
+    fCanvas3d->cd();
+    for (int i = 0; i < kHitTimeBins; i++) {
+      if (fHitCoordinates[i].empty())
+        continue;
+      fHitMarkers[i]->SetPolyMarker(fHitCoordinates[i].size() / 3, &fHitCoordinates[i][0], 20);
+      fHitMarkers[i]->Draw();
+    }
+    fCanvas3d->Modified();
+    fCanvas3d->Update();
+  }
+
+  bool GeometryVisualizator::getStripCenter(int layer, int strip, double center[3]) const
+  {
+    return getStripPoint(layer, strip, 0., center);
+  }
+
+  bool GeometryVisualizator::getStripPoint(int layer, int strip, double position, double point[3]) const
+  {
+    TGeoNode* nodeStrip = getStripNode(layer, strip);
+    if (!nodeStrip)
+      return false;
+    TGeoNode* nodeLayer = fLayerNodes[layer - 1];
+    if (const TGeoBBox* box = dynamic_cast<const TGeoBBox*>(nodeStrip->GetVolume()->GetShape()))
+      position = std::max(-box->GetDZ(), std::min(box->GetDZ(), position));
+    double local[3] = {0., 0., position};
+    double inLayer[3];
+    nodeStrip->LocalToMaster(local, inLayer);
+    nodeLayer->LocalToMaster(inLayer, point);
+    return true;
+  }
+
+  Color_t GeometryVisualizator::divergingColor(double value, double maxAbs)
+  {
+    const int paletteSize = 21;
+    if (fDivergingPalette.empty()) {
+      for (int i = 0; i < paletteSize; i++) {
+        float x = 2.f * i / (paletteSize - 1) - 1.f; // -1 .. 1
+        float fade = 1.f - std::fabs(x);
+        fDivergingPalette.push_back(x < 0 ? TColor::GetColor(fade, fade, 1.f)
+                                          : TColor::GetColor(1.f, fade, fade));
+      }
+    }
+    double x = maxAbs > 0 ? std::max(-1., std::min(1., value / maxAbs)) : 0.;
+    return fDivergingPalette[static_cast<int>(std::lround((x + 1.) / 2. * (paletteSize - 1)))];
+  }
+
+  void GeometryVisualizator::drawStripDifference2d(const ScintillatorsInLayers& first,
+                                                   const ScintillatorsInLayers& second)
+  {
+    if (fCanvas2d == 0 || allScintilatorsCanv == 0)
+      return;
+    std::map<std::pair<int, int>, double> difference;
+    for (const auto& layer : first)
+      for (int strip : layer.second)
+        difference[std::make_pair(layer.first, strip)] += 1.;
+    for (const auto& layer : second)
+      for (int strip : layer.second)
+        difference[std::make_pair(layer.first, strip)] -= 1.;
+    setAllStripsUnvisible2d();
+    for (const auto& strip : difference) {
+      int layer = strip.first.first - 1;
+      int index = strip.first.second - 1;
+      if (layer >= 0 && layer < numberOfLayers && index >= 0 && index < numberOfScintilatorsInLayer[layer])
+        allScintilatorsCanv[layer][index].image->SetFillColor(divergingColor(strip.second, 1.));
+    }
+    fCanvas2d->Modified();
+    fCanvas2d->Update();
+  }
+
+  void GeometryVisualizator::drawOccupancyRatio2d(const std::map<std::pair<int, int>, double>& logRatios,
+                                                  double maxAbs)
+  {
+    if (fCanvas2d == 0 || allScintilatorsCanv == 0)
+      return;
+    for (int i = 0; i < numberOfLayers; i++) {
+      for (int j = 0; j < numberOfScintilatorsInLayer[i]; j++) {
+        auto ratio = logRatios.find(std::make_pair(i + 1, j + 1));
+        allScintilatorsCanv[i][j].image->SetFillColor(
+            ratio == logRatios.end() ? Color_t(kBlack) : divergingColor(ratio->second, maxAbs));
+      }
+    }
+    fCanvas2d->Modified();
+    fCanvas2d->Update();
+  }
+
+  Color_t GeometryVisualizator::baseColor2d(int layerIndex, int stripIndex) const
+  {
+    if (isStripSelected2d(layerIndex, stripIndex))
+      return kBlue;
+    auto flag = fFlaggedStrips.find(std::make_pair(layerIndex + 1, stripIndex + 1));
+    if (flag == fFlaggedStrips.end())
+      return kBlack;
+    return flag->second == ChannelFlag::kHot ? kHot : kDead;
+  }
+
+  void GeometryVisualizator::setFlaggedStrips(const ChannelFlags& flags)
+  {
+    fFlaggedStrips.clear();
+    for (const auto& flag : flags) {
+      // a dead side is shown like a dead strip, a whole dead or hot strip wins
+      auto key = std::make_pair(flag.layer, flag.strip);
+      if (flag.kind != ChannelFlag::kDeadSide || fFlaggedStrips.find(key) == fFlaggedStrips.end())
+        fFlaggedStrips[key] = flag.kind == ChannelFlag::kHot ? ChannelFlag::kHot : ChannelFlag::kDead;
+    }
+    if (fCanvas2d && allScintilatorsCanv) {
+      for (int i = 0; i < numberOfLayers; i++) {
+        for (int j = 0; j < numberOfScintilatorsInLayer[i]; j++) {
+          TBox* box = allScintilatorsCanv[i][j].image;
+          if (box->GetFillColor() != kRed && box->GetFillColor() != kGreen && box->GetFillColor() != kCoincidence)
+            box->SetFillColor(baseColor2d(i, j));
+        }
+      }
+      fCanvas2d->Modified();
+      fCanvas2d->Update();
+    }
+    if (!fGeoManager)
+      return;
+    fDeadMarkers = std::unique_ptr<TPolyMarker3D>(new TPolyMarker3D(0, 24));
+    fHotMarkers = std::unique_ptr<TPolyMarker3D>(new TPolyMarker3D(0, 29));
+    fDeadMarkers->SetMarkerColor(kDead);
+    fHotMarkers->SetMarkerColor(kHot);
+    fDeadMarkers->SetMarkerSize(2);
+    fHotMarkers->SetMarkerSize(2);
+    for (const auto& flag : fFlaggedStrips) {
+      double center[3];
+      if (!getStripCenter(flag.first.first, flag.first.second, center))
+        continue;
+      TPolyMarker3D* markers = flag.second == ChannelFlag::kHot ? fHotMarkers.get() : fDeadMarkers.get();
+      markers->SetNextPoint(center[0], center[1], center[2]);
+    }
+    if (fCanvas3d)
+      drawPads();
+  }
+
+  void GeometryVisualizator::drawFlags3d()
+  {
+    TPolyMarker3D* markers[] = {fDeadMarkers.get(), fHotMarkers.get()};
+    for (TPolyMarker3D* marker : markers) {
+      if (!marker)
+        continue;
+      fCanvas3d->GetListOfPrimitives()->Remove(marker);
+      if (marker->GetN() > 0)
+        marker->Draw();
+    }
+  }
+
+  bool GeometryVisualizator::isStripSelected2d(int layerIndex, int stripIndex) const
+  {
+    return layerIndex + 1 == fSelectedLayer2d && stripIndex + 1 == fSelectedStrip2d;
+  }
+
+  bool GeometryVisualizator::findStrip2d(Int_t px, Int_t py, int& layer, int& strip) const
+  {
+    if (fCanvas2d == 0 || allScintilatorsCanv == 0 || fStripRings.empty())
+      return false;
+    const double x = (fCanvas2d->AbsPixeltoX(px) - f2dCentre) / f2dScale;
+    const double y = (fCanvas2d->AbsPixeltoY(py) - f2dCentre) / f2dScale;
+    const double radius = std::hypot(x, y);
+    auto ring = std::lower_bound(fStripRings.begin(), fStripRings.end(), radius,
+                                 [](const StripRing& candidate, double value) { return candidate.radius < value; });
+    // the nearest ring is this one or the one below
+    if (ring == fStripRings.end() || (ring != fStripRings.begin() && radius - (ring - 1)->radius < ring->radius - radius))
+      --ring;
+    if (std::fabs(radius - ring->radius) > ring->halfWidth)
+      return false;
+    int bin = static_cast<int>((std::atan2(y, x) + M_PI) / (2 * M_PI) * kAngularBins);
+    int pick = ring->lut[std::min(bin, kAngularBins - 1)];
+    if (pick < 0)
+      return false;
+    layer = fPickStrips[pick].first + 1;
+    strip = fPickStrips[pick].second + 1;
+    return true;
+  }
+
+  void GeometryVisualizator::selectStrip2d(int layer, int strip)
+  {
+    if (allScintilatorsCanv == 0 || fCanvas2d == 0)
+      return;
+    // only the previous and the new box change colour, fired state is kept
+    int layerIndex = fSelectedLayer2d - 1;
+    int stripIndex = fSelectedStrip2d - 1;
+    fSelectedLayer2d = layer;
+    fSelectedStrip2d = strip;
+    if (layerIndex >= 0 && layerIndex < numberOfLayers &&
+        stripIndex >= 0 && stripIndex < numberOfScintilatorsInLayer[layerIndex]) {
+      TBox* box = allScintilatorsCanv[layerIndex][stripIndex].image;
+      box->SetFillColor(box->GetFillColor() == kGreen ? kRed : baseColor2d(layerIndex, stripIndex));
+    }
+    layerIndex = layer - 1;
+    stripIndex = strip - 1;
+    if (layerIndex >= 0 && layerIndex < numberOfLayers &&
+        stripIndex >= 0 && stripIndex < numberOfScintilatorsInLayer[layerIndex]) {
+      TBox* box = allScintilatorsCanv[layerIndex][stripIndex].image;
+      box->SetFillColor(box->GetFillColor() == kRed ? kGreen : kBlue);
+    }
+    fCanvas2d->Modified();
+    fCanvas2d->Update();
+  }
 
   void GeometryVisualizator::drawPads()
   {
@@ -169,46 +665,40 @@ GeometryVisualizator::GeometryVisualizator() { }
     TView* view = gPad->GetView();
     assert(view);
     view->ZoomView(0, 1);
-    view->SetView(0, 0 , 0, irep);
+    view->SetView(fCamera[0], fCamera[1], fCamera[2], irep);
+    drawFlags3d();
     
     gPad->Modified();
     gPad->Update();
   }
 
+  void GeometryVisualizator::setCamera(const double camera[3])
+  {
+    std::copy(camera, camera + 3, fCamera);
+  }
+
+  void GeometryVisualizator::getCamera(double camera[3]) const
+  {
+    std::copy(fCamera, fCamera + 3, camera);
+    TView* view = fCanvas3d ? fCanvas3d->GetView() : 0;
+    if (view) {
+      camera[0] = view->GetLongitude();
+      camera[1] = view->GetLatitude();
+      camera[2] = view->GetPsi();
+    }
+  }
+
   void GeometryVisualizator::setVisibility(const std::map<int, std::vector<int> >& selection)
   {
     setAllStripsUnvisible();
-    setAllStripsUnvisible2d();
-    setVisibility2d(selection);
     if (selection.empty()) return;
     assert(fGeoManager);
-    TGeoNode *topNode = fGeoManager->GetTopNode();
-    assert(topNode);
-    TGeoNode* nodeLayer = 0; //making those shared ptr causing segfault
-    TGeoNode* nodeStrip = 0;
-    
-    std::map<int, std::vector<int> >::const_iterator iter;
-    int layer = -1;
-    int strip = -1;
-    std::string nodeName;
-    for (iter = selection.begin(); iter != selection.end(); ++iter) {
-      layer = iter->first;
-      const std::vector<int>& strips = iter->second;
-      std::vector<int>::const_iterator stripIter;
-      nodeName = getLayerNodeName(layer); 
-      nodeLayer = topNode->GetVolume()->FindNode(nodeName.c_str());
-      //if(!nodeLayer) //TODO remove, just for tests
-      //  return;
-      
-      assert(nodeLayer);
-      for (stripIter = strips.begin(); stripIter != strips.end(); ++stripIter) {
-        strip = *stripIter;
-        nodeName = getStripNodeName(strip);
-        nodeStrip = nodeLayer->GetVolume()->FindNode(nodeName.c_str());
-        //if(!nodeStrip) //TODO remove, just for tests
-        //  return;
+    for (auto iter = selection.begin(); iter != selection.end(); ++iter) {
+      for (int strip : iter->second) {
+        TGeoNode* nodeStrip = getStripNode(iter->first, strip);
         assert(nodeStrip);
-        nodeStrip->SetVisibility(kTRUE);
+        if (nodeStrip)
+          nodeStrip->SetVisibility(kTRUE);
       }
     }
   }
@@ -216,43 +706,17 @@ GeometryVisualizator::GeometryVisualizator() { }
   void GeometryVisualizator::setAllStripsUnvisible()
   {
     assert(fGeoManager);
-    TGeoNode* topNode = fGeoManager->GetTopNode(); //making this shared ptr causing segfault
-    assert(topNode);
-    TGeoNode* node = 0;
-    node = topNode->GetVolume()->FindNode("layer_1_1");
-    assert(node);
-    node->SetVisibility(kTRUE);
-    node->GetVolume()->SetLineColor(kBlack);
-    TObjArray* array = node->GetNodes();
-    assert(array);
-    TIter it(array);
-    while ((node = (TGeoNode*)it.Next())) {
-      node->SetVisibility(kFALSE);
-      node->GetVolume()->SetLineWidth(5);
-    }
-
-    node = topNode->GetVolume()->FindNode("layer_2_1");
-    assert(node);
-    node->SetVisibility(kTRUE);
-    node->GetVolume()->SetLineColor(kBlack);
-    array = node->GetNodes();
-    assert(array);
-    it  = array->MakeIterator();
-    while ((node = (TGeoNode*)it.Next())) {
-      node->SetVisibility(kFALSE);
-      node->GetVolume()->SetLineWidth(5);
-    }
-
-    node = topNode->GetVolume()->FindNode("layer_3_1");
-    assert(node);
-    node->SetVisibility(kTRUE);
-    node->GetVolume()->SetLineColor(kBlack);
-    array = node->GetNodes();
-    assert(array);
-    it  = array->MakeIterator();
-    while ((node = (TGeoNode*)it.Next())) {
-      node->SetVisibility(kFALSE);
-      node->GetVolume()->SetLineWidth(5);
+    for (size_t i = 0; i < fLayerNodes.size(); i++) {
+      if (!fLayerNodes[i])
+        continue;
+      fLayerNodes[i]->SetVisibility(kTRUE);
+      fLayerNodes[i]->GetVolume()->SetLineColor(kBlack);
+      for (TGeoNode* node : fStripNodes[i]) {
+        if (!node)
+          continue;
+        node->SetVisibility(kFALSE);
+        node->GetVolume()->SetLineWidth(5);
+      }
     }
   }
 
@@ -266,46 +730,129 @@ GeometryVisualizator::GeometryVisualizator() { }
     }
   }
 
-  std::string GeometryVisualizator::getLayerNodeName(int layer) const
+  void GeometryVisualizator::countOwnedObjects(OwnedObjects& counts) const
   {
-    std::string name("layer_");
-    name.append(CommonTools::intToString(layer) + std::string("_1"));
-    return name;
+    counts.diagramGraphs = fDiagramGraphs.size();
+    counts.hitMarkers = fHitMarkers.size();
+    counts.hitPoints = 0;
+    for (const auto& coordinates : fHitCoordinates)
+      counts.hitPoints += coordinates.size() / 3;
+    counts.coincidenceLines = fCoincidenceLines.size();
   }
 
-  std::string GeometryVisualizator::getStripNodeName(int strip) const
+  void GeometryVisualizator::drawDiagram(const DiagramSignals& diagramData)
   {
-    std::string name("XStrip_");
-    name.append(CommonTools::intToString(strip));
-    return name;
-  }
-
-  void GeometryVisualizator::drawDiagram(const std::map<int, std::pair<float, float>>& diagramData)
-  {
-    if (fRootCanvasDiagrams == 0) {
-      WARNING("Canvas not set");
+    if (!acquireCanvas(fCanvasDiagrams, fRootCanvasDiagrams))
       return;
+    static const Color_t kPMColors[] = { ::kBlue + 1, ::kRed + 1, ::kGreen + 2, ::kMagenta + 1,
+                                         ::kOrange + 7, ::kCyan + 2, ::kViolet + 1, ::kBlack };
+    static const int kNumberOfPMColors = sizeof(kPMColors) / sizeof(kPMColors[0]);
+
+    fCanvasDiagrams->cd();
+    if (!fDiagramMultiGraph) {
+      fDiagramMultiGraph = std::unique_ptr<TMultiGraph>(new TMultiGraph("diagram", ";Time [ps];Threshold [mV]"));
+      fDiagramLegend = std::unique_ptr<TLegend>(new TLegend(0.75, 0.75, 0.98, 0.98));
     }
-    if(fCanvasDiagrams == 0)
-      fCanvasDiagrams = std::unique_ptr<TCanvas>(fRootCanvasDiagrams->GetCanvas());
-    int n = diagramData.size();
-    if(n == 0)
-      return;
-    double x[n], y[n];
-    int i = 0;
-    for (auto it = diagramData.begin(); it != diagramData.end(); it++) {
-      y[i] = static_cast<double>(it->first);
-      // y[i] = static_cast<double>(it->second.first);
-      x[i] = static_cast<double>(it->second.second);
-      //std::cout << "x: " << x[i] << " y: " << y[i] << "\n";
-      i++;
+    if (fDiagramMultiGraph->GetListOfGraphs())
+      fDiagramMultiGraph->GetListOfGraphs()->Clear("nodelete");
+    fDiagramLegend->Clear();
+
+    // more than two points (min and max) per pixel column can not be seen anyway
+    const size_t maxPoints = std::max<size_t>(2 * fCanvasDiagrams->GetWw(), 100);
+    std::map<int, int> pmColorIndex;
+    double xMin = 0, xMax = 0, yMin = 0, yMax = 0;
+    size_t usedGraphs = 0;
+    for (const auto& signal : diagramData) {
+      if (std::min(signal.times.size(), signal.thresholds.size()) == 0)
+        continue;
+      if (usedGraphs == fDiagramGraphs.size())
+        fDiagramGraphs.push_back(std::unique_ptr<TGraph>(new TGraph()));
+      TGraph* graph = fDiagramGraphs[usedGraphs].get();
+      fillDiagramGraph(graph, signal, maxPoints);
+
+      auto color = pmColorIndex.insert(std::make_pair(signal.pmID, pmColorIndex.size())).first;
+      graph->SetLineColor(kPMColors[color->second % kNumberOfPMColors]);
+      graph->SetMarkerColor(kPMColors[color->second % kNumberOfPMColors]);
+      graph->SetMarkerStyle(signal.leading ? 20 : 24);
+      graph->SetLineStyle(signal.leading ? 1 : 2);
+      fDiagramMultiGraph->Add(graph, "LP");
+      fDiagramLegend->AddEntry(graph, Form("PM %d %s", signal.pmID, signal.leading ? "leading" : "trailing"), "lp");
+
+      for (int i = 0; i < graph->GetN(); i++) {
+        double x = graph->GetX()[i];
+        double y = graph->GetY()[i];
+        if (usedGraphs == 0 && i == 0) {
+          xMin = xMax = x;
+          yMin = yMax = y;
+        }
+        xMin = std::min(xMin, x);
+        xMax = std::max(xMax, x);
+        yMin = std::min(yMin, y);
+        yMax = std::max(yMax, y);
+      }
+      usedGraphs++;
+    }
+
+    if (usedGraphs == 0) {
+      fCanvasDiagrams->Clear();
+    } else {
+      if (!fCanvasDiagrams->GetListOfPrimitives()->FindObject(fDiagramMultiGraph.get())) {
+        fDiagramMultiGraph->Draw("A");
+        fDiagramLegend->Draw();
+      }
+      const double xMargin = xMax > xMin ? 0.05 * (xMax - xMin) : 1.;
+      const double yMargin = yMax > yMin ? 0.05 * (yMax - yMin) : 1.;
+      fDiagramMultiGraph->GetXaxis()->SetLimits(xMin - xMargin, xMax + xMargin);
+      fDiagramMultiGraph->SetMinimum(yMin - yMargin);
+      fDiagramMultiGraph->SetMaximum(yMax + yMargin);
     }
-    fCanvasDiagrams->cd();
-    TGraph *gr = new TGraph(n, x, y);
-    gr->GetXaxis()->SetTitle("Time");
-    gr->GetYaxis()->SetTitle("Threshold Number");
-    gr->Draw("ACP*");
-    fCanvasDiagrams->Update();
     fCanvasDiagrams->Modified();
+    fCanvasDiagrams->Update();
+  }
+
+  void GeometryVisualizator::fillDiagramGraph(TGraph* graph, const DiagramSignal& signal, size_t maxPoints)
+  {
+    const size_t n = std::min(signal.times.size(), signal.thresholds.size());
+    fDiagramPoints.clear();
+    for (size_t i = 0; i < n; i++)
+      fDiagramPoints.push_back(std::make_pair(signal.times[i], signal.thresholds[i]));
+    std::sort(fDiagramPoints.begin(), fDiagramPoints.end());
+
+    if (n > maxPoints) {
+      // min/max decimation: split the time range into maxPoints / 2 buckets
+      // and keep only the lowest and the highest point of each of them
+      const size_t buckets = maxPoints / 2;
+      const double start = fDiagramPoints.front().first;
+      const double range = fDiagramPoints.back().first - start;
+      size_t out = 0;
+      size_t bucketBegin = 0;
+      while (bucketBegin < n) {
+        size_t bucket = range > 0 ? std::min(buckets - 1, size_t((fDiagramPoints[bucketBegin].first - start) / range * buckets)) : 0;
+        size_t minIndex = bucketBegin, maxIndex = bucketBegin;
+        size_t i = bucketBegin + 1;
+        for (; i < n; i++) {
+          size_t current = range > 0 ? std::min(buckets - 1, size_t((fDiagramPoints[i].first - start) / range * buckets)) : 0;
+          if (current != bucket)
+            break;
+          if (fDiagramPoints[i].second < fDiagramPoints[minIndex].second)
+            minIndex = i;
+          if (fDiagramPoints[i].second > fDiagramPoints[maxIndex].second)
+            maxIndex = i;
+        }
+        // out never passes bucketBegin, so writing in place is safe
+        std::pair<double, double> first = fDiagramPoints[std::min(minIndex, maxIndex)];
+        std::pair<double, double> second = fDiagramPoints[std::max(minIndex, maxIndex)];
+        fDiagramPoints[out++] = first;
+        if (minIndex != maxIndex)
+          fDiagramPoints[out++] = second;
+        bucketBegin = i;
+      }
+      fDiagramPoints.resize(out);
+    }
+
+    if (graph->GetN() != static_cast<int>(fDiagramPoints.size()))
+      graph->Set(fDiagramPoints.size());
+    for (size_t i = 0; i < fDiagramPoints.size(); i++)
+      graph->SetPoint(i, fDiagramPoints[i].first, fDiagramPoints[i].second);
   }
 }
@@ -24,47 +24,139 @@
 #include <TMarker.h>
 #include <TBox.h>
 #include <TGraph.h>
+#include <TMultiGraph.h>
+#include <TLegend.h>
+#include <TPolyLine3D.h>
 #include <TAxis.h>
 #include <cassert>
 #include <map>
 #include <vector>
 #include <memory>
 #include "./CommonTools.h"
+#include "./EventData.h"
+#ifndef __CINT__
+#include "./ChannelQA.h"
+#include <TPolyMarker3D.h>
+#endif
 
 
 #include <TRootEmbeddedCanvas.h>
 
 class TCanvas;
+class TFile;
 
 namespace jpet_event_display
 {
+  struct OwnedObjects;
+
   class GeometryVisualizator
   {
   public:
     GeometryVisualizator();
     ~GeometryVisualizator();
     bool isGeoManagerInitialized() const;
-    void loadGeometry(const std::string& geomFile);
+    bool loadGeometry(const std::string& geomFile);
+    /// same as above, from the bytes of geomFile read beforehand
+    bool loadGeometry(const std::string& geomFile, const std::string& contents);
     void drawOnlyGeometry();
     void draw2dGeometry();
     void drawStrips(const std::map<int, std::vector<int> >& selection);
+    void drawStrips3d(const std::map<int, std::vector<int> >& selection);
+    void drawStrips2d(const std::map<int, std::vector<int> >& selection);
     void drawPads();
+    /// 3d view longitude, latitude and psi [deg], kept for every later redraw
+    void setCamera(const double camera[3]);
+    /// angles of the 3d view as it is shown, including rotation by mouse
+    void getCamera(double camera[3]) const;
     void setAllStripsUnvisible();
     void setAllStripsUnvisible2d();
     void setVisibility(const std::map<int, std::vector<int> >& selection);
     void setVisibility2d(const std::map<int, std::vector<int> >& selection);
-    std::string getLayerNodeName(int layer) const;
-    std::string getStripNodeName(int strip) const;
-    void drawDiagram(const std::map<int, std::pair<float, float>> &diagramData);
+    /// recolours or hides only the given strips, for moving the time slice
+    void applyStripChanges2d(const std::vector<StripChange>& changes);
+    void applyStripChanges3d(const std::vector<StripChange>& changes);
+    /// marks strips of coincident pairs on top of the fired ones
+    void drawCoincidences2d(const Coincidences& coincidences);
+    /// a line between the centres of the strips of every coincident pair
+    void drawCoincidences3d(const Coincidences& coincidences);
+    /// hits placed along their strips from the A - B time difference, coloured by time
+    void drawHits3d(const std::vector<StripHit>& hits);
+    #ifndef __CINT__
+    /// dead and hot strips keep their own colour in 2d and a marker in 3d
+    void setFlaggedStrips(const ChannelFlags& flags);
+    #endif
+    /// both runs in lockstep: red fired only in first, blue only in second, white in both
+    void drawStripDifference2d(const ScintillatorsInLayers& first, const ScintillatorsInLayers& second);
+    /// log2 occupancy ratios on a diverging palette, saturated at +-maxAbs
+    void drawOccupancyRatio2d(const std::map<std::pair<int, int>, double>& logRatios, double maxAbs);
+    /// layer and strip (both from 1) under a pixel of the 2d view, false outside the strips
+    bool findStrip2d(Int_t px, Int_t py, int& layer, int& strip) const;
+    /// marks a strip in the 2d view until another one is selected, 0 clears
+    void selectStrip2d(int layer, int strip);
+    /// draws all signals overlaid, graphs are reused between events
+    void drawDiagram(const DiagramSignals& diagramData);
+    /// graphs, markers and lines kept between events, for the resource monitor
+    void countOwnedObjects(OwnedObjects& counts) const;
+    /// creates standalone canvases instead of the embedded ones, for drawing without GUI
+    void createBatchCanvases(int width, int height);
+    void saveViews(const std::string& prefix, const std::string& format,
+                   bool save3d = true, bool save2d = true, bool saveDiagram = true);
 
     inline std::unique_ptr<TRootEmbeddedCanvas>& getCanvas3d() { return fRootCanvas3d; }
     inline std::unique_ptr<TRootEmbeddedCanvas>& getCanvas2d() { return fRootCanvas2d; }
     inline std::unique_ptr<TRootEmbeddedCanvas>& getCanvasDiagrams() { return fRootCanvasDiagrams; }
 
   private:
-    enum ColorTable { kBlack = 1, kRed = 2, kBlue = 34, kGreen = 30 };
+    enum ColorTable { kBlack = 1, kRed = 2, kHot = 5, kCoincidence = 6, kDead = 15, kBlue = 34, kGreen = 30 };
     #ifndef __CINT__
+    bool acquireCanvas(std::unique_ptr<TCanvas>& canvas,
+                       const std::unique_ptr<TRootEmbeddedCanvas>& rootCanvas);
+
     std::unique_ptr<TGeoManager> fGeoManager;
+    bool readGeoManager(TFile& inputGeomFile, const std::string& geomFile);
+    bool isStripSelected2d(int layerIndex, int stripIndex) const;
+    /// colour of a strip which did not fire
+    Color_t baseColor2d(int layerIndex, int stripIndex) const;
+    void drawFlags3d();
+    /// blue for -maxAbs, white for 0, red for +maxAbs
+    Color_t divergingColor(double value, double maxAbs);
+    std::vector<Color_t> fDivergingPalette;
+    /// (layer, strip) from 1 -> flag kind
+    std::map<std::pair<int, int>, ChannelFlag::Kind> fFlaggedStrips;
+    std::unique_ptr<TPolyMarker3D> fDeadMarkers;
+    std::unique_ptr<TPolyMarker3D> fHotMarkers;
+    void buildNodeTable();
+    /// 0 if the geometry has no such strip
+    TGeoNode* getStripNode(int layer, int strip) const;
+    /// [layer - 1] and [layer - 1][strip - 1], gaps in the numbering are 0
+    std::vector<TGeoNode*> fLayerNodes;
+    std::vector<std::vector<TGeoNode*> > fStripNodes;
+    bool getStripCenter(int layer, int strip, double center[3]) const;
+    /// position is along the strip axis from its centre [cm], clamped to the strip length
+    bool getStripPoint(int layer, int strip, double position, double point[3]) const;
+    /// effective speed of light in the scintillator [cm/ps]
+    static constexpr double kStripLightVelocity = 0.0126;
+    /// one marker object per time bin, ROOT draws a TPolyMarker3D in one colour
+    static const int kHitTimeBins = 8;
+    std::vector<std::unique_ptr<TPolyMarker3D> > fHitMarkers;
+    std::vector<std::vector<double> > fHitCoordinates;
+    std::vector<std::unique_ptr<TPolyLine3D> > fCoincidenceLines;
+    /// strips at about one radius in the 2d view, lut maps an angle bin to fPickStrips
+    struct StripRing
+    {
+      double radius;
+      double halfWidth;
+      std::vector<int> lut;
+    };
+    static const int kAngularBins = 3600;
+    static constexpr double kRingTolerance = 2.; // cm
+    std::vector<StripRing> fStripRings;
+    std::vector<std::pair<int, int> > fPickStrips; // (layer, strip) indices from 0
+    double f2dCentre = 0.;
+    double f2dScale = 1.;
+    double fCamera[3] = {0., 0., 0.};
+    int fSelectedLayer2d = 0;
+    int fSelectedStrip2d = 0;
     int numberOfLayers = 0;
     int* numberOfScintilatorsInLayer; 
     std::unique_ptr<TRootEmbeddedCanvas> fRootCanvas3d;
@@ -73,6 +165,12 @@ namespace jpet_event_display
     std::unique_ptr<TCanvas> fCanvas3d;
     std::unique_ptr<TCanvas> fCanvas2d;
     std::unique_ptr<TCanvas> fCanvasDiagrams;
+
+    void fillDiagramGraph(TGraph* graph, const DiagramSignal& signal, size_t maxPoints);
+    std::unique_ptr<TMultiGraph> fDiagramMultiGraph;
+    std::unique_ptr<TLegend> fDiagramLegend;
+    std::vector<std::unique_ptr<TGraph> > fDiagramGraphs;
+    std::vector<std::pair<double, double> > fDiagramPoints;
     #endif
     struct ScintillatorCanv {
       TBox* image;
@@ -0,0 +1,59 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file MappedFile.cpp
+ */
+
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace jpet_event_display
+{
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+  close();
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void* data = mmap(0, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping stays valid
+  if (data == MAP_FAILED)
+    return false;
+  fData = static_cast<const char*>(data);
+  fSize = status.st_size;
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (fData)
+    munmap(const_cast<char*>(fData), fSize);
+  fData = 0;
+  fSize = 0;
+}
+
+}
@@ -0,0 +1,48 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file MappedFile.h
+ *  @brief Read only memory mapping of a whole file.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace jpet_event_display
+{
+
+class MappedFile
+{
+public:
+  MappedFile() {}
+  ~MappedFile();
+
+  bool open(const std::string& filename);
+  void close();
+  inline bool isOpen() const { return fData != 0; }
+  inline const char* data() const { return fData; }
+  inline size_t size() const { return fSize; }
+
+private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* fData = 0;
+  size_t fSize = 0;
+};
+
+}
+
+#endif /*  !MAPPEDFILE_H */
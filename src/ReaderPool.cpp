@@ -0,0 +1,134 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file ReaderPool.cpp
+ */
+
+#include "ReaderPool.h"
+#include "DataProcessor.h"
+#include <JPetLoggerInclude.h>
+#include <algorithm>
+
+namespace jpet_event_display
+{
+
+ReaderPool::ReaderPool(const std::string& dataFile, const CoincidenceOptions& options, size_t maxReaders) :
+  fDataFile(dataFile), fMaxReaders(std::max<size_t>(1, maxReaders)), fOptions(options)
+{
+}
+
+void ReaderPool::ProcessorDeleter::operator()(DataProcessor* processor) const
+{
+  delete processor;
+}
+
+ReaderPool::Checkout::~Checkout()
+{
+  if (fReader) {
+    // the processor may be left in the middle of a read, a new one is opened instead
+    fReader.reset();
+    fPool.discard();
+  }
+}
+
+void ReaderPool::Checkout::checkin()
+{
+  fPool.checkin(std::move(fReader));
+}
+
+std::shared_ptr<const DecodedEvent> ReaderPool::decode(long long entry)
+{
+  Checkout reader(*this, checkout(entry));
+  if (!reader.get()) {
+    std::shared_ptr<DecodedEvent> failed = std::make_shared<DecodedEvent>();
+    failed->entry = entry;
+    return failed;
+  }
+  std::shared_ptr<const DecodedEvent> event = std::make_shared<const DecodedEvent>(reader->processor->decodeEvent(entry));
+  reader->lastEntry = entry;
+  reader.checkin();
+  return event;
+}
+
+void ReaderPool::setCoincidenceOptions(const CoincidenceOptions& options)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  fOptions = options;
+  fOptionsVersion++;
+}
+
+size_t ReaderPool::getNumberOfReaders()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fReaders;
+}
+
+std::unique_ptr<ReaderPool::Reader> ReaderPool::checkout(long long entry)
+{
+  std::unique_lock<std::mutex> lock(fMutex);
+  while (fIdle.empty() && fReaders >= fMaxReaders)
+    fReturned.wait(lock);
+
+  if (!fIdle.empty()) {
+    // the one just before the entry continues its read cache, otherwise the closest one before it
+    auto best = fIdle.begin();
+    for (auto it = fIdle.begin(); it != fIdle.end(); ++it) {
+      const long long distance = entry - (*it)->lastEntry;
+      const long long bestDistance = entry - (*best)->lastEntry;
+      if (distance > 0 && (bestDistance <= 0 || distance < bestDistance))
+        best = it;
+    }
+    std::unique_ptr<Reader> reader = std::move(*best);
+    fIdle.erase(best);
+    if (reader->optionsVersion != fOptionsVersion) {
+      reader->processor->setCoincidenceOptions(fOptions);
+      reader->optionsVersion = fOptionsVersion;
+    }
+    return reader;
+  }
+
+  // opening reads the param bank and the tree header, done without the lock
+  fReaders++;
+  const CoincidenceOptions options = fOptions;
+  const unsigned optionsVersion = fOptionsVersion;
+  lock.unlock();
+  try {
+    std::unique_ptr<Reader> reader(new Reader());
+    reader->processor.reset(new DataProcessor());
+    reader->processor->setCoincidenceOptions(options);
+    reader->optionsVersion = optionsVersion;
+    if (reader->processor->openFile(fDataFile.c_str()))
+      return reader;
+  } catch (...) {
+    discard();
+    throw;
+  }
+  ERROR(std::string("Error opening file:" + fDataFile));
+  discard();
+  return std::unique_ptr<Reader>();
+}
+
+void ReaderPool::checkin(std::unique_ptr<Reader> reader)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  fIdle.push_back(std::move(reader));
+  fReturned.notify_one();
+}
+
+void ReaderPool::discard()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  fReaders--;
+  fReturned.notify_one();
+}
+
+}
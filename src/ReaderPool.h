@@ -0,0 +1,105 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file ReaderPool.h
+ *  @brief Independently positioned readers of one file, checked out per decode.
+ */
+
+#ifndef READERPOOL_H
+#define READERPOOL_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CoincidenceFinder.h"
+#include "EventData.h"
+
+namespace jpet_event_display
+{
+
+class DataProcessor;
+
+/**
+ * Every reader is a DataProcessor of its own with its own cursor and read
+ * cache, opened when all existing ones are busy, up to maxReaders; further
+ * callers wait for one to be returned. An idle reader which last read the
+ * entry before the requested one is preferred, so interleaved sequential
+ * consumers each keep their own forward reading cache.
+ */
+class ReaderPool
+{
+public:
+  ReaderPool(const std::string& dataFile, const CoincidenceOptions& options, size_t maxReaders);
+
+  /// safe to call from any number of threads, an invalid event when the file cannot be read
+  std::shared_ptr<const DecodedEvent> decode(long long entry);
+  /// applied to every reader before its next decode
+  void setCoincidenceOptions(const CoincidenceOptions& options);
+  size_t getNumberOfReaders();
+
+private:
+  ReaderPool(const ReaderPool&) = delete;
+  ReaderPool& operator=(const ReaderPool&) = delete;
+
+  /// DataProcessor stays incomplete here, it is deleted in ReaderPool.cpp
+  struct ProcessorDeleter
+  {
+    void operator()(DataProcessor* processor) const;
+  };
+
+  struct Reader
+  {
+    std::unique_ptr<DataProcessor, ProcessorDeleter> processor;
+    long long lastEntry = -1;
+    unsigned optionsVersion = 0;
+  };
+
+  /// a checked out reader, discarded unless checked in, so a throwing decode does not shrink the pool
+  class Checkout
+  {
+  public:
+    Checkout(ReaderPool& pool, std::unique_ptr<Reader> reader) : fPool(pool), fReader(std::move(reader)) {}
+    ~Checkout();
+    Reader* get() const { return fReader.get(); }
+    Reader* operator->() const { return fReader.get(); }
+    void checkin();
+
+  private:
+    Checkout(const Checkout&) = delete;
+    Checkout& operator=(const Checkout&) = delete;
+
+    ReaderPool& fPool;
+    std::unique_ptr<Reader> fReader;
+  };
+
+  std::unique_ptr<Reader> checkout(long long entry);
+  void checkin(std::unique_ptr<Reader> reader);
+  /// gives up a reader slot of a reader which is not returned
+  void discard();
+
+  const std::string fDataFile;
+  const size_t fMaxReaders;
+
+  std::mutex fMutex;
+  std::condition_variable fReturned;
+  std::vector<std::unique_ptr<Reader> > fIdle;
+  size_t fReaders = 0;
+  CoincidenceOptions fOptions;
+  unsigned fOptionsVersion = 0;
+};
+
+}
+
+#endif /*  !READERPOOL_H */
@@ -0,0 +1,108 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file ResourceMonitor.cpp
+ */
+
+#include "ResourceMonitor.h"
+#include <TBox.h>
+#include <TCanvas.h>
+#include <TGeoManager.h>
+#include <TGraph.h>
+#include <TList.h>
+#include <TMultiGraph.h>
+#include <TPad.h>
+#include <TPolyLine3D.h>
+#include <TPolyMarker3D.h>
+#include <TROOT.h>
+#include <TSystem.h>
+
+#include <iomanip>
+#include <sstream>
+
+namespace jpet_event_display
+{
+
+ResourceSample ResourceMonitor::sample()
+{
+  ResourceSample sample;
+  ProcInfo_t info;
+  if (gSystem->GetProcInfo(&info) == 0) {
+    sample.rssKB = info.fMemResident;
+    sample.virtualKB = info.fMemVirtual;
+  }
+  TIter canvases(gROOT->GetListOfCanvases());
+  while (TObject* object = canvases()) {
+    if (TPad* pad = dynamic_cast<TPad*>(object))
+      countPrimitives(pad->GetListOfPrimitives(), sample);
+  }
+  if (gGeoManager)
+    sample.geoNodes = gGeoManager->GetNNodes();
+  if (!fHasBaseline) {
+    fBaseline = sample;
+    fHasBaseline = true;
+  }
+  return sample;
+}
+
+void ResourceMonitor::countPrimitives(TList* primitives, ResourceSample& sample)
+{
+  if (!primitives)
+    return;
+  TIter next(primitives);
+  while (TObject* object = next()) {
+    sample.primitives++;
+    if (TPad* pad = dynamic_cast<TPad*>(object))
+      countPrimitives(pad->GetListOfPrimitives(), sample);
+    else if (TMultiGraph* multiGraph = dynamic_cast<TMultiGraph*>(object))
+      sample.onCanvases.graphs += multiGraph->GetListOfGraphs() ? multiGraph->GetListOfGraphs()->GetSize() : 0;
+    else if (object->InheritsFrom(TGraph::Class()))
+      sample.onCanvases.graphs++;
+    else if (object->InheritsFrom(TBox::Class()))
+      sample.onCanvases.boxes++;
+    else if (object->InheritsFrom(TPolyLine3D::Class()))
+      sample.onCanvases.polyLines3d++;
+    else if (object->InheritsFrom(TPolyMarker3D::Class()))
+      sample.onCanvases.polyMarkers3d++;
+  }
+}
+
+std::string ResourceMonitor::describe(const ResourceSample& sample) const
+{
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1)
+      << "RSS " << sample.rssKB / 1024. << " MB";
+  if (fHasBaseline)
+    oss << " (" << std::showpos << (sample.rssKB - fBaseline.rssKB) / 1024. << std::noshowpos << ")";
+  oss << ", on canvases " << sample.primitives;
+  if (fHasBaseline)
+    oss << " (" << std::showpos << sample.primitives - fBaseline.primitives << std::noshowpos << ")";
+  oss << " [" << describeCounts(sample.onCanvases) << "]"
+      << ", kept: diagram graphs " << sample.owned.diagramGraphs
+      << ", hit markers " << sample.owned.hitMarkers << " (" << sample.owned.hitPoints << " points)"
+      << ", coincidence lines " << sample.owned.coincidenceLines
+      << ", geo nodes " << sample.geoNodes
+      << ", read cache " << sample.readCacheBytes / (1024. * 1024.) << " MB"
+      << ", index " << sample.indexBytes / (1024. * 1024.) << " MB"
+      << ", read " << sample.bytesRead / (1024. * 1024.) << " MB";
+  return oss.str();
+}
+
+std::string ResourceMonitor::describeCounts(const ObjectCounts& counts)
+{
+  std::ostringstream oss;
+  oss << "boxes " << counts.boxes << ", graphs " << counts.graphs
+      << ", 3d lines " << counts.polyLines3d << ", 3d markers " << counts.polyMarkers3d;
+  return oss.str();
+}
+
+}
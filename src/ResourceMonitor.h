@@ -0,0 +1,89 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file ResourceMonitor.h
+ *  @brief Process memory and live graphics primitives, sampled for long shifts.
+ */
+
+#ifndef RESOURCEMONITOR_H
+#define RESOURCEMONITOR_H
+
+#include <string>
+
+class TList;
+
+namespace jpet_event_display
+{
+
+/// subclasses are counted with their base class
+struct ObjectCounts
+{
+  long boxes = 0;
+  long graphs = 0;
+  long polyLines3d = 0;
+  long polyMarkers3d = 0;
+};
+
+/// objects the views keep between events, drawn or not
+struct OwnedObjects
+{
+  long diagramGraphs = 0;
+  long hitMarkers = 0;
+  long hitPoints = 0;
+  long coincidenceLines = 0;
+};
+
+struct ResourceSample
+{
+  long rssKB = 0;
+  long virtualKB = 0;
+  /// primitives on all open canvases, pads are searched recursively
+  long primitives = 0;
+  ObjectCounts onCanvases;
+  long geoNodes = 0;
+  /// filled by the caller, the monitor does not know about readers or views
+  OwnedObjects owned;
+  long long readCacheBytes = 0;
+  long long indexBytes = 0;
+  long long bytesRead = 0;
+};
+
+/**
+ * The first sample is kept as the baseline, so a leak shows up as a steadily
+ * growing difference in the status line instead of an absolute number.
+ * Only objects reachable from the GUI thread are counted: canvas primitives
+ * here, the objects kept by the views by the caller. The global ROOT object
+ * table is left off, the loader and the scans create objects concurrently.
+ */
+class ResourceMonitor
+{
+public:
+  ResourceMonitor() {}
+
+  /// process and canvas part of the sample, must run on the GUI thread
+  ResourceSample sample();
+  /// one line for the status bar and the log
+  std::string describe(const ResourceSample& sample) const;
+  inline bool hasBaseline() const { return fHasBaseline; }
+  inline const ResourceSample& getBaseline() const { return fBaseline; }
+
+private:
+  static void countPrimitives(TList* primitives, ResourceSample& sample);
+  static std::string describeCounts(const ObjectCounts& counts);
+
+  ResourceSample fBaseline;
+  bool fHasBaseline = false;
+};
+
+}
+
+#endif /*  !RESOURCEMONITOR_H */
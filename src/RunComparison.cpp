@@ -0,0 +1,87 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file RunComparison.cpp
+ */
+
+#include "RunComparison.h"
+#include "ChannelQA.h"
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <sstream>
+
+namespace jpet_event_display
+{
+
+bool RunComparison::run(const std::string& firstFile, const std::string& secondFile,
+                        const std::atomic<bool>& cancel)
+{
+  fStrips.clear();
+  std::unique_ptr<ChannelQA> first(new ChannelQA());
+  std::unique_ptr<ChannelQA> second(new ChannelQA());
+  ChannelQA* firstScan = first.get();
+  ChannelQA* secondScan = second.get();
+  std::future<bool> firstDone = std::async(std::launch::async, [firstScan, &firstFile, &cancel] {
+    return firstScan->run(firstFile, cancel);
+  });
+  bool secondOk = secondScan->run(secondFile, cancel);
+  bool firstOk = firstDone.get();
+  if (!firstOk || !secondOk)
+    return false;
+  fFirstEntries = first->getNumberOfEntries();
+  fSecondEntries = second->getNumberOfEntries();
+
+  std::map<std::pair<int, int>, double> firstRates = first->getStripRates();
+  std::map<std::pair<int, int>, double> secondRates = second->getStripRates();
+  for (const auto& rate : secondRates)
+    firstRates.insert(std::make_pair(rate.first, 0.));
+  // half a count keeps strips which never fired in one of the runs finite
+  const double firstFloor = fFirstEntries > 0 ? 0.5 / fFirstEntries : 1.;
+  const double secondFloor = fSecondEntries > 0 ? 0.5 / fSecondEntries : 1.;
+  for (const auto& rate : firstRates) {
+    auto other = secondRates.find(rate.first);
+    double secondRate = other == secondRates.end() ? 0. : other->second;
+    double logRatio = std::log2(std::max(rate.second, firstFloor) / std::max(secondRate, secondFloor));
+    if (rate.second == 0. && secondRate == 0.)
+      logRatio = 0.;
+    fStrips.push_back(StripComparison(rate.first.first, rate.first.second, rate.second, secondRate, logRatio));
+  }
+  return true;
+}
+
+std::map<std::pair<int, int>, double> RunComparison::getLogRatios() const
+{
+  std::map<std::pair<int, int>, double> ratios;
+  for (const auto& strip : fStrips)
+    ratios[std::make_pair(strip.layer, strip.strip)] = strip.logRatio;
+  return ratios;
+}
+
+std::string RunComparison::describe(size_t maxLines) const
+{
+  std::vector<StripComparison> strips = fStrips;
+  std::sort(strips.begin(), strips.end(), [](const StripComparison& a, const StripComparison& b) {
+    return std::fabs(a.logRatio) > std::fabs(b.logRatio);
+  });
+  std::ostringstream oss;
+  oss.precision(3);
+  oss << fFirstEntries << " vs " << fSecondEntries << " entries\n";
+  for (size_t i = 0; i < strips.size() && i < maxLines; i++) {
+    oss << "layer " << strips[i].layer << " strip " << strips[i].strip << ": "
+        << strips[i].firstRate << " / " << strips[i].secondRate << "\n";
+  }
+  return oss.str();
+}
+
+}
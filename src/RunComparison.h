@@ -0,0 +1,64 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file RunComparison.h
+ *  @brief Whole-run strip occupancy of two files, compared strip by strip.
+ */
+
+#ifndef RUNCOMPARISON_H
+#define RUNCOMPARISON_H
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jpet_event_display
+{
+
+struct StripComparison
+{
+  StripComparison(int layer_, int strip_, double firstRate_, double secondRate_, double logRatio_) :
+    layer(layer_), strip(strip_), firstRate(firstRate_), secondRate(secondRate_), logRatio(logRatio_) {}
+  int layer;
+  int strip;
+  double firstRate;
+  double secondRate;
+  double logRatio; // log2 of first / second rate, 0 for equal occupancy
+};
+
+class RunComparison
+{
+public:
+  RunComparison() {}
+
+  /// scans both files at the same time, each on its own thread with its own DataProcessor
+  bool run(const std::string& firstFile, const std::string& secondFile, const std::atomic<bool>& cancel);
+
+  inline const std::vector<StripComparison>& getStrips() const { return fStrips; }
+  /// (layer, strip) -> logRatio, as drawn in the 2d view
+  std::map<std::pair<int, int>, double> getLogRatios() const;
+  inline long long getFirstEntries() const { return fFirstEntries; }
+  inline long long getSecondEntries() const { return fSecondEntries; }
+  /// the strips which changed most, at most maxLines
+  std::string describe(size_t maxLines) const;
+
+private:
+  std::vector<StripComparison> fStrips;
+  long long fFirstEntries = 0;
+  long long fSecondEntries = 0;
+};
+
+}
+
+#endif /*  !RUNCOMPARISON_H */
@@ -0,0 +1,200 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file SessionFile.cpp
+ */
+
+#include "SessionFile.h"
+#include "ByteStream.h"
+#include "ChannelQA.h"
+#include "CommonTools.h"
+#include "StripIndex.h"
+
+#include <cstring>
+
+namespace jpet_event_display
+{
+
+namespace
+{
+const char kMagic[8] = {'J', 'P', 'E', 'T', 'S', 'E', 'S', '1'};
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 16;
+const size_t kSectionHeaderSize = 16;
+
+inline size_t padded(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+void appendSection(std::string& file, uint32_t tag, const std::string& payload)
+{
+  ByteWriter writer(file);
+  writer.put<uint32_t>(tag);
+  writer.put<uint32_t>(0);
+  writer.put<uint64_t>(payload.size());
+  file.append(payload);
+  file.append(padded(payload.size()) - payload.size(), '\0');
+}
+
+void writeHits(std::string& out, const ChannelHits& hits)
+{
+  ByteWriter writer(out);
+  writer.putVector(hits.layers);
+  writer.putVector(hits.strips);
+  writer.putVector(hits.pmIDs);
+  writer.putVector(hits.sides);
+  writer.putVector(hits.leading);
+  writer.putVector(hits.times);
+  writer.putVector(hits.thresholds);
+}
+
+bool readHits(const char* data, size_t size, ChannelHits& hits)
+{
+  ByteReader reader(data, size);
+  reader.getVector(hits.layers);
+  reader.getVector(hits.strips);
+  reader.getVector(hits.pmIDs);
+  reader.getVector(hits.sides);
+  reader.getVector(hits.leading);
+  reader.getVector(hits.times);
+  reader.getVector(hits.thresholds);
+  const size_t n = hits.layers.size();
+  if (!reader.ok() || hits.strips.size() != n || hits.pmIDs.size() != n || hits.sides.size() != n
+      || hits.leading.size() != n || hits.times.size() != n || hits.thresholds.size() != n) {
+    hits.clear();
+    return false;
+  }
+  return true;
+}
+}
+
+bool SessionFile::write(const std::string& filename, const SessionState& state,
+                        const StripIndex* index, const ChannelQA* qa)
+{
+  std::string stateSection;
+  ByteWriter writer(stateSection);
+  writer.putString(state.geometryFile);
+  writer.putString(state.dataFile);
+  writer.put<int64_t>(state.dataFileSize);
+  writer.put<int64_t>(state.dataFileTime);
+  writer.put<int64_t>(state.entry);
+  writer.put<int32_t>(state.step);
+  writer.put(state.camera);
+
+  std::string hitsSection;
+  writeHits(hitsSection, state.hits);
+
+  std::string file(kMagic, sizeof(kMagic));
+  ByteWriter header(file);
+  header.put<uint32_t>(kVersion);
+  header.put<uint32_t>(2 + (index ? 1 : 0) + (qa ? 1 : 0));
+  appendSection(file, kState, stateSection);
+  appendSection(file, kHits, hitsSection);
+  if (index) {
+    std::string payload;
+    index->serialize(payload);
+    appendSection(file, kStripIndex, payload);
+  }
+  if (qa) {
+    std::string payload;
+    qa->serialize(payload);
+    appendSection(file, kChannelQA, payload);
+  }
+
+  return CommonTools::writeFileAtomically(filename, file);
+}
+
+bool SessionFile::open(const std::string& filename)
+{
+  close();
+  if (!fFile.open(filename))
+    return false;
+  if (fFile.size() < kHeaderSize || std::memcmp(fFile.data(), kMagic, sizeof(kMagic)) != 0) {
+    close();
+    return false;
+  }
+  size_t size = 0;
+  const char* data = findSection(kState, size);
+  if (!data) {
+    close();
+    return false;
+  }
+  ByteReader reader(data, size);
+  int64_t dataFileSize = 0, dataFileTime = 0, entry = 0;
+  int32_t step = 0;
+  reader.getString(fState.geometryFile);
+  reader.getString(fState.dataFile);
+  reader.get(dataFileSize);
+  reader.get(dataFileTime);
+  reader.get(entry);
+  reader.get(step);
+  reader.get(fState.camera);
+  if (!reader.ok()) {
+    close();
+    return false;
+  }
+  fState.dataFileSize = dataFileSize;
+  fState.dataFileTime = dataFileTime;
+  fState.entry = entry;
+  fState.step = step;
+  if ((data = findSection(kHits, size)))
+    readHits(data, size, fState.hits);
+  return true;
+}
+
+void SessionFile::close()
+{
+  fFile.close();
+  fState = SessionState();
+}
+
+bool SessionFile::isDataFileCurrent() const
+{
+  long long size = 0, time = 0;
+  return !fState.dataFile.empty() && CommonTools::getFileStamp(fState.dataFile, size, time)
+         && size == fState.dataFileSize && time == fState.dataFileTime;
+}
+
+bool SessionFile::restoreStripIndex(StripIndex& index) const
+{
+  size_t size = 0;
+  const char* data = findSection(kStripIndex, size);
+  return data && index.deserialize(data, size) && index.getDataFile() == fState.dataFile;
+}
+
+bool SessionFile::restoreChannelQA(ChannelQA& qa) const
+{
+  size_t size = 0;
+  const char* data = findSection(kChannelQA, size);
+  return data && qa.deserialize(data, size) && qa.getDataFile() == fState.dataFile;
+}
+
+const char* SessionFile::findSection(uint32_t tag, size_t& size) const
+{
+  const char* data = fFile.data();
+  size_t offset = kHeaderSize;
+  while (offset + kSectionHeaderSize <= fFile.size()) {
+    uint32_t sectionTag = 0;
+    uint64_t bytes = 0;
+    std::memcpy(&sectionTag, data + offset, sizeof(sectionTag));
+    std::memcpy(&bytes, data + offset + 8, sizeof(bytes));
+    offset += kSectionHeaderSize;
+    if (bytes > fFile.size() - offset)
+      return 0;
+    if (sectionTag == tag) {
+      size = bytes;
+      return data + offset;
+    }
+    offset += padded(bytes);
+  }
+  return 0;
+}
+
+}
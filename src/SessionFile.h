@@ -0,0 +1,84 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file SessionFile.h
+ *  @brief Open files, view state and computed caches of a GUI session.
+ *
+ *  Layout: "JPETSES1" | uint32 version | uint32 sections, then per section
+ *  uint32 tag | uint32 reserved | uint64 bytes | payload padded to 8 bytes.
+ *  Unknown tags are skipped, so sections can be added without a new version.
+ *  The caches are only valid for the data file with the size and
+ *  modification time stored in the state section.
+ */
+
+#ifndef SESSIONFILE_H
+#define SESSIONFILE_H
+
+#include <cstdint>
+#include <string>
+
+#include "EventData.h"
+#include "MappedFile.h"
+
+namespace jpet_event_display
+{
+
+class StripIndex;
+class ChannelQA;
+
+struct SessionState
+{
+  std::string geometryFile;
+  std::string dataFile;
+  long long dataFileSize = 0;
+  long long dataFileTime = 0;
+  long long entry = 0;
+  int step = 0;
+  /// 3d view longitude, latitude and psi [deg]
+  double camera[3] = {0., 0., 0.};
+  /// hits of the shown entry, drawn before the data file is open again
+  ChannelHits hits;
+};
+
+class SessionFile
+{
+public:
+  SessionFile() {}
+
+  /// writes to a temporary file next to filename and renames it, so a crash never leaves half a session
+  static bool write(const std::string& filename, const SessionState& state,
+                    const StripIndex* index, const ChannelQA* qa);
+
+  /// maps the file and reads the state, caches are read on demand
+  bool open(const std::string& filename);
+  void close();
+  inline const SessionState& getState() const { return fState; }
+  /// true if the data file is unchanged since the session was written
+  bool isDataFileCurrent() const;
+  bool restoreStripIndex(StripIndex& index) const;
+  bool restoreChannelQA(ChannelQA& qa) const;
+
+private:
+  SessionFile(const SessionFile&) = delete;
+  SessionFile& operator=(const SessionFile&) = delete;
+
+  enum Tag : uint32_t { kState = 1, kHits = 2, kStripIndex = 3, kChannelQA = 4 };
+  /// payload of the section with the tag, 0 if there is none
+  const char* findSection(uint32_t tag, size_t& size) const;
+
+  MappedFile fFile;
+  SessionState fState;
+};
+
+}
+
+#endif /*  !SESSIONFILE_H */
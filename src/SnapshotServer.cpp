@@ -0,0 +1,188 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file SnapshotServer.cpp
+ */
+
+#include "SnapshotServer.h"
+#include <JPetLoggerInclude.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace jpet_event_display
+{
+
+SnapshotServer::SnapshotServer(const SnapshotServerOptions& options) :
+  fOptions(options), fCurrentEntry(0), fConnections(0)
+{
+  fCache = std::unique_ptr<EventCache>(new EventCache(
+      [this](long long entry) { return decode(entry); }, fOptions.cacheSize));
+}
+
+/// Entries missing from the cache are decoded in parallel by the reader pool.
+std::shared_ptr<const DecodedEvent> SnapshotServer::decode(long long entry)
+{
+  return fProcessor.decode(entry);
+}
+
+int SnapshotServer::run()
+{
+  if (!fProcessor.openFile(fOptions.dataFile.c_str())) {
+    ERROR(std::string("Error opening file:" + fOptions.dataFile));
+    return 1;
+  }
+
+  int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenSocket < 0) {
+    ERROR("Cannot create socket");
+    return 1;
+  }
+  int reuse = 1;
+  setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // never reachable from outside
+  address.sin_port = htons(fOptions.port);
+  if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+      || listen(listenSocket, fOptions.maxConnections) != 0) {
+    ERROR(std::string("Cannot listen on port " + CommonTools::intToString(fOptions.port)));
+    close(listenSocket);
+    return 1;
+  }
+  std::cout << "Serving " << fOptions.dataFile << " (" << fProcessor.getNumberOfEvents()
+            << " entries) on http://127.0.0.1:" << fOptions.port << std::endl;
+
+  while (true) {
+    int connection = accept(listenSocket, 0, 0);
+    if (connection < 0)
+      continue;
+    if (fConnections >= fOptions.maxConnections) {
+      close(connection);
+      continue;
+    }
+    int noDelay = 1;
+    setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    fConnections++;
+    std::thread([this, connection] {
+      serveConnection(connection);
+      close(connection);
+      fConnections--;
+    }).detach();
+  }
+  return 0;
+}
+
+void SnapshotServer::serveConnection(int socket)
+{
+  std::string buffer;
+  char chunk[4096];
+  while (true) {
+    size_t headerEnd = buffer.find("\r\n\r\n");
+    while (headerEnd == std::string::npos) {
+      // a client never ending its header does not get to grow the buffer
+      if (buffer.size() > kMaxHeaderBytes) {
+        sendResponse(socket, 431, "", false);
+        return;
+      }
+      ssize_t received = recv(socket, chunk, sizeof(chunk), 0);
+      if (received <= 0)
+        return;
+      buffer.append(chunk, received);
+      headerEnd = buffer.find("\r\n\r\n");
+    }
+    if (headerEnd > kMaxHeaderBytes) {
+      sendResponse(socket, 431, "", false);
+      return;
+    }
+    std::string request = buffer.substr(0, headerEnd);
+    buffer.erase(0, headerEnd + 4);
+
+    std::istringstream requestLine(request);
+    std::string method, path;
+    requestLine >> method >> path;
+    bool keepAlive = request.find("Connection: close") == std::string::npos;
+
+    std::string body;
+    int status = method == "GET" ? handleRequest(path, body) : 405;
+    if (!sendResponse(socket, status, body, keepAlive) || !keepAlive)
+      return;
+  }
+}
+
+bool SnapshotServer::sendResponse(int socket, int status, const std::string& body, bool keepAlive)
+{
+  std::ostringstream response;
+  response << "HTTP/1.1 " << status << (status == 200 ? " OK" : " Error") << "\r\n"
+           << "Content-Type: application/json\r\n"
+           << "Access-Control-Allow-Origin: *\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "Connection: " << (keepAlive ? "keep-alive" : "close") << "\r\n\r\n"
+           << body;
+  const std::string data = response.str();
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t result = send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (result <= 0)
+      return false;
+    sent += result;
+  }
+  return true;
+}
+
+int SnapshotServer::handleRequest(const std::string& path, std::string& body)
+{
+  if (path == "/info") {
+    std::ostringstream out;
+    out << "{\"entries\":" << fProcessor.getNumberOfEvents()
+        << ",\"current\":" << fCurrentEntry
+        << ",\"cached\":" << fCache->size()
+        << ",\"hits\":" << fCache->getHits()
+        << ",\"misses\":" << fCache->getMisses() << "}";
+    body = out.str();
+    return 200;
+  }
+  long long entry = -1;
+  if (path == "/current") {
+    entry = fCurrentEntry;
+  } else if (path.compare(0, 7, "/entry/") == 0) {
+    char* end = 0;
+    entry = std::strtoll(path.c_str() + 7, &end, 10);
+    if (end == path.c_str() + 7 || *end != '\0' || entry < 0) {
+      body = "{\"error\":\"bad entry number\"}";
+      return 400;
+    }
+  } else {
+    body = "{\"error\":\"unknown path\"}";
+    return 404;
+  }
+  if (entry >= fProcessor.getNumberOfEvents()) {
+    body = "{\"error\":\"entry out of range\"}";
+    return 404;
+  }
+  EventCache::SnapshotPtr snapshot = fCache->get(entry);
+  fCurrentEntry = entry;
+  body = snapshot->json;
+  return snapshot->event->valid ? 200 : 500;
+}
+
+}
@@ -0,0 +1,77 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file SnapshotServer.h
+ *  @brief Serves decoded entries as JSON over HTTP on the loopback interface.
+ */
+
+#ifndef SNAPSHOTSERVER_H
+#define SNAPSHOTSERVER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "DataProcessor.h"
+#include "EventCache.h"
+
+namespace jpet_event_display
+{
+
+struct SnapshotServerOptions
+{
+  std::string dataFile;
+  int port = 9090;
+  size_t cacheSize = 1024;
+  int maxConnections = 64;
+};
+
+/**
+ * One process decodes, every viewer shares the cache. Endpoints:
+ *   GET /entry/<n>  snapshot of entry n, becomes the current entry
+ *   GET /current    snapshot of the current entry
+ *   GET /info       number of entries and cache statistics
+ * Connections are kept alive, each one is served by its own thread.
+ * Entries are decoded through DataProcessor::decode, so different entries
+ * are decoded at the same time on separate readers of the file.
+ */
+class SnapshotServer
+{
+public:
+  explicit SnapshotServer(const SnapshotServerOptions& options);
+  /// blocks serving requests, returns process exit code on failure
+  int run();
+
+private:
+  SnapshotServer(const SnapshotServer&) = delete;
+  SnapshotServer& operator=(const SnapshotServer&) = delete;
+
+  void serveConnection(int socket);
+  /// false once the client is gone
+  bool sendResponse(int socket, int status, const std::string& body, bool keepAlive);
+  /// returns HTTP status code and fills body
+  int handleRequest(const std::string& path, std::string& body);
+  std::shared_ptr<const DecodedEvent> decode(long long entry);
+
+  /// requests with a longer header are answered with 431 and the connection is closed
+  static const size_t kMaxHeaderBytes = 8192;
+
+  SnapshotServerOptions fOptions;
+  DataProcessor fProcessor;
+  std::unique_ptr<EventCache> fCache;
+  std::atomic<long long> fCurrentEntry;
+  std::atomic<int> fConnections;
+};
+
+}
+
+#endif /*  !SNAPSHOTSERVER_H */
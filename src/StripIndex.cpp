@@ -0,0 +1,280 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file StripIndex.cpp
+ */
+
+#include "StripIndex.h"
+#include "ByteStream.h"
+#include "DataProcessor.h"
+#include "TimeIndex.h"
+#include <JPetLoggerInclude.h>
+#include <algorithm>
+#include <chrono>
+
+namespace jpet_event_display
+{
+
+namespace
+{
+void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t readVarint(const std::vector<uint8_t>& in, size_t& offset)
+{
+  uint64_t value = 0;
+  int shift = 0;
+  while (offset < in.size()) {
+    uint8_t byte = in[offset++];
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+    shift += 7;
+  }
+  return value;
+}
+
+bool skipEntryLess(const std::pair<long long, size_t>& skip, long long entry)
+{
+  return skip.first < entry;
+}
+
+bool entrySkipLess(long long entry, const std::pair<long long, size_t>& skip)
+{
+  return entry < skip.first;
+}
+}
+
+bool StripIndex::build(const std::string& dataFile, const std::atomic<bool>& cancel)
+{
+  return buildIndexes(dataFile, this, 0, cancel);
+}
+
+void StripIndex::add(int layer, int strip, long long entry)
+{
+  Postings& postings = fPostings[std::make_pair(layer, strip)];
+  if (entry <= postings.last)
+    return;
+  writeVarint(postings.deltas, entry - postings.last);
+  if (postings.count % kSkipInterval == 0)
+    postings.skips.push_back(std::make_pair(entry, postings.deltas.size()));
+  postings.last = entry;
+  postings.count++;
+}
+
+void StripIndex::finish(const std::string& dataFile, long long entries)
+{
+  fEntries = entries;
+  fDataFile = dataFile;
+}
+
+void StripIndex::clear()
+{
+  fPostings.clear();
+  fEntries = 0;
+  fDataFile.clear();
+}
+
+const StripIndex::Postings* StripIndex::find(int layer, int strip) const
+{
+  auto found = fPostings.find(std::make_pair(layer, strip));
+  return found == fPostings.end() ? 0 : &found->second;
+}
+
+std::vector<long long> StripIndex::getEntries(int layer, int strip) const
+{
+  std::vector<long long> entries;
+  const Postings* postings = find(layer, strip);
+  if (!postings)
+    return entries;
+  entries.reserve(postings->count);
+  long long entry = -1;
+  size_t offset = 0;
+  while (offset < postings->deltas.size()) {
+    entry += readVarint(postings->deltas, offset);
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+long long StripIndex::nextEntry(int layer, int strip, long long after) const
+{
+  const Postings* postings = find(layer, strip);
+  if (!postings || postings->last <= after)
+    return -1;
+  auto skip = std::upper_bound(postings->skips.begin(), postings->skips.end(), after, entrySkipLess);
+  if (skip == postings->skips.begin())
+    return skip->first;
+  --skip;
+  long long entry = skip->first;
+  size_t offset = skip->second;
+  while (entry <= after && offset < postings->deltas.size())
+    entry += readVarint(postings->deltas, offset);
+  return entry > after ? entry : -1;
+}
+
+long long StripIndex::previousEntry(int layer, int strip, long long before) const
+{
+  const Postings* postings = find(layer, strip);
+  if (!postings)
+    return -1;
+  auto skip = std::lower_bound(postings->skips.begin(), postings->skips.end(), before, skipEntryLess);
+  if (skip == postings->skips.begin())
+    return -1;
+  --skip;
+  long long entry = skip->first;
+  size_t offset = skip->second;
+  while (offset < postings->deltas.size()) {
+    size_t nextOffset = offset;
+    long long next = entry + readVarint(postings->deltas, nextOffset);
+    if (next >= before)
+      break;
+    entry = next;
+    offset = nextOffset;
+  }
+  return entry;
+}
+
+size_t StripIndex::getCount(int layer, int strip) const
+{
+  const Postings* postings = find(layer, strip);
+  return postings ? postings->count : 0;
+}
+
+double StripIndex::getHitRate(int layer, int strip) const
+{
+  return fEntries > 0 ? static_cast<double>(getCount(layer, strip)) / fEntries : 0.;
+}
+
+size_t StripIndex::getMemoryUsage() const
+{
+  size_t bytes = 0;
+  for (const auto& postings : fPostings)
+    bytes += postings.second.deltas.capacity()
+             + postings.second.skips.capacity() * sizeof(std::pair<long long, size_t>);
+  return bytes;
+}
+
+void StripIndex::serialize(std::string& out) const
+{
+  ByteWriter writer(out);
+  writer.putString(fDataFile);
+  writer.put<int64_t>(fEntries);
+  writer.put<uint64_t>(fPostings.size());
+  std::vector<int64_t> skipEntries;
+  std::vector<uint64_t> skipOffsets;
+  for (const auto& strip : fPostings) {
+    const Postings& postings = strip.second;
+    writer.put<int32_t>(strip.first.first);
+    writer.put<int32_t>(strip.first.second);
+    writer.put<uint64_t>(postings.count);
+    writer.put<int64_t>(postings.last);
+    writer.putVector(postings.deltas);
+    skipEntries.clear();
+    skipOffsets.clear();
+    for (const auto& skip : postings.skips) {
+      skipEntries.push_back(skip.first);
+      skipOffsets.push_back(skip.second);
+    }
+    writer.putVector(skipEntries);
+    writer.putVector(skipOffsets);
+  }
+}
+
+bool StripIndex::deserialize(const char* data, size_t size)
+{
+  clear();
+  ByteReader reader(data, size);
+  int64_t entries = 0;
+  uint64_t strips = 0;
+  reader.getString(fDataFile);
+  reader.get(entries);
+  reader.get(strips);
+  std::vector<int64_t> skipEntries;
+  std::vector<uint64_t> skipOffsets;
+  for (uint64_t i = 0; i < strips && reader.ok(); i++) {
+    int32_t layer = 0, strip = 0;
+    uint64_t count = 0;
+    int64_t last = -1;
+    reader.get(layer);
+    reader.get(strip);
+    reader.get(count);
+    reader.get(last);
+    Postings& postings = fPostings[std::make_pair(layer, strip)];
+    reader.getVector(postings.deltas);
+    reader.getVector(skipEntries);
+    reader.getVector(skipOffsets);
+    if (skipEntries.size() != skipOffsets.size())
+      break;
+    postings.count = count;
+    postings.last = last;
+    for (size_t k = 0; k < skipEntries.size(); k++)
+      postings.skips.push_back(std::make_pair(skipEntries[k], skipOffsets[k]));
+  }
+  if (!reader.ok() || fPostings.size() != strips) {
+    clear();
+    return false;
+  }
+  fEntries = entries;
+  return true;
+}
+
+bool buildIndexes(const std::string& dataFile, StripIndex* strips, TimeIndex* times,
+                  const std::atomic<bool>& cancel)
+{
+  if (strips)
+    strips->clear();
+  if (times)
+    times->clear();
+  DataProcessor processor;
+  if (!processor.openFile(dataFile.c_str()))
+    return false;
+  auto start = std::chrono::steady_clock::now();
+  const long long entries = processor.getNumberOfEvents();
+  for (long long entry = 0; entry < entries; entry++) {
+    if (cancel)
+      return false;
+    if (!processor.nthEvent(entry))
+      continue;
+    if (strips) {
+      ChannelHits hits = processor.getChannelHits();
+      for (size_t i = 0; i < hits.size(); i++)
+        strips->add(hits.layers[i], hits.strips[i], entry);
+    }
+    if (times) {
+      const long long window = processor.getTimeWindowIndex();
+      if (window >= 0)
+        times->add(entry, window);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (strips) {
+    strips->finish(dataFile, entries);
+    INFO(std::string("Strip index of " + dataFile + ": " + std::to_string(strips->getNumberOfStrips())
+                     + " strips, " + std::to_string(strips->getMemoryUsage()) + " bytes"));
+  }
+  if (times) {
+    times->finish(dataFile);
+    INFO(std::string("Time index of " + dataFile + ": " + std::to_string(times->size()) + " entries"));
+  }
+  INFO(std::string("Indexed " + std::to_string(entries) + " entries of " + dataFile + " in "
+                   + std::to_string(seconds) + " s"));
+  return true;
+}
+
+}
@@ -0,0 +1,97 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file StripIndex.h
+ *  @brief Inverted index strip -> entries in which the strip fired.
+ */
+
+#ifndef STRIPINDEX_H
+#define STRIPINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jpet_event_display
+{
+
+class TimeIndex;
+
+/**
+ * Every strip keeps its entries as a sorted list of varint encoded deltas.
+ * Each kSkipInterval-th posting is also stored uncompressed with its byte
+ * offset, so seeking to the hit next to an entry decodes at most
+ * kSkipInterval deltas however often the strip fired.
+ */
+class StripIndex
+{
+public:
+  StripIndex() {}
+
+  /// one pass over all entries of the file with its own DataProcessor,
+  /// returns false when the file cannot be read or cancel was set
+  bool build(const std::string& dataFile, const std::atomic<bool>& cancel);
+  /// entries have to be added in increasing order, repeats are ignored
+  void add(int layer, int strip, long long entry);
+  /// marks the index complete for the first entries of dataFile
+  void finish(const std::string& dataFile, long long entries);
+  void clear();
+
+  std::vector<long long> getEntries(int layer, int strip) const;
+  /// first entry after the given one where the strip fired, -1 if none
+  long long nextEntry(int layer, int strip, long long after) const;
+  /// last entry before the given one where the strip fired, -1 if none
+  long long previousEntry(int layer, int strip, long long before) const;
+  size_t getCount(int layer, int strip) const;
+  /// fraction of indexed entries in which the strip fired
+  double getHitRate(int layer, int strip) const;
+
+  inline long long getNumberOfEntries() const { return fEntries; }
+  /// strips which fired at least once
+  inline size_t getNumberOfStrips() const { return fPostings.size(); }
+  inline const std::string& getDataFile() const { return fDataFile; }
+  size_t getMemoryUsage() const;
+  /// the postings as they are in memory, for session files
+  void serialize(std::string& out) const;
+  /// replaces the contents, false (and an empty index) on malformed data
+  bool deserialize(const char* data, size_t size);
+
+private:
+  static const size_t kSkipInterval = 128;
+
+  struct Postings
+  {
+    std::vector<uint8_t> deltas;
+    /// (entry, offset of the delta following it) for every kSkipInterval-th posting
+    std::vector<std::pair<long long, size_t> > skips;
+    size_t count = 0;
+    long long last = -1;
+  };
+
+  const Postings* find(int layer, int strip) const;
+
+  std::map<std::pair<int, int>, Postings> fPostings;
+  long long fEntries = 0;
+  std::string fDataFile;
+};
+
+/// one pass over all entries of the file with its own DataProcessor, filling
+/// the indexes given, either may be 0; false when the file cannot be read or cancel was set
+bool buildIndexes(const std::string& dataFile, StripIndex* strips, TimeIndex* times,
+                  const std::atomic<bool>& cancel);
+
+}
+
+#endif /*  !STRIPINDEX_H */
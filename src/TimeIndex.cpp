@@ -0,0 +1,126 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file TimeIndex.cpp
+ */
+
+#include "TimeIndex.h"
+#include "ByteStream.h"
+#include "CommonTools.h"
+#include "MappedFile.h"
+#include "StripIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace jpet_event_display
+{
+
+namespace
+{
+const char kMagic[8] = {'J', 'P', 'E', 'T', 'T', 'I', 'X', '1'};
+}
+
+const double TimeIndex::kDefaultWindowLength = 50e6;
+
+bool TimeIndex::build(const std::string& dataFile, const std::atomic<bool>& cancel)
+{
+  return buildIndexes(dataFile, 0, this, cancel);
+}
+
+void TimeIndex::add(long long entry, long long window)
+{
+  fWindows.push_back(std::make_pair(window, entry));
+}
+
+void TimeIndex::finish(const std::string& dataFile)
+{
+  // entries of one DAQ run are nearly always in window order already
+  if (!std::is_sorted(fWindows.begin(), fWindows.end()))
+    std::sort(fWindows.begin(), fWindows.end());
+  fDataFile = dataFile;
+}
+
+void TimeIndex::clear()
+{
+  fWindows.clear();
+  fDataFile.clear();
+}
+
+long long TimeIndex::findEntry(double time, double* startTime) const
+{
+  if (fWindows.empty() || fWindowLength <= 0.)
+    return -1;
+  const double window = std::floor(time / fWindowLength);
+  auto after = std::upper_bound(fWindows.begin(), fWindows.end(), window,
+      [](double value, const std::pair<long long, long long>& candidate) { return value < candidate.first; });
+  const auto& found = after == fWindows.begin() ? *after : *(after - 1);
+  if (startTime)
+    *startTime = found.first * fWindowLength;
+  return found.second;
+}
+
+bool TimeIndex::save(const std::string& filename) const
+{
+  long long size = 0, time = 0;
+  if (!CommonTools::getFileStamp(fDataFile, size, time))
+    return false;
+  std::string data(kMagic, sizeof(kMagic));
+  ByteWriter writer(data);
+  writer.putString(fDataFile);
+  writer.put<int64_t>(size);
+  writer.put<int64_t>(time);
+  std::vector<int64_t> windows;
+  std::vector<int64_t> entries;
+  for (const auto& window : fWindows) {
+    windows.push_back(window.first);
+    entries.push_back(window.second);
+  }
+  writer.putVector(windows);
+  writer.putVector(entries);
+  return CommonTools::writeFileAtomically(filename, data);
+}
+
+bool TimeIndex::load(const std::string& filename)
+{
+  clear();
+  MappedFile file;
+  if (!file.open(filename) || file.size() < sizeof(kMagic)
+      || std::memcmp(file.data(), kMagic, sizeof(kMagic)) != 0)
+    return false;
+  ByteReader reader(file.data() + sizeof(kMagic), file.size() - sizeof(kMagic));
+  int64_t storedSize = 0, storedTime = 0;
+  reader.getString(fDataFile);
+  reader.get(storedSize);
+  reader.get(storedTime);
+  std::vector<int64_t> windows;
+  std::vector<int64_t> entries;
+  reader.getVector(windows);
+  reader.getVector(entries);
+  long long size = 0, time = 0;
+  if (!reader.ok() || windows.size() != entries.size() || !CommonTools::getFileStamp(fDataFile, size, time)
+      || size != storedSize || time != storedTime) {
+    clear();
+    return false;
+  }
+  fWindows.reserve(windows.size());
+  for (size_t i = 0; i < windows.size(); i++)
+    fWindows.push_back(std::make_pair(windows[i], entries[i]));
+  return true;
+}
+
+std::string TimeIndex::getSidecarName(const std::string& dataFile)
+{
+  return dataFile + ".timeindex";
+}
+
+}
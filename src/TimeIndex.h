@@ -0,0 +1,77 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file TimeIndex.h
+ *  @brief Start time of every entry, sorted by time for seeking to a timestamp.
+ */
+
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jpet_event_display
+{
+
+/**
+ * Channel times are relative to the DAQ time window an entry was taken in,
+ * so the absolute start of an entry is the index of its window times the
+ * window length [ps]. The window indices are stored, the length is only
+ * applied when times are asked for, so it can be changed without a rescan.
+ * Entries of files without window indices, e.g. event selection files, are
+ * left out. Pairs are kept sorted by window, so entries need not be in time
+ * order for findEntry to work.
+ * The index is stored next to the data file as <data file>.timeindex,
+ * together with the size and modification time of the data file.
+ */
+class TimeIndex
+{
+public:
+  /// window length of the DAQ unless set otherwise [ps]
+  static const double kDefaultWindowLength;
+
+  explicit TimeIndex(double windowLength = kDefaultWindowLength) : fWindowLength(windowLength) {}
+
+  /// one pass over all entries of the file with its own DataProcessor, see buildIndexes
+  bool build(const std::string& dataFile, const std::atomic<bool>& cancel);
+  void add(long long entry, long long window);
+  /// sorts what was added, needed before findEntry
+  void finish(const std::string& dataFile);
+  void clear();
+
+  /// the entry starting last at or before time [ps], the first one for earlier times, -1 if empty
+  long long findEntry(double time, double* startTime = 0) const;
+  inline size_t size() const { return fWindows.size(); }
+  inline double getFirstTime() const { return fWindows.empty() ? 0. : fWindows.front().first * fWindowLength; }
+  inline double getLastTime() const { return fWindows.empty() ? 0. : fWindows.back().first * fWindowLength; }
+  inline void setWindowLength(double windowLength) { fWindowLength = windowLength; }
+  inline double getWindowLength() const { return fWindowLength; }
+  inline const std::string& getDataFile() const { return fDataFile; }
+
+  bool save(const std::string& filename) const;
+  /// fails for an index of a data file which was changed since
+  bool load(const std::string& filename);
+  static std::string getSidecarName(const std::string& dataFile);
+
+private:
+  /// (window index, entry)
+  std::vector<std::pair<long long, long long> > fWindows;
+  double fWindowLength;
+  std::string fDataFile;
+};
+
+}
+
+#endif /*  !TIMEINDEX_H */
@@ -0,0 +1,90 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file TimeSlice.cpp
+ */
+
+#include "TimeSlice.h"
+#include <algorithm>
+
+namespace jpet_event_display
+{
+
+void TimeSlice::reset(const ChannelHits* hits)
+{
+  fHits = hits;
+  fBegin = fEnd = 0;
+  fHitsPerStrip.clear();
+}
+
+void TimeSlice::setRange(double from, double to, std::vector<StripChange>& changes)
+{
+  if (!fHits)
+    return;
+  std::pair<size_t, size_t> range = hitRangeInTime(*fHits, from, to);
+  if (range.first >= fEnd || range.second <= fBegin) {
+    removeHits(fBegin, fEnd, changes);
+    addHits(range.first, range.second, changes);
+  } else {
+    // overlapping intervals, only the ends moved
+    if (range.first < fBegin)
+      addHits(range.first, fBegin, changes);
+    else
+      removeHits(fBegin, range.first, changes);
+    if (range.second > fEnd)
+      addHits(fEnd, range.second, changes);
+    else
+      removeHits(range.second, fEnd, changes);
+  }
+  fBegin = range.first;
+  fEnd = range.second;
+}
+
+void TimeSlice::addHits(size_t begin, size_t end, std::vector<StripChange>& changes)
+{
+  for (size_t i = begin; i < end; i++) {
+    int& count = fHitsPerStrip[std::make_pair(fHits->layers[i], fHits->strips[i])];
+    if (count++ == 0)
+      changes.push_back(StripChange(fHits->layers[i], fHits->strips[i], true));
+  }
+}
+
+void TimeSlice::removeHits(size_t begin, size_t end, std::vector<StripChange>& changes)
+{
+  for (size_t i = begin; i < end; i++) {
+    auto found = fHitsPerStrip.find(std::make_pair(fHits->layers[i], fHits->strips[i]));
+    if (found != fHitsPerStrip.end() && --found->second == 0) {
+      changes.push_back(StripChange(fHits->layers[i], fHits->strips[i], false));
+      fHitsPerStrip.erase(found);
+    }
+  }
+}
+
+ScintillatorsInLayers TimeSlice::getSelection() const
+{
+  ScintillatorsInLayers selection;
+  for (const auto& strip : fHitsPerStrip)
+    selection[strip.first.first].push_back(strip.first.second);
+  return selection;
+}
+
+double TimeSlice::getFirstTime() const
+{
+  return fHits && fHits->size() > 0 ? fHits->times.front() : 0.;
+}
+
+double TimeSlice::getLastTime() const
+{
+  return fHits && fHits->size() > 0 ? fHits->times.back() : 0.;
+}
+
+}
@@ -0,0 +1,63 @@
+/**
+ *  @copyright Copyright 2016 The J-PET Framework Authors. All rights reserved.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may find a copy of the License in the LICENCE file.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @file TimeSlice.h
+ *  @brief Strips fired inside a moving time interval of one entry.
+ */
+
+#ifndef TIMESLICE_H
+#define TIMESLICE_H
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "EventData.h"
+
+namespace jpet_event_display
+{
+
+/**
+ * Keeps the number of hits per strip inside [from, to) of time sorted hits.
+ * Moving the interval finds its ends with two binary searches and only
+ * visits hits which entered or left it, so the cost depends on how far the
+ * slice moved and not on how many hits the entry holds.
+ */
+class TimeSlice
+{
+public:
+  TimeSlice() {}
+
+  /// hits have to stay alive and sorted by time until the next reset
+  void reset(const ChannelHits* hits);
+  /// moves the slice, strips whose fired state changed are appended to changes
+  void setRange(double from, double to, std::vector<StripChange>& changes);
+
+  ScintillatorsInLayers getSelection() const;
+  inline size_t getNumberOfHits() const { return fEnd - fBegin; }
+  /// time of the first and the last hit, both 0 without hits
+  double getFirstTime() const;
+  double getLastTime() const;
+
+private:
+  void addHits(size_t begin, size_t end, std::vector<StripChange>& changes);
+  void removeHits(size_t begin, size_t end, std::vector<StripChange>& changes);
+
+  const ChannelHits* fHits = 0;
+  size_t fBegin = 0;
+  size_t fEnd = 0;
+  std::map<std::pair<int, int>, int> fHitsPerStrip;
+};
+
+}
+
+#endif /*  !TIMESLICE_H */
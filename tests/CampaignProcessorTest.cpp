@@ -0,0 +1,141 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE CampaignProcessorTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/CampaignProcessor.h"
+#include "../src/EventSelectionFile.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+using namespace jpet_event_display;
+
+namespace
+{
+const char* kFirstFile = "CampaignProcessorTest.first.jpetsel";
+const char* kSecondFile = "CampaignProcessorTest.second.jpetsel";
+const char* kCheckpointFile = "CampaignProcessorTest.checkpoint";
+const long long kChunkEntries = 5;
+/// chunk number followed by its ChunkResult, as appended by the campaign
+const size_t kRecordBytes = sizeof(uint64_t) + sizeof(CampaignProcessor::ChunkResult);
+
+void writeSelection(const std::string& filename, int events)
+{
+  EventSelectionWriter writer(8);
+  BOOST_REQUIRE(writer.open(filename));
+  for (int event = 0; event < events; event++) {
+    ChannelHits hits;
+    for (int i = 0; i < 1 + event % 4; i++)
+      hits.add(1 + i % 3, 1 + event % 48, 10 * event + i, i % 2 ? 'B' : 'A', true, 1000. * event + i, 0.5f * i);
+    writer.addEvent(hits);
+  }
+  BOOST_REQUIRE(writer.close());
+}
+
+std::string readFile(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& filename, const std::string& data)
+{
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  out.write(data.data(), data.size());
+}
+
+struct CampaignFixture
+{
+  CampaignFixture()
+  {
+    writeSelection(kFirstFile, 30);
+    writeSelection(kSecondFile, 17);
+    options.dataFiles.push_back(kFirstFile);
+    options.dataFiles.push_back(kSecondFile);
+    options.workers = 3;
+    options.chunkEntries = kChunkEntries;
+  }
+  ~CampaignFixture()
+  {
+    std::remove(kFirstFile);
+    std::remove(kSecondFile);
+    std::remove(kCheckpointFile);
+  }
+
+  CampaignOptions options;
+};
+
+void requireEqual(const CampaignProcessor::ChunkResult& a, const CampaignProcessor::ChunkResult& b)
+{
+  BOOST_REQUIRE_EQUAL(a.entries, b.entries);
+  BOOST_REQUIRE_EQUAL(a.hits, b.hits);
+  BOOST_REQUIRE_EQUAL(a.coincidences, b.coincidences);
+  BOOST_REQUIRE_EQUAL(a.clusters, b.clusters);
+  BOOST_REQUIRE_EQUAL(a.bytesRead, b.bytesRead);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_FIXTURE_TEST_CASE( ResumedCampaignMatchesUninterruptedRun, CampaignFixture )
+{
+  const long long chunks = 6 + 4;
+  std::atomic<bool> cancel(false);
+  CampaignProcessor uninterrupted(options);
+  BOOST_REQUIRE_EQUAL(uninterrupted.run(cancel), 0);
+  BOOST_REQUIRE_EQUAL(uninterrupted.getChunksDone(), chunks);
+  const CampaignProcessor::ChunkResult expected = uninterrupted.getTotal();
+  BOOST_REQUIRE_EQUAL(expected.entries, 30 + 17);
+
+  options.checkpointFile = kCheckpointFile;
+  {
+    CampaignProcessor checkpointed(options);
+    BOOST_REQUIRE_EQUAL(checkpointed.run(cancel), 0);
+    requireEqual(checkpointed.getTotal(), expected);
+  }
+  // killed after four records were flushed and while the fifth was being written
+  const std::string checkpoint = readFile(kCheckpointFile);
+  BOOST_REQUIRE(checkpoint.size() > chunks * kRecordBytes);
+  const size_t header = checkpoint.size() - chunks * kRecordBytes;
+  writeFile(kCheckpointFile, checkpoint.substr(0, header + 4 * kRecordBytes + kRecordBytes / 2));
+
+  CampaignProcessor resumed(options);
+  BOOST_REQUIRE_EQUAL(resumed.run(cancel), 0);
+  BOOST_REQUIRE_EQUAL(resumed.getChunksDone(), chunks - 4);
+  requireEqual(resumed.getTotal(), expected);
+  // the torn record was dropped and every chunk is recorded once again
+  BOOST_REQUIRE_EQUAL(readFile(kCheckpointFile).size(), header + chunks * kRecordBytes);
+}
+
+BOOST_FIXTURE_TEST_CASE( CancelledCampaignIsResumed, CampaignFixture )
+{
+  options.checkpointFile = kCheckpointFile;
+  std::atomic<bool> cancel(false);
+  CampaignProcessor uninterrupted(options);
+  BOOST_REQUIRE_EQUAL(uninterrupted.run(cancel), 0);
+  const CampaignProcessor::ChunkResult expected = uninterrupted.getTotal();
+  std::remove(kCheckpointFile);
+
+  // cancelled as soon as the checkpoint is opened, wherever the worker is by then
+  std::atomic<bool> cancelled(false);
+  options.workers = 1;
+  CampaignProcessor interrupted(options);
+  std::thread canceller([&] {
+    while (!std::ifstream(kCheckpointFile).good())
+      std::this_thread::yield();
+    cancelled = true;
+  });
+  interrupted.run(cancelled);
+  canceller.join();
+  BOOST_REQUIRE(interrupted.getTotal().entries <= expected.entries);
+
+  CampaignProcessor resumed(options);
+  BOOST_REQUIRE_EQUAL(resumed.run(cancel), 0);
+  BOOST_REQUIRE_EQUAL(interrupted.getChunksDone() + resumed.getChunksDone(), 6 + 4);
+  requireEqual(resumed.getTotal(), expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
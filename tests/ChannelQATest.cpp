@@ -0,0 +1,90 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ChannelQATest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/ChannelQA.h"
+
+using namespace jpet_event_display;
+
+namespace
+{
+/// strips 1 - 10 of layer 1 fire on both sides in every second entry, except
+/// strip 3 which never fires, strip 5 which fires on side A only and strip 7
+/// which fires in every entry
+void fillLayer(ChannelQA& qa, int entries)
+{
+  for (int entry = 0; entry < entries; entry++) {
+    ChannelHits hits;
+    for (int strip = 1; strip <= 10; strip++) {
+      if (strip == 3 || (strip != 7 && entry % 2))
+        continue;
+      hits.add(1, strip, 2 * strip, 'A', true, 0., 80.f);
+      // a second threshold of the same side is counted once
+      hits.add(1, strip, 2 * strip, 'A', true, 10., 160.f);
+      if (strip != 5)
+        hits.add(1, strip, 2 * strip + 1, 'B', true, 5., 80.f);
+    }
+    qa.addEntry(hits);
+  }
+}
+
+bool hasFlag(const ChannelFlags& flags, int strip, ChannelFlag::Kind kind, char side = 0)
+{
+  for (const auto& flag : flags)
+    if (flag.layer == 1 && flag.strip == strip && flag.kind == kind && flag.side == side)
+      return true;
+  return false;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( DeadHotAndDeadSide )
+{
+  ChannelQA qa;
+  qa.setStripsInLayers({{1, 10}});
+  fillLayer(qa, 1000);
+  BOOST_REQUIRE_EQUAL(qa.getNumberOfEntries(), 1000);
+  BOOST_REQUIRE_CLOSE(qa.getStripRates()[std::make_pair(1, 1)], 0.5, 1e-9);
+
+  const ChannelFlags flags = qa.findFlags();
+  BOOST_REQUIRE_EQUAL(flags.size(), 3u);
+  BOOST_REQUIRE(hasFlag(flags, 3, ChannelFlag::kDead));
+  BOOST_REQUIRE(hasFlag(flags, 7, ChannelFlag::kHot));
+  BOOST_REQUIRE(hasFlag(flags, 5, ChannelFlag::kDeadSide, 'B'));
+  BOOST_REQUIRE_CLOSE(flags[0].layerMedian, 0.5, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( HitsOutsideTheLayout )
+{
+  ChannelQA qa;
+  qa.setStripsInLayers({{1, 10}});
+  ChannelHits hits;
+  hits.add(1, 11, 1, 'A', true, 0., 80.f);
+  hits.add(2, 1, 1, 'A', true, 0., 80.f);
+  hits.add(1, 0, 1, 'A', true, 0., 80.f);
+  qa.addEntry(hits);
+  BOOST_REQUIRE_EQUAL(qa.getNumberOfDroppedHits(), 3);
+  BOOST_REQUIRE(qa.findFlags().empty());
+}
+
+BOOST_AUTO_TEST_CASE( WithoutLayoutAndSerialized )
+{
+  // the highest strip seen is taken as the size of the layer
+  ChannelQA qa;
+  fillLayer(qa, 200);
+  ChannelFlags flags = qa.findFlags();
+  BOOST_REQUIRE(hasFlag(flags, 3, ChannelFlag::kDead));
+  BOOST_REQUIRE(hasFlag(flags, 7, ChannelFlag::kHot));
+
+  std::string data;
+  qa.serialize(data);
+  ChannelQA restored;
+  BOOST_REQUIRE(restored.deserialize(data.data(), data.size()));
+  BOOST_REQUIRE_EQUAL(restored.getNumberOfEntries(), 200);
+  BOOST_REQUIRE_EQUAL(restored.findFlags().size(), flags.size());
+  BOOST_REQUIRE(!restored.deserialize(data.data(), data.size() - 1));
+  BOOST_REQUIRE_EQUAL(restored.getNumberOfEntries(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
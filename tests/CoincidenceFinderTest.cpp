@@ -0,0 +1,97 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE CoincidenceFinderTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/CoincidenceFinder.h"
+
+using namespace jpet_event_display;
+
+namespace
+{
+/// leading edges of both sides of a strip, side A at timeA and side B at timeB
+void addStrip(ChannelHits& hits, int layer, int strip, double timeA, double timeB)
+{
+  hits.add(layer, strip, 2 * strip, 'A', true, timeA, 80.f);
+  hits.add(layer, strip, 2 * strip + 1, 'B', true, timeB, 80.f);
+}
+
+CoincidenceFinder makeFinder()
+{
+  StripAngles angles;
+  angles[std::make_pair(1, 1)] = 0.;
+  angles[std::make_pair(1, 13)] = 180.;
+  angles[std::make_pair(1, 7)] = 90.;
+  CoincidenceFinder finder;
+  finder.setStripAngles(angles);
+  return finder;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( BackToBackPair )
+{
+  ChannelHits hits;
+  addStrip(hits, 1, 1, 0., 1000.);
+  addStrip(hits, 1, 13, 200., 300.);
+  sortHitsByTime(hits);
+  Coincidences coincidences = makeFinder().find(hits);
+
+  // re-sorted by mean time, strip 13 first though its later side comes last
+  BOOST_REQUIRE_EQUAL(coincidences.hits.size(), 2u);
+  BOOST_REQUIRE_EQUAL(coincidences.hits[0].strip, 13);
+  BOOST_REQUIRE_CLOSE(coincidences.hits[0].time, 250., 1e-9);
+  BOOST_REQUIRE_CLOSE(coincidences.hits[1].time, 500., 1e-9);
+  BOOST_REQUIRE_CLOSE(coincidences.hits[1].timeDifference, -1000., 1e-9);
+  BOOST_REQUIRE_EQUAL(coincidences.clusters.size(), 1u);
+  BOOST_REQUIRE_EQUAL(coincidences.getNumberOfPairs(), 1u);
+  BOOST_REQUIRE(coincidences.clusters[0].pairs[0] == std::make_pair(size_t(0), size_t(1)));
+}
+
+BOOST_AUTO_TEST_CASE( NoPairsWithoutAngles )
+{
+  ChannelHits hits;
+  addStrip(hits, 1, 1, 0., 1000.);
+  addStrip(hits, 1, 13, 200., 300.);
+  sortHitsByTime(hits);
+  CoincidenceFinder finder;
+  BOOST_REQUIRE(!finder.hasStripAngles());
+  Coincidences coincidences = finder.find(hits);
+  BOOST_REQUIRE_EQUAL(coincidences.hits.size(), 2u);
+  BOOST_REQUIRE(coincidences.clusters.empty());
+}
+
+BOOST_AUTO_TEST_CASE( RejectedCandidates )
+{
+  CoincidenceFinder finder = makeFinder();
+  CoincidenceOptions options;
+  options.sideWindow = 5000.;
+  options.coincidenceWindow = 3000.;
+  finder.setOptions(options);
+
+  // sides too far apart give no strip hit
+  ChannelHits hits;
+  addStrip(hits, 1, 1, 0., 6000.);
+  sortHitsByTime(hits);
+  BOOST_REQUIRE(finder.find(hits).hits.empty());
+
+  // perpendicular strips are no pair
+  hits.clear();
+  addStrip(hits, 1, 1, 0., 100.);
+  addStrip(hits, 1, 7, 50., 150.);
+  sortHitsByTime(hits);
+  Coincidences coincidences = finder.find(hits);
+  BOOST_REQUIRE_EQUAL(coincidences.hits.size(), 2u);
+  BOOST_REQUIRE(coincidences.clusters.empty());
+
+  // opposite strips outside the coincidence window are no pair
+  hits.clear();
+  addStrip(hits, 1, 1, 0., 100.);
+  addStrip(hits, 1, 13, 10000., 10100.);
+  sortHitsByTime(hits);
+  coincidences = finder.find(hits);
+  BOOST_REQUIRE_EQUAL(coincidences.hits.size(), 2u);
+  BOOST_REQUIRE(coincidences.clusters.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
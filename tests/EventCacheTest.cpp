@@ -0,0 +1,111 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE EventCacheTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/EventCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+using namespace jpet_event_display;
+
+namespace
+{
+std::shared_ptr<const DecodedEvent> decode(long long entry)
+{
+  auto event = std::make_shared<DecodedEvent>();
+  event->entry = entry;
+  event->valid = true;
+  event->selection[1].push_back(static_cast<int>(entry));
+  return event;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( ConcurrentGetsAreCoalesced )
+{
+  std::atomic<int> decodes(0);
+  std::atomic<bool> release(false);
+  EventCache cache([&](long long entry) {
+    decodes++;
+    while (!release)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return decode(entry);
+  }, 4);
+
+  EventCache::SnapshotPtr first, second;
+  std::thread decoding([&] { first = cache.get(5); });
+  while (decodes == 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::thread waiting([&] { second = cache.get(5); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  release = true;
+  decoding.join();
+  waiting.join();
+
+  BOOST_REQUIRE_EQUAL(decodes, 1);
+  BOOST_REQUIRE(first);
+  BOOST_REQUIRE(first == second);
+  BOOST_REQUIRE_EQUAL(first->event->entry, 5);
+  BOOST_REQUIRE(!first->json.empty());
+  BOOST_REQUIRE_EQUAL(cache.getMisses(), 1u);
+  BOOST_REQUIRE_EQUAL(cache.getHits(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE( LeastRecentlyUsedIsEvicted )
+{
+  int decodes = 0;
+  EventCache cache([&](long long entry) {
+    decodes++;
+    return decode(entry);
+  }, 2);
+
+  cache.get(1);
+  cache.get(2);
+  cache.get(1); // 2 is the least recently used now
+  cache.get(3);
+  BOOST_REQUIRE_EQUAL(cache.size(), 2u);
+  BOOST_REQUIRE_EQUAL(decodes, 3);
+  cache.get(1);
+  BOOST_REQUIRE_EQUAL(decodes, 3);
+  cache.get(2);
+  BOOST_REQUIRE_EQUAL(decodes, 4);
+  BOOST_REQUIRE_EQUAL(cache.getHits(), 2u);
+  BOOST_REQUIRE_EQUAL(cache.getMisses(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE( FailedDecodeIsNotCached )
+{
+  int decodes = 0;
+  EventCache cache([&](long long entry) {
+    if (decodes++ == 0)
+      throw std::runtime_error("unreadable basket");
+    return decode(entry);
+  }, 2);
+
+  BOOST_REQUIRE_THROW(cache.get(7), std::runtime_error);
+  BOOST_REQUIRE_EQUAL(cache.size(), 0u);
+  EventCache::SnapshotPtr snapshot = cache.get(7);
+  BOOST_REQUIRE(snapshot && snapshot->event->valid);
+  BOOST_REQUIRE_EQUAL(decodes, 2);
+}
+
+BOOST_AUTO_TEST_CASE( JsonOfNonFiniteValues )
+{
+  DecodedEvent event = *decode(3);
+  DiagramSignal signal;
+  signal.pmID = 4;
+  signal.times.push_back(0.1);
+  signal.thresholds.push_back(std::numeric_limits<double>::quiet_NaN());
+  event.diagram.push_back(signal);
+  const std::string json = toJson(event);
+  BOOST_REQUIRE(json.find("null") != std::string::npos);
+  BOOST_REQUIRE(json.find("nan") == std::string::npos);
+  BOOST_REQUIRE(json.find("0.1") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
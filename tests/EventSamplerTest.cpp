@@ -0,0 +1,56 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE EventSamplerTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/EventSampler.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace jpet_event_display;
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( DistinctEntriesSortedWithinRounds )
+{
+  const long long entries = 100000;
+  const std::vector<long long> drawn = EventSampler::drawEntries(entries, 1000, false, 1234);
+  BOOST_REQUIRE_EQUAL(drawn.size(), 1000u);
+  BOOST_REQUIRE_EQUAL(std::set<long long>(drawn.begin(), drawn.end()).size(), 1000u);
+  BOOST_REQUIRE(*std::min_element(drawn.begin(), drawn.end()) >= 0);
+  BOOST_REQUIRE(*std::max_element(drawn.begin(), drawn.end()) < entries);
+  // rounds of 32, 64, 128, ... entries
+  size_t round = 32;
+  for (size_t begin = 0; begin < drawn.size(); begin += round, round *= 2) {
+    const size_t end = std::min(drawn.size(), begin + round);
+    BOOST_REQUIRE(std::is_sorted(drawn.begin() + begin, drawn.begin() + end));
+  }
+  BOOST_REQUIRE(!std::is_sorted(drawn.begin(), drawn.end()));
+  BOOST_REQUIRE(drawn == EventSampler::drawEntries(entries, 1000, false, 1234));
+}
+
+BOOST_AUTO_TEST_CASE( StratifiedOnePerStratum )
+{
+  const long long entries = 1003;
+  const long long samples = 10;
+  std::vector<long long> drawn = EventSampler::drawEntries(entries, samples, true, 99);
+  BOOST_REQUIRE_EQUAL(drawn.size(), static_cast<size_t>(samples));
+  std::sort(drawn.begin(), drawn.end());
+  for (long long i = 0; i < samples; i++) {
+    BOOST_REQUIRE(drawn[i] >= i * entries / samples);
+    BOOST_REQUIRE(drawn[i] < (i + 1) * entries / samples);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( SmallPopulations )
+{
+  std::vector<long long> drawn = EventSampler::drawEntries(50, 80, false, 7);
+  std::sort(drawn.begin(), drawn.end());
+  BOOST_REQUIRE_EQUAL(drawn.size(), 50u);
+  for (long long i = 0; i < 50; i++)
+    BOOST_REQUIRE_EQUAL(drawn[i], i);
+  BOOST_REQUIRE(EventSampler::drawEntries(0, 10, true, 7).empty());
+  BOOST_REQUIRE(EventSampler::drawEntries(10, 0, false, 7).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE EventSelectionFileTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/EventSelectionFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace jpet_event_display;
+
+namespace
+{
+const char* kFilename = "EventSelectionFileTest.jpetsel";
+
+bool exists(const std::string& filename)
+{
+  return std::ifstream(filename).good();
+}
+
+ChannelHits makeHits(int event)
+{
+  ChannelHits hits;
+  for (int i = 0; i < event; i++)
+    hits.add(1 + i % 3, 1 + event, 10 * event + i, i % 2 ? 'B' : 'A', i % 2 == 0, 1000. * event + i, 0.5f * i);
+  return hits;
+}
+
+void requireEqual(const ChannelHits& a, const ChannelHits& b)
+{
+  BOOST_REQUIRE(a.layers == b.layers);
+  BOOST_REQUIRE(a.strips == b.strips);
+  BOOST_REQUIRE(a.pmIDs == b.pmIDs);
+  BOOST_REQUIRE(a.sides == b.sides);
+  BOOST_REQUIRE(a.leading == b.leading);
+  BOOST_REQUIRE(a.times == b.times);
+  BOOST_REQUIRE(a.thresholds == b.thresholds);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( RoundTripOverSeveralBlocks )
+{
+  const int events = 7;
+  {
+    EventSelectionWriter writer(3);
+    BOOST_REQUIRE(writer.open(kFilename));
+    for (int event = 0; event < events; event++)
+      writer.addEvent(makeHits(event));
+    BOOST_REQUIRE(!exists(kFilename));
+    BOOST_REQUIRE(writer.close());
+  }
+  BOOST_REQUIRE(!exists(std::string(kFilename) + ".tmp"));
+  BOOST_REQUIRE(EventSelectionFile::isEventSelectionFile(kFilename));
+
+  EventSelectionFile file;
+  BOOST_REQUIRE(file.open(kFilename));
+  BOOST_REQUIRE_EQUAL(file.getNumberOfEvents(), events);
+  // backwards, so every read seeks to another block
+  for (int event = events - 1; event >= 0; event--) {
+    ChannelHits hits;
+    BOOST_REQUIRE(file.readEvent(event, hits));
+    requireEqual(hits, makeHits(event));
+  }
+  ChannelHits hits;
+  BOOST_REQUIRE(!file.readEvent(events, hits));
+  BOOST_REQUIRE(!file.readEvent(-1, hits));
+  file.close();
+  std::remove(kFilename);
+}
+
+BOOST_AUTO_TEST_CASE( UnclosedWriterLeavesNothing )
+{
+  {
+    EventSelectionWriter writer(3);
+    BOOST_REQUIRE(writer.open(kFilename));
+    writer.addEvent(makeHits(2));
+  }
+  BOOST_REQUIRE(!exists(kFilename));
+  BOOST_REQUIRE(!exists(std::string(kFilename) + ".tmp"));
+
+  EventSelectionWriter writer;
+  BOOST_REQUIRE(writer.open(kFilename));
+  writer.abort();
+  BOOST_REQUIRE(!writer.close());
+  BOOST_REQUIRE(!exists(kFilename));
+}
+
+BOOST_AUTO_TEST_CASE( CorruptFilesAreNotReadPastTheEnd )
+{
+  {
+    EventSelectionWriter writer(4);
+    BOOST_REQUIRE(writer.open(kFilename));
+    for (int event = 0; event < 10; event++)
+      writer.addEvent(makeHits(event));
+    BOOST_REQUIRE(writer.close());
+  }
+  std::string data;
+  {
+    std::ifstream in(kFilename, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  const std::string corrupt = std::string(kFilename) + ".corrupt";
+  // every word overwritten in turn, with a value far beyond any size in the file
+  for (size_t offset = 0; offset + 8 <= data.size(); offset += 8) {
+    std::string broken = data;
+    const uint64_t garbage = 0xfffffff0fffffff0ULL;
+    std::memcpy(&broken[offset], &garbage, sizeof(garbage));
+    {
+      std::ofstream out(corrupt.c_str(), std::ios::binary);
+      out.write(broken.data(), broken.size());
+    }
+    EventSelectionFile file;
+    if (!file.open(corrupt))
+      continue;
+    ChannelHits hits;
+    for (long long event = 0; event < std::min(file.getNumberOfEvents(), 20LL); event++)
+      if (file.readEvent(event, hits))
+        BOOST_REQUIRE(hits.size() <= 9u);
+  }
+  std::remove(corrupt.c_str());
+  std::remove(kFilename);
+}
+
+BOOST_AUTO_TEST_CASE( OtherFilesAreRejected )
+{
+  BOOST_REQUIRE(!EventSelectionFile::isEventSelectionFile("EventSelectionFileTest.missing"));
+  {
+    std::ofstream out(kFilename);
+    out << "JPETSEL1 but nothing else";
+  }
+  EventSelectionFile file;
+  BOOST_REQUIRE(!file.open(kFilename));
+  std::remove(kFilename);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ReaderPoolTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/ReaderPool.h"
+#include "../src/DataProcessor.h"
+#include "../src/EventSelectionFile.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace jpet_event_display;
+
+namespace
+{
+const char* kFilename = "ReaderPoolTest.jpetsel";
+const char* kMissingFilename = "ReaderPoolTest.missing.jpetsel";
+const int kEvents = 40;
+
+ChannelHits makeHits(int event)
+{
+  ChannelHits hits;
+  for (int i = 0; i < 1 + event % 5; i++)
+    hits.add(1 + i % 3, 1 + event % 48, 10 * event + i, i % 2 ? 'B' : 'A', true, 1000. * event + i, 0.5f * i);
+  return hits;
+}
+
+struct SelectionFixture
+{
+  SelectionFixture()
+  {
+    EventSelectionWriter writer(8);
+    BOOST_REQUIRE(writer.open(kFilename));
+    for (int event = 0; event < kEvents; event++)
+      writer.addEvent(makeHits(event));
+    BOOST_REQUIRE(writer.close());
+  }
+  ~SelectionFixture() { std::remove(kFilename); }
+};
+
+bool isDecoded(const std::shared_ptr<const DecodedEvent>& event, long long entry)
+{
+  return event && event->valid && event->entry == entry
+         && event->hits.times == makeHits(static_cast<int>(entry)).times;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( UnreadableFileReleasesEveryReaderSlot )
+{
+  ReaderPool pool(kMissingFilename, CoincidenceOptions(), 2);
+  // more decodes than slots, a slot which was not given back would block the third one
+  for (long long entry = 0; entry < 3; entry++) {
+    std::shared_ptr<const DecodedEvent> event = pool.decode(entry);
+    BOOST_REQUIRE(event);
+    BOOST_REQUIRE(!event->valid);
+    BOOST_REQUIRE_EQUAL(event->entry, entry);
+  }
+  BOOST_REQUIRE_EQUAL(pool.getNumberOfReaders(), 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE( CheckedInReaderIsReused, SelectionFixture )
+{
+  ReaderPool pool(kFilename, CoincidenceOptions(), 4);
+  for (long long entry = 0; entry < kEvents; entry++)
+    BOOST_REQUIRE(isDecoded(pool.decode(entry), entry));
+  BOOST_REQUIRE_EQUAL(pool.getNumberOfReaders(), 1u);
+
+  // an entry past the end is read without an exception, the reader goes back to the pool
+  std::shared_ptr<const DecodedEvent> event = pool.decode(kEvents);
+  BOOST_REQUIRE(event && !event->valid);
+  BOOST_REQUIRE(isDecoded(pool.decode(0), 0));
+  BOOST_REQUIRE_EQUAL(pool.getNumberOfReaders(), 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE( ConcurrentDecodesStayWithinMaxReaders, SelectionFixture )
+{
+  const size_t maxReaders = 3;
+  ReaderPool pool(kFilename, CoincidenceOptions(), maxReaders);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 8; thread++)
+    threads.emplace_back([&pool, &failures, thread] {
+      for (int i = 0; i < 3 * kEvents; i++) {
+        const long long entry = (thread * 7 + i) % kEvents;
+        if (!isDecoded(pool.decode(entry), entry))
+          failures++;
+      }
+    });
+  for (auto& thread : threads)
+    thread.join();
+  BOOST_REQUIRE_EQUAL(failures, 0);
+  BOOST_REQUIRE(pool.getNumberOfReaders() >= 1u);
+  BOOST_REQUIRE(pool.getNumberOfReaders() <= maxReaders);
+}
+
+BOOST_FIXTURE_TEST_CASE( FailedOpenLeavesNothingToDecode, SelectionFixture )
+{
+  DataProcessor processor;
+  BOOST_REQUIRE(processor.openFile(kFilename));
+  BOOST_REQUIRE(isDecoded(processor.decode(3), 3));
+
+  // decode() must not read the file whose open failed, nor the one before it
+  BOOST_REQUIRE(!processor.openFile(kMissingFilename));
+  std::shared_ptr<const DecodedEvent> event = processor.decode(3);
+  BOOST_REQUIRE(event && !event->valid);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
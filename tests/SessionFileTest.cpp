@@ -0,0 +1,142 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE SessionFileTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/ByteStream.h"
+#include "../src/ChannelQA.h"
+#include "../src/SessionFile.h"
+#include "../src/StripIndex.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+using namespace jpet_event_display;
+
+namespace
+{
+const char* kFilename = "SessionFileTest.session";
+const char* kTruncated = "SessionFileTest.truncated";
+
+SessionState makeState()
+{
+  SessionState state;
+  state.geometryFile = "JPET_geom.root";
+  state.dataFile = "SessionFileTest.missing.root";
+  state.entry = 42;
+  state.step = 3;
+  state.camera[0] = 10.;
+  state.camera[1] = -20.;
+  state.camera[2] = 30.;
+  state.hits.add(1, 2, 3, 'A', true, 100., 80.f);
+  state.hits.add(1, 2, 4, 'B', true, 150., 80.f);
+  return state;
+}
+
+std::string readFile(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( ByteReaderStopsAtTheEnd )
+{
+  std::string data;
+  ByteWriter writer(data);
+  writer.put<int32_t>(7);
+  writer.putString("abc");
+  writer.putVector(std::vector<double>{1., 2.});
+
+  ByteReader reader(data.data(), data.size());
+  int32_t value = 0;
+  std::string text;
+  std::vector<double> values;
+  BOOST_REQUIRE(reader.get(value) && value == 7);
+  BOOST_REQUIRE(reader.getString(text) && text == "abc");
+  BOOST_REQUIRE(reader.getVector(values) && values.size() == 2u);
+  BOOST_REQUIRE(reader.ok());
+  BOOST_REQUIRE(!reader.get(value));
+  BOOST_REQUIRE(!reader.ok());
+
+  // a count beyond the data fails before anything is allocated
+  for (size_t size = 0; size < data.size(); size++) {
+    ByteReader truncated(data.data(), size);
+    truncated.get(value);
+    truncated.getString(text);
+    truncated.getVector(values);
+    BOOST_REQUIRE(!truncated.ok());
+  }
+  std::string huge;
+  ByteWriter(huge).put<uint64_t>(uint64_t(1) << 62);
+  ByteReader hugeReader(huge.data(), huge.size());
+  BOOST_REQUIRE(!hugeReader.getVector(values));
+}
+
+BOOST_AUTO_TEST_CASE( RoundTrip )
+{
+  const SessionState state = makeState();
+  StripIndex index;
+  index.add(1, 2, 5);
+  index.finish(state.dataFile, 10);
+  ChannelQA qa;
+  qa.addEntry(state.hits);
+  BOOST_REQUIRE(SessionFile::write(kFilename, state, &index, &qa));
+
+  SessionFile session;
+  BOOST_REQUIRE(session.open(kFilename));
+  const SessionState& restored = session.getState();
+  BOOST_REQUIRE_EQUAL(restored.geometryFile, state.geometryFile);
+  BOOST_REQUIRE_EQUAL(restored.dataFile, state.dataFile);
+  BOOST_REQUIRE_EQUAL(restored.entry, 42);
+  BOOST_REQUIRE_EQUAL(restored.step, 3);
+  BOOST_REQUIRE_EQUAL(restored.camera[1], -20.);
+  BOOST_REQUIRE(restored.hits.times == state.hits.times);
+  BOOST_REQUIRE(restored.hits.sides == state.hits.sides);
+  // the data file does not exist, so nothing cached for it is current
+  BOOST_REQUIRE(!session.isDataFileCurrent());
+  StripIndex restoredIndex;
+  BOOST_REQUIRE(session.restoreStripIndex(restoredIndex));
+  BOOST_REQUIRE_EQUAL(restoredIndex.nextEntry(1, 2, -1), 5);
+  // counters filled with addEntry belong to no data file
+  ChannelQA restoredQA;
+  BOOST_REQUIRE(!session.restoreChannelQA(restoredQA));
+  session.close();
+  std::remove(kFilename);
+}
+
+BOOST_AUTO_TEST_CASE( TruncatedFiles )
+{
+  const SessionState state = makeState();
+  StripIndex index;
+  for (long long entry = 0; entry < 500; entry++)
+    index.add(1, 1 + entry % 4, entry);
+  index.finish(state.dataFile, 500);
+  BOOST_REQUIRE(SessionFile::write(kFilename, state, &index, 0));
+  const std::string data = readFile(kFilename);
+  BOOST_REQUIRE(!data.empty());
+
+  for (size_t size = 0; size < data.size(); size += 8) {
+    {
+      std::ofstream out(kTruncated, std::ios::binary);
+      out.write(data.data(), size);
+    }
+    SessionFile session;
+    if (!session.open(kTruncated))
+      continue;
+    // what is read is either complete or left out
+    BOOST_REQUIRE_EQUAL(session.getState().entry, 42);
+    BOOST_REQUIRE(session.getState().hits.size() == 0 || session.getState().hits.times == state.hits.times);
+    StripIndex restored;
+    if (session.restoreStripIndex(restored))
+      BOOST_REQUIRE(restored.getEntries(1, 3) == index.getEntries(1, 3));
+    else
+      BOOST_REQUIRE_EQUAL(restored.getNumberOfStrips(), 0u);
+  }
+  std::remove(kTruncated);
+  std::remove(kFilename);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE StripIndexTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/StripIndex.h"
+
+using namespace jpet_event_display;
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( NextAndPreviousAcrossSkipEntries )
+{
+  // every 3rd entry, far more postings than one skip interval
+  StripIndex index;
+  for (long long entry = 0; entry < 3000; entry += 3)
+    index.add(1, 1, entry);
+  index.finish("run.root", 3000);
+
+  BOOST_REQUIRE_EQUAL(index.getCount(1, 1), 1000u);
+  BOOST_REQUIRE_CLOSE(index.getHitRate(1, 1), 1. / 3., 1e-9);
+  BOOST_REQUIRE_EQUAL(index.nextEntry(1, 1, -1), 0);
+  BOOST_REQUIRE_EQUAL(index.nextEntry(1, 1, 0), 3);
+  BOOST_REQUIRE_EQUAL(index.nextEntry(1, 1, 4), 6);
+  BOOST_REQUIRE_EQUAL(index.previousEntry(1, 1, 6), 3);
+  BOOST_REQUIRE_EQUAL(index.previousEntry(1, 1, 0), -1);
+  BOOST_REQUIRE_EQUAL(index.nextEntry(1, 1, 2997), -1);
+  BOOST_REQUIRE_EQUAL(index.previousEntry(1, 1, 5000), 2997);
+  for (long long entry = 370; entry < 400; entry++) {
+    BOOST_REQUIRE_EQUAL(index.nextEntry(1, 1, entry), (entry / 3 + 1) * 3);
+    BOOST_REQUIRE_EQUAL(index.previousEntry(1, 1, entry), (entry - 1) / 3 * 3);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( VarintDeltasKeepLargeGaps )
+{
+  const std::vector<long long> entries = {0, 1, 127, 128, 16511, 16512, 1LL << 40, (1LL << 40) + 1};
+  StripIndex index;
+  for (long long entry : entries)
+    index.add(2, 7, entry);
+  index.add(2, 7, entries.back()); // repeats are ignored
+  BOOST_REQUIRE(index.getEntries(2, 7) == entries);
+  BOOST_REQUIRE_EQUAL(index.getNumberOfStrips(), 1u);
+  BOOST_REQUIRE_EQUAL(index.getCount(2, 8), 0u);
+  BOOST_REQUIRE_EQUAL(index.nextEntry(2, 8, -1), -1);
+}
+
+BOOST_AUTO_TEST_CASE( SerializeRoundTrip )
+{
+  StripIndex index;
+  for (long long entry = 0; entry < 1000; entry++) {
+    index.add(1, 1 + entry % 5, entry);
+    if (entry % 7 == 0)
+      index.add(3, 2, entry);
+  }
+  index.finish("run.root", 1000);
+  std::string data;
+  index.serialize(data);
+
+  StripIndex restored;
+  BOOST_REQUIRE(restored.deserialize(data.data(), data.size()));
+  BOOST_REQUIRE_EQUAL(restored.getDataFile(), "run.root");
+  BOOST_REQUIRE_EQUAL(restored.getNumberOfEntries(), 1000);
+  BOOST_REQUIRE_EQUAL(restored.getNumberOfStrips(), 6u);
+  BOOST_REQUIRE(restored.getEntries(1, 3) == index.getEntries(1, 3));
+  BOOST_REQUIRE(restored.getEntries(3, 2) == index.getEntries(3, 2));
+  BOOST_REQUIRE_EQUAL(restored.nextEntry(3, 2, 500), 504);
+
+  BOOST_REQUIRE(!restored.deserialize(data.data(), data.size() / 2));
+  BOOST_REQUIRE_EQUAL(restored.getNumberOfStrips(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,77 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TimeIndexTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/TimeIndex.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace jpet_event_display;
+
+namespace
+{
+const char* kDataFile = "TimeIndexTest.root";
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( FindEntry )
+{
+  TimeIndex index(1000.);
+  BOOST_REQUIRE_EQUAL(index.findEntry(0.), -1);
+  // entries out of window order
+  index.add(0, 5);
+  index.add(1, 3);
+  index.add(2, 7);
+  index.finish(kDataFile);
+  BOOST_REQUIRE_EQUAL(index.size(), 3u);
+  BOOST_REQUIRE_EQUAL(index.getFirstTime(), 3000.);
+  BOOST_REQUIRE_EQUAL(index.getLastTime(), 7000.);
+
+  double startTime = 0.;
+  BOOST_REQUIRE_EQUAL(index.findEntry(100., &startTime), 1);
+  BOOST_REQUIRE_EQUAL(startTime, 3000.);
+  BOOST_REQUIRE_EQUAL(index.findEntry(5000., &startTime), 0);
+  BOOST_REQUIRE_EQUAL(startTime, 5000.);
+  // inside the gap between windows 5 and 7
+  BOOST_REQUIRE_EQUAL(index.findEntry(6999., &startTime), 0);
+  BOOST_REQUIRE_EQUAL(index.findEntry(1e12, &startTime), 2);
+  BOOST_REQUIRE_EQUAL(startTime, 7000.);
+
+  // the length is only applied on lookup
+  index.setWindowLength(2000.);
+  BOOST_REQUIRE_EQUAL(index.findEntry(10000., &startTime), 0);
+  BOOST_REQUIRE_EQUAL(startTime, 10000.);
+}
+
+BOOST_AUTO_TEST_CASE( SidecarFollowsTheDataFile )
+{
+  {
+    std::ofstream data(kDataFile);
+    data << "run";
+  }
+  TimeIndex index(1000.);
+  for (long long entry = 0; entry < 100; entry++)
+    index.add(entry, 2 * entry);
+  index.finish(kDataFile);
+  const std::string sidecar = TimeIndex::getSidecarName(kDataFile);
+  BOOST_REQUIRE(index.save(sidecar));
+
+  TimeIndex loaded(1000.);
+  BOOST_REQUIRE(loaded.load(sidecar));
+  BOOST_REQUIRE_EQUAL(loaded.getDataFile(), kDataFile);
+  BOOST_REQUIRE_EQUAL(loaded.size(), 100u);
+  BOOST_REQUIRE_EQUAL(loaded.findEntry(51000.), 25);
+
+  {
+    std::ofstream data(kDataFile, std::ios::app);
+    data << " grew";
+  }
+  BOOST_REQUIRE(!loaded.load(sidecar));
+  BOOST_REQUIRE_EQUAL(loaded.size(), 0u);
+  std::remove(sidecar.c_str());
+  std::remove(kDataFile);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TimeSliceTest
+#include <boost/test/unit_test.hpp>
+
+#include "../src/TimeSlice.h"
+
+using namespace jpet_event_display;
+
+namespace
+{
+ChannelHits makeHits()
+{
+  ChannelHits hits;
+  hits.add(1, 1, 1, 'A', true, 0., 80.f);
+  hits.add(1, 2, 3, 'A', true, 10., 80.f);
+  hits.add(1, 1, 2, 'B', true, 20., 80.f);
+  hits.add(2, 3, 4, 'A', true, 30., 80.f);
+  return hits;
+}
+
+/// net state of every strip after the changes, in order
+std::map<std::pair<int, int>, bool> applyChanges(const std::vector<StripChange>& changes)
+{
+  std::map<std::pair<int, int>, bool> fired;
+  for (const auto& change : changes)
+    fired[std::make_pair(change.layer, change.strip)] = change.fired;
+  return fired;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FirstSuite)
+
+BOOST_AUTO_TEST_CASE( OverlappingMoves )
+{
+  ChannelHits hits = makeHits();
+  TimeSlice slice;
+  slice.reset(&hits);
+  BOOST_REQUIRE_EQUAL(slice.getFirstTime(), 0.);
+  BOOST_REQUIRE_EQUAL(slice.getLastTime(), 30.);
+
+  std::vector<StripChange> changes;
+  slice.setRange(0., 15., changes);
+  BOOST_REQUIRE_EQUAL(slice.getNumberOfHits(), 2u);
+  auto fired = applyChanges(changes);
+  BOOST_REQUIRE_EQUAL(fired.size(), 2u);
+  BOOST_REQUIRE(fired[std::make_pair(1, 1)]);
+  BOOST_REQUIRE(fired[std::make_pair(1, 2)]);
+
+  // hit 0 leaves and hit 20 enters, strip 1/1 stays fired
+  changes.clear();
+  slice.setRange(5., 25., changes);
+  BOOST_REQUIRE_EQUAL(slice.getNumberOfHits(), 2u);
+  fired = applyChanges(changes);
+  BOOST_REQUIRE(fired.count(std::make_pair(1, 2)) == 0);
+  BOOST_REQUIRE(fired[std::make_pair(1, 1)]);
+  ScintillatorsInLayers selection = slice.getSelection();
+  BOOST_REQUIRE_EQUAL(selection.size(), 1u);
+  BOOST_REQUIRE(selection[1] == std::vector<int>({1, 2}));
+}
+
+BOOST_AUTO_TEST_CASE( DisjointMove )
+{
+  ChannelHits hits = makeHits();
+  TimeSlice slice;
+  slice.reset(&hits);
+  std::vector<StripChange> changes;
+  slice.setRange(0., 15., changes);
+  changes.clear();
+  slice.setRange(25., 100., changes);
+  BOOST_REQUIRE_EQUAL(slice.getNumberOfHits(), 1u);
+  auto fired = applyChanges(changes);
+  BOOST_REQUIRE_EQUAL(fired.size(), 3u);
+  BOOST_REQUIRE(!fired[std::make_pair(1, 1)]);
+  BOOST_REQUIRE(!fired[std::make_pair(1, 2)]);
+  BOOST_REQUIRE(fired[std::make_pair(2, 3)]);
+  ScintillatorsInLayers selection = slice.getSelection();
+  BOOST_REQUIRE_EQUAL(selection.size(), 1u);
+  BOOST_REQUIRE(selection[2] == std::vector<int>({3}));
+}
+
+BOOST_AUTO_TEST_CASE( EmptyRange )
+{
+  ChannelHits hits = makeHits();
+  TimeSlice slice;
+  slice.reset(&hits);
+  std::vector<StripChange> changes;
+  slice.setRange(40., 50., changes);
+  BOOST_REQUIRE_EQUAL(slice.getNumberOfHits(), 0u);
+  BOOST_REQUIRE(changes.empty());
+  BOOST_REQUIRE(slice.getSelection().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()